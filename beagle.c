@@ -0,0 +1,641 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Shared reader for genotype probabilities in Beagle format. See beagle.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "beagle.h"
+#include "bgzf.h"
+#define merror "\nERROR: System out of memory\n\n"
+#define BUFSIZE 4194304
+#define JUMPSIZE 262144 /* first refill after a seek, and how far ahead a region may start and still be read through */
+#define NA 0.333333
+
+static const double scale[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+static size_t fillBuffer(Beagle_s *b);
+static char *readLine(Beagle_s *b, size_t *len);
+static char *nextLine(Beagle_s *b, size_t *len);
+static void jumpTo(Beagle_s *b, long long off);
+static void allocRows(Beagle_s *b, int n);
+static void readHeader(Beagle_s *b);
+static void openStore(Beagle_s *b);
+static int storeNext(Beagle_s *b);
+static int storeProbs(Beagle_s *b);
+static char *skipTriplet(char *s);
+static int isMissing(const char *s);
+
+Beagle_s *beagleOpen(FILE *file) {
+    Beagle_s *b = NULL;
+
+    if((b = malloc(sizeof(Beagle_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memset(b, 0, sizeof(Beagle_s));
+    b->file = file;
+    b->size = BUFSIZE;
+    if((b->buf = malloc(b->size + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    b->next = b->buf;
+    b->end = b->buf + fread(b->buf, 1, 8, file);
+    b->bytes = b->end - b->buf;
+
+    if(b->end - b->buf == 8 && memcmp(b->buf, STORE_MAGIC, 8) == 0)
+        openStore(b);
+    else
+        readHeader(b);
+
+    allocRows(b, b->ind_n);
+
+    return b;
+}
+
+/* Creates an independent parser with the same individuals and selection, used to parse lines from beagleChunk() on other threads */
+Beagle_s *beagleCopy(Beagle_s *b) {
+    Beagle_s *copy = NULL;
+
+    if((copy = malloc(sizeof(Beagle_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memset(copy, 0, sizeof(Beagle_s));
+    copy->ind_n = b->ind_n;
+    allocRows(copy, b->ind_n);
+    if(b->sel != NULL)
+        beagleSelect(copy, b->sel, b->sel_n);
+
+    return copy;
+}
+
+/* Restricts parsing to the listed columns (individuals). After this, p0, p1, p2 and miss hold the columns in the order given. */
+void beagleSelect(Beagle_s *b, int *cols, int n) {
+    int i;
+
+    if((b->sel = malloc((n + 1) * sizeof(int))) == NULL || (b->used = calloc(b->ind_n + 1, 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < n; i++) {
+        b->sel[i] = cols[i];
+        b->used[cols[i]] = 1;
+    }
+    free(b->p0);
+    free(b->miss);
+    allocRows(b, n);
+    if(b->map == NULL) {
+        if((b->f0 = malloc(3 * b->ind_n * sizeof(double) + 1)) == NULL || (b->fmiss = malloc(b->ind_n + 1)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        b->f1 = b->f0 + b->ind_n;
+        b->f2 = b->f1 + b->ind_n;
+    }
+}
+
+/* Moves to the next site and splits its marker. Probabilities are not parsed until beagleProbs() is called. */
+int beagleNext(Beagle_s *b) {
+    size_t len = 0;
+    char *line = NULL;
+
+    if(b->map != NULL)
+        return storeNext(b);
+
+    while((line = nextLine(b, &len)) != NULL) {
+        if(beagleLine(b, line))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Splits the marker of a single line in place. Returns 0 for empty and header lines. */
+int beagleLine(Beagle_s *b, char *line) {
+    char *temp = NULL, *split = NULL;
+
+    if(line[0] == '\0')
+        return 0;
+    if((temp = strchr(line, '\t')) == NULL)
+        return 0;
+    *temp = '\0';
+    if(strcmp(line, "marker") == 0)
+        return 0;
+    b->chr = line;
+    b->pos = 0;
+    if((split = strrchr(line, '_')) != NULL) {
+        *split = '\0';
+        for(split++; *split >= '0' && *split <= '9'; split++)
+            b->pos = b->pos * 10 + (*split - '0');
+    }
+    temp++;
+    b->major = temp[0];
+    if((temp = strchr(temp, '\t')) != NULL) {
+        temp++;
+        b->minor = temp[0];
+        temp = strchr(temp, '\t');
+    }
+    b->fields = temp == NULL ? "" : temp + 1;
+
+    return 1;
+}
+
+/* Copies up to max lines into *chunk (grown as needed), each terminated with '\0'. Returns the number of lines, 0 at the end of file. */
+int beagleChunk(Beagle_s *b, char **chunk, size_t *size, int max) {
+    int n = 0;
+    size_t len = 0, used = 0;
+    char *line = NULL;
+
+    while(n < max && (line = nextLine(b, &len)) != NULL) {
+        if(used + len + 1 > *size) {
+            *size = 2 * (used + len + 1);
+            if((*chunk = realloc(*chunk, *size)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+        memcpy(*chunk + used, line, len + 1);
+        used += len + 1;
+        n++;
+    }
+
+    return n;
+}
+
+/* Parses the probabilities of the current site. Returns the number of triplets found on the line, individuals beyond it are set as missing. */
+int beagleProbs(Beagle_s *b) {
+    int i, k;
+    char *s = b->fields;
+    double *p0 = b->p0, *p1 = b->p1, *p2 = b->p2;
+    char *miss = b->miss;
+
+    if(b->map != NULL)
+        return storeProbs(b);
+
+    if(b->sel != NULL) {
+        p0 = b->f0;
+        p1 = b->f1;
+        p2 = b->f2;
+        miss = b->fmiss;
+    }
+    for(i = 0; i < b->ind_n && *s != '\0'; i++) {
+        if(b->used != NULL && b->used[i] == 0)
+            s = skipTriplet(s);
+        else if(isMissing(s)) {
+            p0[i] = NA;
+            p1[i] = NA;
+            p2[i] = NA;
+            miss[i] = 1;
+            s += 26;
+            if(*s == '\t')
+                s++;
+        } else {
+            p0[i] = beagleScan(&s);
+            p1[i] = beagleScan(&s);
+            p2[i] = beagleScan(&s);
+            miss[i] = 0;
+        }
+    }
+    if(i < b->ind_n)
+        memset(miss + i, 1, b->ind_n - i);
+    if(b->sel != NULL) {
+        for(k = 0; k < b->sel_n; k++) {
+            b->p0[k] = p0[b->sel[k]];
+            b->p1[k] = p1[b->sel[k]];
+            b->p2[k] = p2[b->sel[k]];
+            b->miss[k] = miss[b->sel[k]];
+        }
+    }
+
+    return i;
+}
+
+/* Sums p1 + 2 * p2, p1 and the number of genotypes that are not missing over the selected individuals from ... to - 1 of the current site.
+   Only quantised stores are summed here, as integers that are scaled once at the end. Returns 0 for other input, which is summed from b->p1 and b->p2 after beagleProbs(). */
+int beagleDose(Beagle_s *b, int from, int to, double *dose, double *het, double *n) {
+    int i, s, m, col;
+    unsigned long long sum_d = 0, sum_h = 0, sum_n = 0;
+    long long block;
+    unsigned char *cols = NULL, *v8 = NULL;
+    unsigned short *v16 = NULL;
+
+    if(b->quant == 0)
+        return 0;
+    block = b->site_i / STORE_BLOCK;
+    s = b->site_i % STORE_BLOCK;
+    m = b->store->site_n - block * STORE_BLOCK < STORE_BLOCK ? b->store->site_n - block * STORE_BLOCK : STORE_BLOCK;
+    cols = b->map + b->store->data_off + block * storeBlockBytes(b->ind_n, STORE_BLOCK, b->bytes_q) + storeBlockBytes(0, m, b->bytes_q);
+    if(b->bytes_q == 2) {
+        for(i = from; i < to; i++) {
+            col = b->sel != NULL ? b->sel[i] : i;
+            v16 = (unsigned short *)cols + (long long)col * m * 3 + 3 * s;
+            if(v16[0] == STORE_QNA(16))
+                continue;
+            sum_d += v16[1] + 2 * v16[2];
+            sum_h += v16[1];
+            sum_n++;
+        }
+    } else {
+        for(i = from; i < to; i++) {
+            col = b->sel != NULL ? b->sel[i] : i;
+            v8 = cols + (long long)col * m * 3 + 3 * s;
+            if(v8[0] == STORE_QNA(8))
+                continue;
+            sum_d += v8[1] + 2 * v8[2];
+            sum_h += v8[1];
+            sum_n++;
+        }
+    }
+    *dose = sum_d / b->scale;
+    *het = sum_h / b->scale;
+    *n = sum_n;
+
+    return 1;
+}
+
+/* Restricts reading to the regions added to a position index with seekAdd(). The index is freed with the reader. Binary stores are read as before. */
+void beagleSeek(Beagle_s *b, Seek_s *s) {
+    SeekEntry_s *e = NULL;
+
+    if(b->map != NULL) {
+        seekFree(s);
+        return;
+    }
+    seekSort(s);
+    b->seek = s;
+    if(s->query_n > 0) {
+        e = seekEntry(s, s->query[0].chr, s->query[0].start);
+        if((e - s->entries + 1) * (long long)SEEK_PLAIN > b->bytes + JUMPSIZE) /* only the header was read, nextLine() reads through to a nearby region */
+            jumpTo(b, e->off);
+    }
+}
+
+/* Size of a block of n sites in the binary store with the given bytes per probability */
+long long storeBlockBytes(int ind_n, int n, int bytes) {
+    return (((long long)n * 10 + 3) & ~3LL) + (long long)ind_n * n * 3 * bytes;
+}
+
+void beagleClose(Beagle_s *b) {
+    int i;
+
+    if(b->names != NULL) {
+        for(i = 0; i < b->ind_n; i++)
+            free(b->names[i]);
+        free(b->names);
+    }
+    free(b->p0);
+    free(b->miss);
+    free(b->sel);
+    free(b->used);
+    free(b->f0);
+    free(b->fmiss);
+    if(b->map != NULL) {
+        munmap(b->map, b->map_size);
+        free(b->chrs);
+    }
+    free(b->buf);
+    seekFree(b->seek);
+    if(b->file != NULL)
+        fclose(b->file);
+    free(b);
+}
+
+/* Keeps the unread part of the buffer and fills the rest from file, doubling the buffer if a single line does not fit. After a seek the refills start small and double. */
+static size_t fillBuffer(Beagle_s *b) {
+    size_t left = b->end - b->next, read = 0, want = 0;
+    char *temp = NULL;
+    struct timespec t0, t1;
+
+    if(left > 0 && b->next != b->buf)
+        memmove(b->buf, b->next, left);
+    if(left == b->size) {
+        if((temp = realloc(b->buf, 2 * b->size + 1)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        b->buf = temp;
+        b->size *= 2;
+    }
+    b->next = b->buf;
+    b->end = b->buf + left;
+    want = b->size - left;
+    if(b->fill > 0 && b->fill < want) {
+        want = b->fill;
+        b->fill *= 2;
+    } else
+        b->fill = 0;
+    if(b->timed)
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+    read = fread(b->end, 1, want, b->file);
+    if(b->timed) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        b->wait += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    }
+    b->end += read;
+    b->bytes += read;
+    if(read == 0)
+        b->eof = 1;
+
+    return read;
+}
+
+/* Returns the next line terminated in place and its length, or NULL at the end of file */
+static char *readLine(Beagle_s *b, size_t *len) {
+    char *line = NULL, *nl = NULL;
+
+    while((nl = memchr(b->next, '\n', b->end - b->next)) == NULL) {
+        if(b->eof || fillBuffer(b) == 0) {
+            if(b->next == b->end)
+                return NULL;
+            nl = b->end;
+            break;
+        }
+    }
+    line = b->next;
+    b->next = nl < b->end ? nl + 1 : nl;
+    if(nl > line && nl[-1] == '\r')
+        nl--;
+    *nl = '\0';
+    *len = nl - line;
+
+    return line;
+}
+
+/* Reads individual names from the header. Without a header, the number of individuals is taken from the first site. */
+static void readHeader(Beagle_s *b) {
+    int i, n = 0;
+    size_t len = 0;
+    char *line = NULL, *temp = NULL, *end = NULL;
+
+    while(1) {
+        while(b->next < b->end && (*b->next == '\n' || *b->next == '\r'))
+            b->next++;
+        if((end = memchr(b->next, '\n', b->end - b->next)) != NULL || b->eof)
+            break;
+        fillBuffer(b);
+    }
+    if(end == NULL)
+        end = b->end;
+
+    for(temp = b->next; temp < end; temp++) {
+        if(*temp == '\t')
+            n++;
+    }
+    b->ind_n = n >= 3 ? (n - 2) / 3 : 0;
+
+    if(end - b->next < 7 || strncmp(b->next, "marker\t", 7) != 0)
+        return;
+
+    line = readLine(b, &len);
+    if((b->names = malloc((b->ind_n + 1) * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    temp = strtok_r(line, "\t", &end);
+    for(i = 1, n = 0; temp != NULL; i++) {
+        if(i > 3 && (i - 4) % 3 == 0 && n < b->ind_n) {
+            if((b->names[n] = strdup(temp)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            n++;
+        }
+        temp = strtok_r(NULL, "\t", &end);
+    }
+    b->ind_n = n;
+}
+
+static void allocRows(Beagle_s *b, int n) {
+    b->sel_n = n;
+    if((b->p0 = malloc(3 * n * sizeof(double) + 1)) == NULL || (b->miss = malloc(n + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    b->p1 = b->p0 + n;
+    b->p2 = b->p1 + n;
+}
+
+/* Maps a binary store written by beagle2bin */
+static void openStore(Beagle_s *b) {
+    int i;
+    char *temp = NULL;
+    struct stat st;
+
+    if(fstat(fileno(b->file), &st) != 0 || (b->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(b->file), 0)) == MAP_FAILED) {
+        fprintf(stderr, "\nERROR: Cannot map the binary Beagle file (needs to be a regular file)\n\n");
+        exit(EXIT_FAILURE);
+    }
+    b->map_size = st.st_size;
+    b->bytes = st.st_size;
+    b->store = (Store_s *)b->map;
+    b->ind_n = b->store->ind_n;
+    b->site_i = -1;
+    b->bytes_q = b->store->bits == 16 ? 2 : b->store->bits == 8 ? 1 : 4;
+    b->scale = b->bytes_q == 4 ? STORE_SCALE : STORE_QSCALE(b->store->bits);
+    b->quant = b->bytes_q < 4;
+    if(b->store->block != STORE_BLOCK || (size_t)b->store->chrs_off > b->map_size || (b->store->bits != 0 && b->store->bits != 32 && b->bytes_q == 4)) {
+        fprintf(stderr, "\nERROR: Incompatible or truncated binary Beagle file\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if((b->names = malloc((b->ind_n + 1) * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    temp = (char *)b->map + b->store->names_off;
+    for(i = 0; i < b->ind_n; i++) {
+        if((b->names[i] = strdup(temp)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        temp += strlen(temp) + 1;
+    }
+
+    if((b->chrs = malloc((b->store->chr_n + 1) * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    temp = (char *)b->map + b->store->chrs_off;
+    for(i = 0; i < b->store->chr_n; i++) {
+        b->chrs[i] = temp;
+        temp += strlen(temp) + 1;
+    }
+}
+
+static int storeNext(Beagle_s *b) {
+    int s, n;
+    long long block;
+    unsigned char *base = NULL;
+
+    if(++b->site_i >= b->store->site_n)
+        return 0;
+    block = b->site_i / STORE_BLOCK;
+    s = b->site_i % STORE_BLOCK;
+    n = b->store->site_n - block * STORE_BLOCK < STORE_BLOCK ? b->store->site_n - block * STORE_BLOCK : STORE_BLOCK;
+    base = b->map + b->store->data_off + block * storeBlockBytes(b->ind_n, STORE_BLOCK, b->bytes_q);
+    b->chr = b->chrs[((int *)base)[s]];
+    b->pos = ((int *)base)[n + s];
+    b->major = base[8 * n + s];
+    b->minor = base[9 * n + s];
+
+    return 1;
+}
+
+/* Reads the triplets of the selected individuals, each from its own column */
+static int storeProbs(Beagle_s *b) {
+    int i, s, n, col;
+    unsigned int na, v[3];
+    long long block;
+    unsigned char *cols = NULL, *val = NULL;
+
+    block = b->site_i / STORE_BLOCK;
+    s = b->site_i % STORE_BLOCK;
+    n = b->store->site_n - block * STORE_BLOCK < STORE_BLOCK ? b->store->site_n - block * STORE_BLOCK : STORE_BLOCK;
+    cols = b->map + b->store->data_off + block * storeBlockBytes(b->ind_n, STORE_BLOCK, b->bytes_q) + storeBlockBytes(0, n, b->bytes_q);
+    na = b->bytes_q == 4 ? STORE_NA : STORE_QNA(8 * b->bytes_q);
+    for(i = 0; i < b->sel_n; i++) {
+        col = b->sel != NULL ? b->sel[i] : i;
+        val = cols + ((long long)col * n * 3 + 3 * s) * b->bytes_q;
+        if(b->bytes_q == 4) {
+            v[0] = ((unsigned int *)val)[0];
+            v[1] = ((unsigned int *)val)[1];
+            v[2] = ((unsigned int *)val)[2];
+        } else if(b->bytes_q == 2) {
+            v[0] = ((unsigned short *)val)[0];
+            v[1] = ((unsigned short *)val)[1];
+            v[2] = ((unsigned short *)val)[2];
+        } else {
+            v[0] = val[0];
+            v[1] = val[1];
+            v[2] = val[2];
+        }
+        if(v[0] == na) {
+            b->p0[i] = NA;
+            b->p1[i] = NA;
+            b->p2[i] = NA;
+            b->miss[i] = 1;
+        } else {
+            b->p0[i] = v[0] / b->scale;
+            b->p1[i] = v[1] / b->scale;
+            b->p2[i] = v[2] / b->scale;
+            b->miss[i] = 0;
+        }
+    }
+
+    return b->sel_n;
+}
+
+static char *skipTriplet(char *s) {
+    int i;
+
+    for(i = 0; i < 3 && *s != '\0'; i++) {
+        if((s = strchr(s, '\t')) == NULL)
+            return "";
+        s++;
+    }
+
+    return s;
+}
+
+/* Fixed-format decimal scanner for tab-separated fields, also used for the proportions of bedGraph files. Plain decimals with up to 15 digits are exact (same result as atof),
+   anything else falls back to strtod. Moves *s past the field and its tab. */
+double beagleScan(char **s) {
+    int digits = 0, frac = 0;
+    unsigned long long mant = 0;
+    char *p = *s, *end = NULL;
+    double val = 0;
+
+    while(*p >= '0' && *p <= '9') {
+        mant = mant * 10 + (*p++ - '0');
+        digits++;
+    }
+    if(*p == '.') {
+        for(p++; *p >= '0' && *p <= '9'; p++) {
+            mant = mant * 10 + (*p - '0');
+            frac++;
+        }
+        digits += frac;
+    }
+    if((*p == '\t' || *p == '\0') && digits > 0 && digits <= 15)
+        val = mant / scale[frac];
+    else {
+        val = strtod(*s, &end);
+        for(p = end; *p != '\t' && *p != '\0'; p++)
+            ;
+    }
+    if(*p == '\t')
+        p++;
+    *s = p;
+
+    return val;
+}
+
+static int isMissing(const char *s) {
+    return strncmp(s, "0.333333\t0.333333\t0.333333", 26) == 0 && (s[26] == '\t' || s[26] == '\0');
+}
+
+/* Returns the next line, skipping lines outside the regions of beagleSeek() and seeking forward when the next region starts beyond the buffered data and JUMPSIZE more.
+   Index entries are at most SEEK_PLAIN inflated bytes apart, which bounds the distance to the region. */
+static char *nextLine(Beagle_s *b, size_t *len) {
+    int chr = 0, pos = 0, n = 0;
+    char *line = NULL, *tab = NULL;
+    Seek_s *s = b->seek;
+    SeekQuery_s *q = NULL;
+    SeekEntry_s *e = NULL, *here = NULL;
+
+    if(s == NULL)
+        return readLine(b, len);
+    while(s->query_i < s->query_n && (line = readLine(b, len)) != NULL) {
+        tab = memchr(line, '\t', *len);
+        if((n = seekMarker(line, tab == NULL ? *len : tab - line, &pos)) < 0 || (chr = seekChr(s, line, n)) < 0)
+            continue;
+        q = &s->query[s->query_i];
+        while(chr > q->chr || (chr == q->chr && pos > q->end)) {
+            if(++s->query_i == s->query_n)
+                return NULL;
+            q++;
+            e = seekEntry(s, q->chr, q->start);
+            if(e->chr > chr || (e->chr == chr && e->pos > pos)) {
+                here = seekEntry(s, chr, pos);
+                if((e - here) * (long long)SEEK_PLAIN <= (long long)(b->end - b->next) + JUMPSIZE)
+                    continue; /* read through to the region */
+                jumpTo(b, e->off);
+                line = NULL;
+                break;
+            }
+        }
+        if(line != NULL && chr == q->chr && pos >= q->start && pos <= q->end)
+            return line;
+    }
+
+    return NULL;
+}
+
+static void jumpTo(Beagle_s *b, long long off) {
+    bgzfSeek(b->file, off);
+    b->next = b->buf;
+    b->end = b->buf;
+    b->eof = 0;
+    b->fill = JUMPSIZE;
+}
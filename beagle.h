@@ -0,0 +1,107 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Shared reader for genotype probabilities in Beagle format (marker, allele1, allele2, followed by three probabilities per individual).
+ Lines are parsed in place from a large read buffer: the chr_pos marker is split without copying and probabilities are read with a fixed-format decimal scanner.
+ Missing genotypes (0.333333 0.333333 0.333333) are recognised from the raw text.
+ Files converted with beagle2bin are recognised automatically and read through mmap, touching only the columns of the selected individuals.
+
+ Typical use:
+    b = beagleOpen(file);
+    beagleSelect(b, cols, n); (optional)
+    while(beagleNext(b)) {
+        ...filter on b->chr and b->pos...
+        beagleProbs(b);
+        ...use b->p0, b->p1, b->p2 and b->miss...
+    }
+    beagleClose(b);
+
+ With beagleSeek() only the lines overlapping the regions of a position index (see seek.h) are read, seeking over the rest of the file.
+
+ With a quantised binary store beagleDose() sums the dosage and heterozygosity of a range of the selected individuals with integer arithmetic, without beagleProbs().
+
+ For multithreaded parsing one thread fills chunks of raw lines with beagleChunk() and each worker parses them with beagleLine() on its own beagleCopy().
+*/
+
+#ifndef BEAGLE_H
+#define BEAGLE_H
+
+#include <stdio.h>
+#include "seek.h"
+
+/* Binary store written by beagle2bin: header, individual names, blocks of sites and the chromosome table.
+   Each block holds chr[n], pos[n], major[n] and minor[n] for its n sites (padded to 4 bytes),
+   followed by one column per individual with the probability triplets of the n sites as fixed-point integers.
+   Probabilities take 32 bits with six decimals (STORE_SCALE), or are quantised to 16 or 8 bits with the scale 2^bits - 2.
+   The largest value (STORE_NA, 2^bits - 1) marks the missing triplet. */
+#define STORE_MAGIC "BGLSTOR1"
+#define STORE_BLOCK 2048
+#define STORE_SCALE 1000000.0
+#define STORE_NA 0xffffffffu
+#define STORE_QNA(bits) ((1u << (bits)) - 1)
+#define STORE_QSCALE(bits) ((1u << (bits)) - 2)
+
+typedef struct {
+    char magic[8];
+    int ind_n, chr_n, block, bits; /* bits per probability, 0 in stores written before quantisation (same as 32) */
+    long long site_n, names_off, chrs_off, data_off;
+} Store_s;
+
+typedef struct {
+    FILE *file;
+    char *buf, *next, *end; /* read buffer, start of the next line and end of buffered data */
+    size_t size, fill;      /* buffer size and, after a seek, the size of the next refill */
+    int eof;
+    int ind_n;    /* number of individuals (triplets) per line */
+    char **names; /* individual names from the header, NULL if the file has no header */
+    char *chr;    /* current site, chr points into the read buffer and is valid until the next call to beagleNext() */
+    int pos;
+    char major, minor;
+    char *fields;             /* probability fields of the current site */
+    double *p0, *p1, *p2;     /* probabilities of the three genotypes, one entry per (selected) individual */
+    char *miss;               /* 1 if the individual has the missing triplet */
+    int sel_n, *sel;          /* columns chosen with beagleSelect() */
+    char *used;
+    double *f0, *f1, *f2;     /* full rows of a text file when only some columns are selected */
+    char *fmiss;
+    unsigned char *map;       /* binary store */
+    size_t map_size;
+    Store_s *store;
+    char **chrs;
+    long long site_i;
+    int bytes_q, quant;       /* bytes per probability in the store: 4, or 2 and 1 when quantised (quant = 1) */
+    double scale;
+    Seek_s *seek;             /* regions to read with beagleSeek() */
+    long long bytes;          /* bytes read from file (inflated), or the size of a binary store */
+    int timed;                /* if set, the time spent waiting for fread is added to wait (-stats) */
+    double wait;
+} Beagle_s;
+
+Beagle_s *beagleOpen(FILE *file);
+Beagle_s *beagleCopy(Beagle_s *b);
+void beagleSelect(Beagle_s *b, int *cols, int n);
+int beagleNext(Beagle_s *b);
+int beagleLine(Beagle_s *b, char *line);
+int beagleChunk(Beagle_s *b, char **chunk, size_t *size, int max);
+int beagleProbs(Beagle_s *b);
+int beagleDose(Beagle_s *b, int from, int to, double *dose, double *het, double *n);
+void beagleSeek(Beagle_s *b, Seek_s *s);
+void beagleClose(Beagle_s *b);
+double beagleScan(char **s);
+long long storeBlockBytes(int ind_n, int n, int bytes);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Program for indexing genotype probabilities in Beagle format by position, so that probs2fst and probs2pi (-genes) and make_est-sfs (-region, -sites) only read the parts of the file they use.
+ The file must be compressed with bgzip (or not compressed) and sorted by position within chromosomes. The index is written to file.idx and found automatically by the other programs.
+
+ Compiling: gcc beagle2idx.c bgzf.c seek.c -o beagle2idx -lm -lz -lpthread
+
+ Usage:
+ -beagle [file] Posterior genotype probabilities in Beagle format. Plain or BGZF compressed.
+ -out [file] Name of the index. Optional, default file.idx.
+
+ Example:
+ bgzip postprobs.beagle
+ ./beagle2idx -beagle postprobs.beagle.gz
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "seek.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+void openFiles(int argc, char *argv[]);
+
+int main(int argc, char *argv[]) {
+    int second = 0, minute = 0, hour = 0;
+    time_t timer = 0;
+
+    timer = time(NULL);
+    openFiles(argc, argv);
+    second = time(NULL) - timer;
+    minute = second / 60;
+    hour = second / 3600;
+
+    fprintf(stderr, "\nDone!");
+    if(hour > 0)
+        fprintf(stderr, "\nElapsed time: %i h, %i min & %i sec\n\n", hour, minute - hour * 60, second - minute * 60);
+    else if(minute > 0)
+        fprintf(stderr, "\nElapset time: %i min & %i sec\n\n", minute, second - minute * 60);
+    else if(second > 5)
+        fprintf(stderr, "\nElapsed time: %i sec\n\n", second);
+    else
+        fprintf(stderr, "\n\n");
+
+    return 0;
+}
+
+void openFiles(int argc, char *argv[]) {
+    int i;
+    long long n = 0;
+    char *beagle = NULL, *out = NULL;
+
+    fprintf(stderr, "\nParameters:\n");
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-beagle") == 0) {
+            beagle = argv[++i];
+            fprintf(stderr, "\t-beagle %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-out") == 0) {
+            out = argv[++i];
+            fprintf(stderr, "\t-out %s\n", argv[i]);
+        }
+
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(stderr, "\n");
+
+    if(beagle == NULL) {
+        fprintf(stderr, "\nERROR: -beagle [file] is required!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(out == NULL) {
+        if((out = malloc(strlen(beagle) + 5)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        sprintf(out, "%s.idx", beagle);
+    }
+
+    n = seekBuild(beagle, out);
+    fprintf(stderr, "Wrote %lli index entries to %s\n", n, out);
+}
@@ -0,0 +1,260 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Generator of synthetic input files for benchmarking probs2fst, probs2pi, bg2meta_plot and make_est-sfs.
+ Sites are spread over scaffold_1 ... scaffold_n. Half of the sites are invariant and the rest have an alternative allele frequency of 0 ... 0.5.
+ Genotype probabilities put most of the weight on the drawn genotype and are written with six decimals as by ANGSD.
+ The same seed always gives the same files.
+
+ Files written with the prefix given to -out:
+    prefix.beagle            genotype probabilities (marker, allele1, allele2, three probabilities per individual)
+    prefix_pop1..3.txt       individuals split into three populations
+    prefix_genes.txt         genes (chr, start, end, strand, id) and prefix_genes.bed the same genes in BED6
+    prefix.bg                unionbedg bedGraph with one methylation level per individual and site
+    prefix_out1..3.coord     show-coords (-T -H) alignments of three outgroups
+    prefix_out1..3.snps      show-snps (-C -H -T) substitutions of the three outgroups
+    prefix_regions.txt       regions (chr, start, end) and prefix_sites.txt sites (chr, pos) for make_est-sfs
+
+ Compiling: gcc -O2 -I. bench/gen_data.c rng.c writer.c -o gen_data -lm
+
+ Usage:
+ -out [string] Prefix of the output files. Default bench.
+ -sites [int] Number of sites. Default 200000.
+ -ind [int] Number of individuals. Default 50.
+ -missing [double] Fraction of missing genotypes (and bedGraph values). Default 0.1.
+ -chr [int] Number of chromosomes. Default 4.
+ -seed [int] Seed of the random numbers. Default 1.
+
+ Example:
+ ./gen_data -out bench -sites 1000000 -ind 100 -missing 0.05
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rng.h"
+#include "writer.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+FILE *openOut(const char *prefix, const char *suffix);
+void writeBeagle(const char *prefix, Rng_s *rng, int site_n, int ind_n, int chr_n, double missing, int *lens);
+void writeGenes(const char *prefix, Rng_s *rng, int chr_n, int *lens);
+void writeMummer(const char *prefix, Rng_s *rng, int chr_n, int *lens);
+void writeRegions(const char *prefix, Rng_s *rng, int chr_n, int *lens);
+
+int main(int argc, char *argv[]) {
+    int i, site_n = 200000, ind_n = 50, chr_n = 4, *lens = NULL;
+    unsigned long long seed = 1;
+    double missing = 0.1;
+    char *prefix = "bench";
+    Rng_s rng;
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+            prefix = argv[++i];
+        else if(strcmp(argv[i], "-sites") == 0 && i + 1 < argc)
+            site_n = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-ind") == 0 && i + 1 < argc)
+            ind_n = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-missing") == 0 && i + 1 < argc)
+            missing = atof(argv[++i]);
+        else if(strcmp(argv[i], "-chr") == 0 && i + 1 < argc)
+            chr_n = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(site_n < 1 || ind_n < 3 || chr_n < 1 || missing < 0 || missing >= 1) {
+        fprintf(stderr, "\nERROR: -sites and -chr need to be positive, -ind at least 3 and -missing in [0, 1)!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    if((lens = calloc(chr_n, sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+
+    rngInit(&rng, seed, 0, 0);
+    writeBeagle(prefix, &rng, site_n, ind_n, chr_n, missing, lens);
+    writeGenes(prefix, &rng, chr_n, lens);
+    writeMummer(prefix, &rng, chr_n, lens);
+    writeRegions(prefix, &rng, chr_n, lens);
+    fprintf(stderr, "Wrote %i sites of %i individuals on %i chromosomes to %s*\n", site_n, ind_n, chr_n, prefix);
+    free(lens);
+
+    return 0;
+}
+
+FILE *openOut(const char *prefix, const char *suffix) {
+    char name[4096];
+    FILE *file = NULL;
+
+    snprintf(name, sizeof(name), "%s%s", prefix, suffix);
+    if((file = fopen(name, "w")) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot create file %s\n\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    return file;
+}
+
+/* Writes the Beagle file, the populations and the bedGraph, which share the sites. lens gets the last position of each chromosome. */
+void writeBeagle(const char *prefix, Rng_s *rng, int site_n, int ind_n, int chr_n, double missing, int *lens) {
+    int i, j, k, c, g, pos = 0, major = 0, minor = 0;
+    double f = 0, p[3], sum = 0;
+    char name[64];
+    FILE *pops[3];
+    Writer_s *beagle = NULL, *bg = NULL;
+
+    beagle = writerOpen(openOut(prefix, ".beagle"));
+    bg = writerOpen(openOut(prefix, ".bg"));
+    pops[0] = openOut(prefix, "_pop1.txt");
+    pops[1] = openOut(prefix, "_pop2.txt");
+    pops[2] = openOut(prefix, "_pop3.txt");
+    writerStr(beagle, "marker\tallele1\tallele2");
+    writerStr(bg, "chrom\tstart\tend");
+    for(i = 0; i < ind_n; i++) {
+        snprintf(name, sizeof(name), "Ind%i", i);
+        for(k = 0; k < 3; k++) {
+            writerChar(beagle, '\t');
+            writerStr(beagle, name);
+        }
+        writerChar(bg, '\t');
+        writerStr(bg, name);
+        fprintf(pops[i * 3 / ind_n], "%s\n", name);
+    }
+    writerChar(beagle, '\n');
+    writerChar(bg, '\n');
+
+    for(i = 0; i < site_n; i++) {
+        c = (long long)i * chr_n / site_n;
+        if(i == 0 || c != (long long)(i - 1) * chr_n / site_n)
+            pos = 0;
+        pos += 1 + (int)(rngNext(rng) % 4);
+        lens[c] = pos;
+        major = rngNext(rng) % 4;
+        minor = (major + 1 + rngNext(rng) % 3) % 4;
+        f = rngUniform(rng) < 0.5 ? 0 : 0.5 * rngUniform(rng);
+        snprintf(name, sizeof(name), "scaffold_%i", c + 1);
+        writerStr(beagle, name);
+        writerChar(beagle, '_');
+        writerInt(beagle, pos);
+        writerChar(beagle, '\t');
+        writerInt(beagle, major);
+        writerChar(beagle, '\t');
+        writerInt(beagle, minor);
+        writerStr(bg, name);
+        writerChar(bg, '\t');
+        writerInt(bg, pos - 1);
+        writerChar(bg, '\t');
+        writerInt(bg, pos);
+        for(k = 0; k < ind_n; k++) {
+            if(rngUniform(rng) < missing)
+                writerStr(beagle, "\t0.333333\t0.333333\t0.333333");
+            else {
+                g = (rngUniform(rng) < f) + (rngUniform(rng) < f);
+                for(j = 0, sum = 0; j < 3; j++) {
+                    p[j] = 0.05 * rngUniform(rng) + (j == g);
+                    sum += p[j];
+                }
+                for(j = 0; j < 3; j++) {
+                    writerChar(beagle, '\t');
+                    writerFloat(beagle, p[j] / sum, 6);
+                }
+            }
+            writerChar(bg, '\t');
+            if(rngUniform(rng) < missing)
+                writerChar(bg, '.');
+            else
+                writerFloat(bg, 100 * rngUniform(rng), 2);
+        }
+        writerChar(beagle, '\n');
+        writerChar(bg, '\n');
+    }
+
+    writerClose(beagle);
+    writerClose(bg);
+    for(k = 0; k < 3; k++)
+        fclose(pops[k]);
+}
+
+/* Genes of 500 ... 5000 bp separated by -499 ... 3000 bp */
+void writeGenes(const char *prefix, Rng_s *rng, int chr_n, int *lens) {
+    int c, n = 0, start = 0, len = 0;
+    char str = '+';
+    FILE *genes = NULL, *bed = NULL;
+
+    genes = openOut(prefix, "_genes.txt");
+    bed = openOut(prefix, "_genes.bed");
+    for(c = 0; c < chr_n; c++) {
+        for(start = 100; start < lens[c]; start += len + (int)(rngNext(rng) % 3500) - 499) {
+            len = 500 + rngNext(rng) % 4501;
+            str = rngNext(rng) % 2 ? '+' : '-';
+            fprintf(genes, "scaffold_%i\t%i\t%i\t%c\tgene%i\n", c + 1, start, start + len, str, n);
+            fprintf(bed, "scaffold_%i\t%i\t%i\tgene%i\t0\t%c\n", c + 1, start - 1, start + len, n, str);
+            n++;
+        }
+    }
+    fclose(genes);
+    fclose(bed);
+}
+
+/* Alignments of 100 ... 5000 bp covering most of each chromosome, with a substitution or deletion at 2% of the aligned sites */
+void writeMummer(const char *prefix, Rng_s *rng, int chr_n, int *lens) {
+    int o, c, s, end = 0, start = 0;
+    char suffix[32];
+    const char *bases = "ACGT.";
+    FILE *coord = NULL, *snps = NULL;
+
+    for(o = 1; o <= 3; o++) {
+        snprintf(suffix, sizeof(suffix), "_out%i.coord", o);
+        coord = openOut(prefix, suffix);
+        snprintf(suffix, sizeof(suffix), "_out%i.snps", o);
+        snps = openOut(prefix, suffix);
+        for(c = 0; c < chr_n; c++) {
+            for(start = 1; start < lens[c]; start = end + 1 + (int)(rngNext(rng) % 2000)) {
+                end = start + 100 + (int)(rngNext(rng) % 4901);
+                fprintf(coord, "%i\t%i\t%i\t%i\t%i\t%i\t95.00\tscaffold_%i\tq%i\n", start, end, start, end, end - start + 1, end - start + 1, c + 1, c + 1);
+                for(s = start; s <= end; s++) {
+                    if(rngUniform(rng) < 0.02)
+                        fprintf(snps, "%i\t%c\t%c\t%i\t0\t0\t1\t1\tscaffold_%i\tq%i\n", s, bases[rngNext(rng) % 4], bases[rngNext(rng) % 5], s, c + 1, c + 1);
+                }
+            }
+        }
+        fclose(coord);
+        fclose(snps);
+    }
+}
+
+/* 2 kb regions every 20 kb on average and every third position as a site */
+void writeRegions(const char *prefix, Rng_s *rng, int chr_n, int *lens) {
+    int c, pos = 0;
+    FILE *regions = NULL, *sites = NULL;
+
+    regions = openOut(prefix, "_regions.txt");
+    sites = openOut(prefix, "_sites.txt");
+    for(c = 0; c < chr_n; c++) {
+        for(pos = 1 + (int)(rngNext(rng) % 20000); pos < lens[c]; pos += 2000 + (int)(rngNext(rng) % 36000))
+            fprintf(regions, "scaffold_%i\t%i\t%i\n", c + 1, pos, pos + 2000);
+        for(pos = 1; pos < lens[c]; pos += 3)
+            fprintf(sites, "scaffold_%i\t%i\n", c + 1, pos);
+    }
+    fclose(regions);
+    fclose(sites);
+}
@@ -0,0 +1,98 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Runs one benchmark command and reports its wall time, throughput and peak memory as a tab-delimited line:
+ name, seconds, sites per second, MB of input per second and peak resident set size in MB.
+ The output of the command is discarded, its stderr is kept in the file given to -log.
+
+ Compiling: gcc -O2 bench/measure.c -o measure
+
+ Usage:
+ -name [string] Name of the benchmark.
+ -sites [int] Number of sites the command processes.
+ -bytes [int] Size of the input in bytes.
+ -log [file] File for the stderr of the command. Default /dev/null.
+ -- command and its arguments.
+
+ Example:
+ ./measure -name fst -sites 200000 -bytes 165000000 -- ./probs2fst -beagle bench.beagle -pop bench_pop1.txt -pop bench_pop2.txt
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+int main(int argc, char *argv[]) {
+    int i, status = 0, fd = 0;
+    long long site_n = 0, bytes = 0;
+    double sec = 0;
+    char *name = "run", *log = "/dev/null";
+    pid_t pid;
+    struct rusage usage;
+    struct timespec start, end;
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        } else if(strcmp(argv[i], "-name") == 0 && i + 1 < argc)
+            name = argv[++i];
+        else if(strcmp(argv[i], "-sites") == 0 && i + 1 < argc)
+            site_n = atoll(argv[++i]);
+        else if(strcmp(argv[i], "-bytes") == 0 && i + 1 < argc)
+            bytes = atoll(argv[++i]);
+        else if(strcmp(argv[i], "-log") == 0 && i + 1 < argc)
+            log = argv[++i];
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(i >= argc) {
+        fprintf(stderr, "\nERROR: No command given after --\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if((pid = fork()) < 0) {
+        fprintf(stderr, "\nERROR: Cannot start %s\n\n", argv[i]);
+        exit(EXIT_FAILURE);
+    }
+    if(pid == 0) {
+        if((fd = open("/dev/null", O_WRONLY)) >= 0)
+            dup2(fd, 1);
+        if((fd = open(log, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0)
+            dup2(fd, 2);
+        execvp(argv[i], argv + i);
+        _exit(127);
+    }
+    if(wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "\nERROR: %s failed, see %s\n\n", name, log);
+        exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sec = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("%s\t%.3f\t%.0f\t%.2f\t%.1f\n", name, sec, site_n / sec, bytes / sec / 1e6, usage.ru_maxrss / 1024.0);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#!/bin/bash
+#
+# Throughput benchmark of probs2fst, probs2pi, bg2meta_plot, make_est-sfs and probs2all on synthetic data from gen_data.
+# Builds the programs into bench/build, generates the data into bench/data_<sites>_<ind> (kept between runs)
+# and prints one line per benchmark: name, seconds, sites/sec, MB/sec of the main input and peak RSS in MB.
+#
+# Usage: bench/run_bench.sh [-sites int] [-ind int] [-missing double] [-threads int] [-out file] [-baseline file]
+#  -out writes the results to a file, which can later be given to -baseline to print the speedup of every benchmark.
+#
+# Example:
+#  bench/run_bench.sh -sites 1000000 -ind 100 -out before.txt
+#  bench/run_bench.sh -sites 1000000 -ind 100 -baseline before.txt
+
+set -e
+
+SITES=200000
+IND=50
+MISSING=0.1
+THREADS=4
+OUT=""
+BASELINE=""
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -sites) SITES=$2; shift 2 ;;
+        -ind) IND=$2; shift 2 ;;
+        -missing) MISSING=$2; shift 2 ;;
+        -threads) THREADS=$2; shift 2 ;;
+        -out) OUT=$2; shift 2 ;;
+        -baseline) BASELINE=$2; shift 2 ;;
+        *) echo "ERROR: Unknown argument '$1'" >&2; exit 1 ;;
+    esac
+done
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BIN=$ROOT/bench/build
+DATA=$ROOT/bench/data_${SITES}_${IND}_${MISSING}
+CFLAGS="-O2 -I$ROOT"
+LIBS="-lm -lz -lpthread"
+mkdir -p "$BIN" "$DATA"
+cd "$ROOT"
+
+echo "Compiling..." >&2
+gcc $CFLAGS probs2fst.c beagle.c bgzf.c interval.c jackknife.c lines.c partial.c samples.c seek.c simd.c sitebin.c stats.c window.c writer.c -o "$BIN/probs2fst" $LIBS
+gcc $CFLAGS probs2pi.c beagle.c bgzf.c interval.c jackknife.c lines.c partial.c samples.c seek.c simd.c sitebin.c stats.c window.c writer.c -o "$BIN/probs2pi" $LIBS
+gcc $CFLAGS bg2meta_plot.c beagle.c bgzf.c interval.c lines.c samples.c seek.c writer.c -o "$BIN/bg2meta_plot" $LIBS
+gcc $CFLAGS make_est-sfs.c beagle.c bgzf.c interval.c lines.c rng.c seek.c track.c writer.c -o "$BIN/make_est-sfs" $LIBS
+gcc $CFLAGS beagle2bin.c beagle.c bgzf.c seek.c -o "$BIN/beagle2bin" $LIBS
+gcc $CFLAGS probs2all.c -o "$BIN/probs2all"
+gcc $CFLAGS bench/gen_data.c rng.c writer.c -o "$BIN/gen_data" -lm
+gcc $CFLAGS bench/measure.c -o "$BIN/measure"
+
+B=$DATA/bench
+if [ ! -f "$B.beagle" ]; then
+    echo "Generating $SITES sites of $IND individuals..." >&2
+    "$BIN/gen_data" -out "$B" -sites $SITES -ind $IND -missing $MISSING
+fi
+BEAGLE=$(stat -c %s "$B.beagle")
+BG=$(stat -c %s "$B.bg")
+OUTGROUPS="-coord1 ${B}_out1.coord -coord2 ${B}_out2.coord -coord3 ${B}_out3.coord -div1 ${B}_out1.snps -div2 ${B}_out2.snps -div3 ${B}_out3.snps"
+M="$BIN/measure -sites $SITES"
+
+run() {
+    cd "$DATA"
+    {
+        $M -bytes $BEAGLE -name fst_sites -log fst_sites.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt
+        $M -bytes $BEAGLE -name fst_threads -log fst_threads.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -threads $THREADS
+        $M -bytes $BEAGLE -name fst_bin -log fst_bin.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -threads $THREADS -bin fst_sites.bin
+        $M -bytes $BEAGLE -name fst_genes -log fst_genes.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -genes ${B}_genes.txt -bp 1000
+        rm -f fst.cache fst.cache.idx
+        $M -bytes $BEAGLE -name fst_cache_write -log fst_cache_write.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -genes ${B}_genes.txt -bp 1000 -cache fst.cache
+        $M -bytes $BEAGLE -name fst_cache_read -log fst_cache_read.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -genes ${B}_genes.txt -bp 500 -cache fst.cache
+        $M -bytes $BEAGLE -name fst_windows -log fst_windows.log -- "$BIN/probs2fst" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -window 10000 -step 2000
+        $M -bytes $BEAGLE -name pi_sites -log pi_sites.log -- "$BIN/probs2pi" -beagle $B.beagle
+        $M -bytes $BEAGLE -name pi_genes -log pi_genes.log -- "$BIN/probs2pi" -beagle $B.beagle -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -genes ${B}_genes.txt -bp 1000
+        $M -bytes $BG -name bg2meta_plot -log bg2meta_plot.log -- "$BIN/bg2meta_plot" -bg $B.bg -bed ${B}_genes.bed -bp 1000 -min 2
+        $M -bytes $BG -name bg2meta_plot_threads -log bg2meta_plot_threads.log -- "$BIN/bg2meta_plot" -bg $B.bg -bed ${B}_genes.bed -bp 1000 -min 2 -threads $THREADS
+        $M -bytes $BEAGLE -name est-sfs -log est-sfs.log -- "$BIN/make_est-sfs" $OUTGROUPS -beagle $B.beagle
+        $M -bytes $BEAGLE -name est-sfs_stream -log est-sfs_stream.log -- "$BIN/make_est-sfs" $OUTGROUPS -stream -beagle $B.beagle
+        $M -bytes $BEAGLE -name est-sfs_regions -log est-sfs_regions.log -- "$BIN/make_est-sfs" $OUTGROUPS -beagle $B.beagle -region ${B}_regions.txt -sites ${B}_sites.txt
+        $M -bytes $BEAGLE -name all_fst_pi_sfs -log all.log -- "$BIN/probs2all" -beagle $B.beagle -fst -pop ${B}_pop1.txt -pop ${B}_pop2.txt -pop ${B}_pop3.txt -genes ${B}_genes.txt -bp 1000 -out all_fst.txt -pi -genes ${B}_genes.txt -bp 1000 -out all_pi.txt -sfs $OUTGROUPS
+    }
+}
+
+echo "Running..." >&2
+RESULTS=$(run)
+HEADER="name\tseconds\tsites_per_sec\tMB_per_sec\tpeak_rss_MB"
+if [ -n "$OUT" ]; then
+    printf "$HEADER\n%s\n" "$RESULTS" > "$OUT"
+fi
+if [ -n "$BASELINE" ]; then
+    printf "$HEADER\tspeedup\n"
+    awk -F'\t' 'NR == FNR { if(FNR > 1) base[$1] = $3; next } { printf "%s\t%s\n", $0, ($1 in base && base[$1] > 0) ? sprintf("%.2f", $3 / base[$1]) : "NA" }' "$BASELINE" - <<< "$RESULTS"
+else
+    printf "$HEADER\n%s\n" "$RESULTS"
+fi
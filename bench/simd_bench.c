@@ -0,0 +1,107 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Micro-benchmark of the dosage kernels in simd.c. Sums random probabilities of n individuals (10% missing) repeatedly with every kernel the CPU supports
+ and reports the time per site, the speedup over the scalar loop and whether the sums are bit-identical to it.
+
+ Compiling: gcc -O2 -I. bench/simd_bench.c simd.c -o simd_bench
+
+ Usage:
+ -ind [int] Number of individuals per site. Default 1000.
+ -sites [int] Number of sites summed per kernel. Default 1000000.
+
+ Example:
+ ./simd_bench -ind 200 -sites 5000000
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "simd.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+double runKernel(double *p1, double *p2, char *miss, int ind_n, int site_n, double *check);
+
+int main(int argc, char *argv[]) {
+    int i, level, ind_n = 1000, site_n = 1000000;
+    double a, base = 0, check = 0, ref = 0, *p1 = NULL, *p2 = NULL;
+    char *miss = NULL;
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-ind") == 0 && i + 1 < argc)
+            ind_n = atoi(argv[++i]);
+        else if(strcmp(argv[i], "-sites") == 0 && i + 1 < argc)
+            site_n = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(ind_n < 1 || site_n < 1) {
+        fprintf(stderr, "\nERROR: -ind and -sites need to be positive!\n\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if((p1 = malloc(ind_n * sizeof(double))) == NULL || (p2 = malloc(ind_n * sizeof(double))) == NULL || (miss = malloc(ind_n)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    srand(1);
+    for(i = 0; i < ind_n; i++) {
+        a = (double)rand() / RAND_MAX;
+        p1[i] = a * (double)rand() / RAND_MAX;
+        p2[i] = a - p1[i];
+        miss[i] = rand() % 10 == 0;
+    }
+
+    printf("kernel\tns_per_site\tspeedup\tdose_sum\tidentical\n");
+    for(level = SIMD_SCALAR; level <= SIMD_AVX512; level++) {
+        if(simdSet(level) != level)
+            continue;
+        a = runKernel(p1, p2, miss, ind_n, site_n, &check);
+        if(level == SIMD_SCALAR) {
+            base = a;
+            ref = check;
+        }
+        printf("%s\t%.2f\t%.2f\t%f\t%s\n", simdName(), a * 1e9 / site_n, base / a, check, memcmp(&check, &ref, sizeof(double)) == 0 ? "yes" : "no");
+    }
+
+    free(p1);
+    free(p2);
+    free(miss);
+
+    return 0;
+}
+
+/* Returns the seconds taken to sum site_n sites */
+double runKernel(double *p1, double *p2, char *miss, int ind_n, int site_n, double *check) {
+    int i;
+    double sum = 0;
+    struct timespec start, end;
+    Dose_s dose;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < site_n; i++) {
+        dose = sumDosage(p1, p2, miss, ind_n);
+        sum += dose.dose + dose.het + dose.n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *check = sum / site_n;
+
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
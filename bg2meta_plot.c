@@ -19,39 +19,98 @@
  Locations are shown as follows: -1 to 0 upstream, 0 to 1 gene/TE body, 1 to 2 downstream.
  Methylation proportions are assumed to be in combined BEDGRAPH format, created with bedtools unionbedg (example: bedtools unionbedg -header -filler . -names ind0 ind1 ind2 -i met0.bg met1.bg met2.bg > out.bg).
 
- Compiling: gcc bg2meta_plot.c -o bg2meta_plot -lm
+ Compiling: gcc bg2meta_plot.c beagle.c bgzf.c interval.c lines.c samples.c seek.c writer.c -o bg2meta_plot -lm -lz -lpthread
 
  Usage:
- -bg [file] Methylation propotions in BEDGRAPH format. Needs to be sorted based on chrom and start position.
- -bed [file] Bed file listing regions to use (required fields: chrom, start, end, name, score, strand). Needs to be sorted based on chrom and start position.
- -inds [file] File listing individuals to include. Optional.
+ -bg [label=file] Methylation propotions in BEDGRAPH format. Needs to be sorted based on chrom and start position. Can be gzip or BGZF compressed. Can be used >= 1 times (e.g. once per methylation context).
+ -bed [label=file] Bed file listing regions to use (required fields: chrom, start, end, name, score, strand). Does not need to be sorted. Can be used >= 1 times, every file is updated during the same pass over each bedGraph.
+ With more than one -bg or -bed the labels (default the file name) are added as extra columns: per-site lines end with the bed and bg labels, -bins tables start with them. Labels cannot contain '=', a file name containing '=' is used as is when that file exists.
+ -inds [file] File listing individuals to include. Duplicated names and names missing from the header are reported. Optional.
  -bp [int] Distance around regions to include. Default 1000.
  -min [int] Minimum number of individuals required to consider a site. Default 1.
+ -bins [int] Number of bins between -1 and 2. Sites are binned on the fly and only the average methylation of each bin is printed instead of one line per site and region. Optional.
+ -group [strand|feature] Print a separate profile for each strand or each region with -bins. Optional.
+ -threads [int] Number of threads used for inflating BGZF input and for parsing and overlapping the bedGraphs. The input is split into blocks of lines that are processed in parallel and merged in input order,
+    so the output is identical to a single-threaded run. With -inds the header has to be the first line of the file. Default 1.
 
  Example:
  ./bg2meta_plot -bg test.bg -bed genes.bed -inds inds.txt -bp 1000 -min 2 > out.txt
+ ./bg2meta_plot -bg test.bg -bed genes.bed -bins 60 -group strand > profile.txt
+ ./bg2meta_plot -bg CG=cg.bg -bg CHH=chh.bg -bed genes=genes.bed -bed TEs=tes.bed -bins 60 > profiles.txt
+ ./bg2meta_plot -bg chh.bg -bed genes.bed -bins 60 -threads 8 > profile.txt
 */
 
 #include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "beagle.h"
+#include "bgzf.h"
+#include "interval.h"
+#include "lines.h"
+#include "samples.h"
+#include "writer.h"
 #define merror "\nERROR: System out of memory\n\n"
+#define CHUNK 1048576
 
 typedef struct {
     double start, end;
+    int set; /* -bed the region came from */
     char str, chr[50], id[100];
 } bed_s;
 
+/* The bedGraph being read: regions, selected columns and output settings, shared by the serial loop and the -threads workers */
+typedef struct {
+    Index_s *index;
+    bed_s *beds;
+    char *bg_label, **set_labels;
+    int *cols, col_n, ind_n, min, bins, group, labels;
+    double bp;
+} Bg_s;
+
+/* A site added to a bin (-1 without -bins) and/or the body methylation. Workers collect them and the calling thread adds them in input order. */
+typedef struct {
+    int bin, body;
+    double met, met_i;
+} Hit_s;
+
+typedef struct {
+    int state, hit_n, hit_size; /* state: 0 free, 1 read, 2 processed */
+    size_t len, size, out_len, out_size;
+    char *lines, *out;
+    Hit_s *hits;
+} Chunk_s;
+
+typedef struct {
+    FILE *file;
+    Bg_s *bg;
+    Chunk_s *chunks;
+    char *carry; /* start of a line that did not fit in the previous chunk */
+    size_t carry_n, carry_size;
+    int chunk_n, eof;
+    long read_i, work_i;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Pipe_s;
+
 void openFiles(int argc, char *argv[]);
-bed_s *readBed(FILE *bed_file, int *n);
-char **readInds(FILE *inds_file, int *n);
-void readBg(FILE *bg_file, bed_s *beds, char **inds, int min, int bed_n, int ind_n, double bp);
+bed_s *readBed(FILE *bed_file, bed_s *list, int *n, int set);
+void readBg(FILE *bg_file, Index_s *index, bed_s *beds, Samples_s *inds, char *bg_label, char **set_labels, int min, int bed_n, int set_n, int ind_n, double bp, int bins, int group, int labels, int threads);
+void readHeader(Bg_s *bg, Samples_s *inds, char *line, char *end);
+int readSite(Bg_s *bg, char *line, char *end, int **hits, int *hit_size, int *pos, double *met, double *met_i);
+double siteDist(bed_s *bed, int pos, double bp, int *body);
+int siteBin(Bg_s *bg, int hit, double dist);
+void readThreads(Bg_s *bg, FILE *bg_file, Writer_s *out, char *first, size_t first_n, double *sum, long long *count, double *bmet, double *bmet_i, int threads);
+void *readChunks(void *arg);
+void *siteChunks(void *arg);
+size_t copyStr(char *s, const char *src);
+void printBins(bed_s *beds, double *sum, long long *count, char *bg_label, char **set_labels, int bins, int group, int group_n, int labels);
+char *splitLabel(char *arg, char **file);
 int isNumeric(const char *s);
-void lineTerminator(char *line);
 
 int main(int argc, char *argv[]) {
     int second = 0, minute = 0, hour = 0;
@@ -77,37 +136,50 @@ int main(int argc, char *argv[]) {
 }
 
 void openFiles(int argc, char *argv[]) {
-    int i, bed_n = 0, ind_n = 0, min = 1;
+    int i, bed_n = 0, ind_n = 0, min = 1, bins = 0, group = 0, bg_n = 0, set_n = 0, threads = 1;
     double bp = 1000;
-    char **inds;
+    char *file = NULL, *ind_path = NULL, **bg_paths = NULL, **bg_labels = NULL, **set_labels = NULL;
     bed_s *beds = NULL;
-    FILE *bg_file = NULL, *bed_file = NULL, *ind_file = NULL;
+    Samples_s *inds = NULL;
+    Index_s *index = NULL;
+    FILE **bg_files = NULL, *bed_file = NULL, *ind_file = NULL;
 
     fprintf(stderr, "\nParameters:\n");
 
     for(i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-bg") == 0) {
-            if((bg_file = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+            if((bg_paths = realloc(bg_paths, (bg_n + 1) * sizeof(char *))) == NULL || (bg_labels = realloc(bg_labels, (bg_n + 1) * sizeof(char *))) == NULL) {
+                fprintf(stderr, merror);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-bg %s\n", argv[i]);
+            fprintf(stderr, "\t-bg %s\n", argv[++i]);
+            bg_labels[bg_n] = splitLabel(argv[i], &file);
+            bg_paths[bg_n] = file;
+            bg_n++;
         }
 
         else if(strcmp(argv[i], "-bed") == 0) {
-            if((bed_file = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+            if((set_labels = realloc(set_labels, (set_n + 1) * sizeof(char *))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-bed %s\n", argv[++i]);
+            set_labels[set_n] = splitLabel(argv[i], &file);
+            if((bed_file = bgzfOpen(file, 1)) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", file);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-bed %s\n", argv[i]);
+            beds = readBed(bed_file, beds, &bed_n, set_n);
+            set_n++;
         }
 
         else if(strcmp(argv[i], "-inds") == 0) {
-            if((ind_file = fopen(argv[++i], "r")) == NULL) {
+            if((ind_file = bgzfOpen(argv[++i], 1)) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
             fprintf(stderr, "\t-inds %s\n", argv[i]);
+            ind_path = argv[i];
         }
 
         else if(strcmp(argv[i], "-bp") == 0) {
@@ -122,6 +194,31 @@ void openFiles(int argc, char *argv[]) {
             fprintf(stderr, "\t-min %s\n", argv[i]);
         }
 
+        else if(strcmp(argv[i], "-bins") == 0) {
+            if(isNumeric(argv[++i]))
+                bins = atoi(argv[i]);
+            fprintf(stderr, "\t-bins %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-group") == 0) {
+            i++;
+            if(argv[i] != NULL && strcmp(argv[i], "strand") == 0)
+                group = 1;
+            else if(argv[i] != NULL && strcmp(argv[i], "feature") == 0)
+                group = 2;
+            else {
+                fprintf(stderr, "\nERROR: -group needs to be strand or feature\n\n");
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-group %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-threads") == 0) {
+            if(isNumeric(argv[++i]))
+                threads = atoi(argv[i]);
+            fprintf(stderr, "\t-threads %s\n", argv[i]);
+        }
+
         else {
             fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
             exit(EXIT_FAILURE);
@@ -130,241 +227,557 @@ void openFiles(int argc, char *argv[]) {
 
     fprintf(stderr, "\n");
 
-    if(bg_file == NULL || bed_file == NULL) {
+    if(bg_n == 0 || set_n == 0) {
         fprintf(stderr, "\nERROR: -bg [file] and -bed [file] are required!\n");
         exit(EXIT_FAILURE);
     }
+    if(group > 0 && bins <= 0) {
+        fprintf(stderr, "\nERROR: -group requires -bins!\n");
+        exit(EXIT_FAILURE);
+    }
+    if((bg_files = malloc(bg_n * sizeof(FILE *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < bg_n; i++) {
+        if((bg_files[i] = bgzfOpen(bg_paths[i], threads)) == NULL) {
+            fprintf(stderr, "\nERROR: Cannot open file %s\n\n", bg_paths[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    beds = readBed(bed_file, &bed_n);
-    if(ind_file != NULL)
-        inds = readInds(ind_file, &ind_n);
+    if(ind_file != NULL) {
+        inds = samplesInit();
+        ind_n = samplesRead(inds, ind_file, 0, ind_path);
+    }
 
-    readBg(bg_file, beds, inds, min, bed_n, ind_n, bp);
+    index = indexInit();
+    for(i = 0; i < bed_n; i++)
+        indexAdd(index, indexChr(index, beds[i].chr), (int)(beds[i].start - bp), (int)(beds[i].end + bp), i);
+    indexBuild(index);
+
+    for(i = 0; i < bg_n; i++)
+        readBg(bg_files[i], index, beds, inds, bg_labels[i], set_labels, min, bed_n, set_n, ind_n, bp, bins, group, bg_n > 1 || set_n > 1, threads);
+
+    indexFree(index);
+    if(inds != NULL)
+        samplesFree(inds);
+    free(beds);
+    free(bg_files);
+    free(bg_paths);
+    free(bg_labels);
+    free(set_labels);
 }
 
-bed_s *readBed(FILE *bed_file, int *n) {
-    int i, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line = NULL;
-    bed_s *list = NULL;
-
-    while((c = fgetc(bed_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
-        }
-    }
+/* Splits label=file given to -bg and -bed at the first '=', so a label cannot contain '='. An argument that is an existing file is taken as a plain file name
+   even if it contains '=', and the file name is used as the label. */
+char *splitLabel(char *arg, char **file) {
+    char *eq = NULL;
 
-    rewind(bed_file);
-
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
-        fprintf(stderr, merror);
+    if(arg == NULL) {
+        fprintf(stderr, "\nERROR: Missing file name\n\n");
         exit(EXIT_FAILURE);
     }
-    if((list = malloc(line_i * sizeof(bed_s))) == NULL) {
-        fprintf(stderr, merror);
-        exit(EXIT_FAILURE);
+    if(access(arg, F_OK) == 0 || (eq = strchr(arg, '=')) == NULL) {
+        *file = arg;
+        return arg;
     }
+    *eq = '\0';
+    *file = eq + 1;
 
-    while(fgets(line, maxchar + 1, bed_file) != NULL) {
-        if(line[0] == '\n')
+    return arg;
+}
+
+bed_s *readBed(FILE *bed_file, bed_s *list, int *n, int set) {
+    int size = *n;
+    char *line = NULL, *fields[6];
+    Lines_s *lines = NULL;
+
+    lines = linesOpen(bed_file);
+    while((line = linesNext(lines)) != NULL) {
+        if(linesSplit(line, fields, 6) < 6)
             continue;
-        lineTerminator(line);
-        strncpy(list[*n].chr, strtok(line, "\t"), 49);
-        list[*n].start = atof(strtok(NULL, "\t")) + 1;
-        list[*n].end = atof(strtok(NULL, "\t"));
-        strncpy(list[*n].id, strtok(NULL, "\t"), 99);
-        strtok(NULL, "\t");
-        list[*n].str = strtok(NULL, "\t")[0];
+        list = linesGrow(list, *n, &size, sizeof(bed_s));
+        strncpy(list[*n].chr, fields[0], 49);
+        list[*n].chr[49] = '\0';
+        list[*n].start = atof(fields[1]) + 1;
+        list[*n].end = atof(fields[2]);
+        strncpy(list[*n].id, fields[3], 99);
+        list[*n].id[99] = '\0';
+        list[*n].str = fields[5][0];
+        list[*n].set = set;
         *n = *n + 1;
     }
-
-    free(line);
-    fclose(bed_file);
+    linesClose(lines);
 
     return list;
 }
 
-char **readInds(FILE *ind_file, int *n) {
-    int i = 0, char_i = 0, maxchar = 0, line_i = 0;
-    char c, *line, **list;
-
-    while((c = fgetc(ind_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
+void readBg(FILE *bg_file, Index_s *index, bed_s *beds, Samples_s *inds, char *bg_label, char **set_labels, int min, int bed_n, int set_n, int ind_n, double bp, int bins, int group, int labels, int threads) {
+    int i, b, body = 0, pos = 0, hit_n = 0, hit_size = 0, group_n = 1, *hits = NULL;
+    long long *count = NULL;
+    double dist = 0, met = 0, met_i = 0, bmet = 0, bmet_i = 0, *sum = NULL;
+    char *line = NULL, *end = NULL;
+    size_t len = 0;
+    ssize_t read;
+    Bg_s bg = {0};
+    Writer_s *out = NULL;
+
+    bg.index = index;
+    bg.beds = beds;
+    bg.bg_label = bg_label;
+    bg.set_labels = set_labels;
+    bg.ind_n = ind_n;
+    bg.min = min;
+    bg.bins = bins;
+    bg.group = group;
+    bg.labels = labels;
+    bg.bp = bp;
+    out = writerOpen(stdout);
+
+    if(bins > 0) {
+        group_n = set_n;
+        if(group == 1)
+            group_n = 2 * set_n;
+        else if(group == 2)
+            group_n = bed_n;
+        if((sum = calloc((size_t)group_n * bins, sizeof(double))) == NULL || (count = calloc((size_t)group_n * bins, sizeof(long long))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
         }
     }
 
-    rewind(ind_file);
-
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
-        fprintf(stderr, merror);
-        exit(EXIT_FAILURE);
+    while((read = getline(&line, &len, bg_file)) != -1) {
+        if(line[0] == '\n')
+            continue;
+        for(end = line + read; end > line && (end[-1] == '\n' || end[-1] == '\r'); end--)
+            ;
+        *end = '\0';
+        if(strncmp(line, "chrom\t", 6) == 0) {
+            if(ind_n > 0)
+                readHeader(&bg, inds, line, end);
+            continue;
+        }
+        if(ind_n > 0 && bg.cols == NULL) {
+            fprintf(stderr, "\nERROR: -inds requires a header line in the BEDGRAPH file (bedtools unionbedg -header)\n\n");
+            exit(EXIT_FAILURE);
+        }
+        if(threads > 1) {
+            /* the rest of the file, starting with this line, is read in blocks */
+            readThreads(&bg, bg_file, out, line, end - line, sum, count, &bmet, &bmet_i, threads);
+            break;
+        }
+        if((hit_n = readSite(&bg, line, end, &hits, &hit_size, &pos, &met, &met_i)) == 0)
+            continue;
+        for(i = 0; i < hit_n; i++) {
+            dist = siteDist(&beds[hits[i]], pos, bp, &body);
+            if(body) {
+                bmet += met;
+                bmet_i += met_i;
+            }
+            if(bins > 0) {
+                b = siteBin(&bg, hits[i], dist);
+                sum[b] += met / met_i;
+                count[b]++;
+            } else {
+                writerFloat(out, dist, 6);
+                writerChar(out, '\t');
+                writerFloat(out, met / met_i, 6);
+                writerChar(out, '\t');
+                writerStr(out, beds[hits[i]].id);
+                if(labels) {
+                    writerChar(out, '\t');
+                    writerStr(out, set_labels[beds[hits[i]].set]);
+                    writerChar(out, '\t');
+                    writerStr(out, bg_label);
+                }
+                writerChar(out, '\n');
+            }
+        }
     }
-    if((list = malloc((line_i + 1) * sizeof(char *))) == NULL) {
+    writerClose(out);
+    if(bins > 0)
+        printBins(beds, sum, count, bg_label, set_labels, bins, group, group_n, labels);
+    if(labels)
+        fprintf(stderr, "Average body methylation in %s = %.2f\n", bg_label, bmet / bmet_i);
+    else
+        fprintf(stderr, "Average body methylation = %.2f\n", bmet / bmet_i);
+
+    free(sum);
+    free(count);
+    free(hits);
+    free(bg.cols);
+    free(line);
+    fclose(bg_file);
+}
+
+/* Matches the individuals of a header line (bedtools unionbedg -header) against -inds */
+void readHeader(Bg_s *bg, Samples_s *inds, char *line, char *end) {
+    int i = 1, n = 1;
+    char *temp = NULL;
+
+    for(temp = line; (temp = memchr(temp, '\t', end - temp)) != NULL; temp++)
+        n++;
+    free(bg->cols);
+    if((bg->cols = malloc(n * sizeof(int))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    for(i = 0; i < line_i + 1; i++) {
-        if((list[i] = malloc((maxchar + 1) * sizeof(char))) == NULL) {
-            fprintf(stderr, merror);
-            exit(EXIT_FAILURE);
+    bg->col_n = 0;
+    n = 0;
+    samplesClear(inds);
+    temp = strtok(line, "\t");
+    while(temp != NULL) {
+        if(i > 3) {
+            if(samplesColumn(inds, temp, n) >= 0)
+                bg->cols[bg->col_n++] = n;
+            n++;
         }
-    }
-    i = 0;
-    while(fgets(line, maxchar + 1, ind_file) != NULL) {
-        if(line[0] == '\n')
-            continue;
-        lineTerminator(line);
-        strcpy(list[i], line);
+        temp = strtok(NULL, "\t");
         i++;
-        *n = *n + 1;
     }
-    list[i][0] = '\0';
+    samplesMissing(inds, "BEDGRAPH");
+}
 
-    free(line);
-    fclose(ind_file);
+/* Parses chrom and start, and the selected proportion columns of sites that overlap a region.
+   Returns the number of overlapping regions (in hits), 0 if there are none or fewer than -min individuals have data. */
+int readSite(Bg_s *bg, char *line, char *end, int **hits, int *hit_size, int *pos, double *met, double *met_i) {
+    int i, n, hit_n = 0;
+    char *field = NULL, *temp = NULL, *scan = NULL;
 
-    return list;
+    *met = 0;
+    *met_i = 0;
+    if((field = memchr(line, '\t', end - line)) == NULL || (temp = memchr(field + 1, '\t', end - field - 1)) == NULL)
+        return 0;
+    *field = '\0';
+    *pos = atoi(++temp);
+    if((hit_n = indexFind(bg->index, indexGetChr(bg->index, line), *pos, *pos, hits, hit_size)) == 0)
+        return 0;
+    temp = memchr(temp, '\t', end - temp);
+    for(i = 0, n = 0; temp != NULL && (bg->ind_n == 0 || i < bg->col_n); i++) {
+        /* temp is at the tab before column n */
+        for(; bg->ind_n > 0 && n < bg->cols[i] && temp != NULL; n++)
+            temp = memchr(temp + 1, '\t', end - temp - 1);
+        if(temp == NULL)
+            break;
+        field = temp + 1;
+        if(*field != '.' && *field != '\t' && *field != '\0') {
+            scan = field;
+            *met += beagleScan(&scan) / 100;
+            *met_i += 1;
+        }
+        if(bg->ind_n == 0) {
+            temp = memchr(field, '\t', end - field);
+            n++;
+        }
+    }
+
+    return *met_i >= bg->min ? hit_n : 0;
 }
 
-void readBg(FILE *bg_file, bed_s *beds, char **inds, int min, int bed_n, int ind_n, double bp) {
-    int i, j, k = 0, l = 0, n = 0, ok = 0, pos = 0, bed_i = 0, *mlist;
-    double dist = 0, met = 0, met_i = 0, bmet = 0, bmet_i = 0;
-    char chr[50], *line = NULL, *temp = NULL;
-    size_t len = 0;
-    ssize_t read;
+/* Location of a site on the -1 to 2 scale of a region. body is set to 1 for sites within the region. */
+double siteDist(bed_s *bed, int pos, double bp, int *body) {
+    *body = 0;
+    if(pos < bed->start && bed->str == '+')
+        return (pos - bed->start) / bp;
+    else if(pos < bed->start && bed->str == '-')
+        return 1 + (bed->start - pos) / bp;
+    else if(pos > bed->end && bed->str == '+')
+        return 1 + (pos - bed->end) / bp;
+    else if(pos > bed->end && bed->str == '-')
+        return (bed->end - pos) / bp;
+    *body = 1;
+
+    return (bed->end - pos) / (bed->end - bed->start + 1);
+}
 
-    while((read = getline(&line, &len, bg_file)) != -1) {
-        if(line[0] == '\n')
+/* Bin of a site in region hit, offset by the profile (-bed, strand or region) it belongs to */
+int siteBin(Bg_s *bg, int hit, double dist) {
+    int b;
+
+    b = (int)floor((dist + 1) / 3 * bg->bins);
+    if(b < 0)
+        b = 0;
+    else if(b >= bg->bins)
+        b = bg->bins - 1;
+    if(bg->group == 1)
+        b += (2 * bg->beds[hit].set + (bg->beds[hit].str == '-')) * bg->bins;
+    else if(bg->group == 2)
+        b += hit * bg->bins;
+    else
+        b += bg->beds[hit].set * bg->bins;
+
+    return b;
+}
+
+/* Reader, workers and writer of the -threads mode. The reader splits the bedGraph into blocks of whole lines, workers overlap them with the regions and format the per-site lines,
+   and the calling thread writes the lines and adds the bins and body methylation of each block in input order, so the results are identical to a serial run. */
+void readThreads(Bg_s *bg, FILE *bg_file, Writer_s *out, char *first, size_t first_n, double *sum, long long *count, double *bmet, double *bmet_i, int threads) {
+    int i;
+    long out_i = 0;
+    pthread_t reader, *workers = NULL;
+    Hit_s *hit = NULL;
+    Chunk_s *chunk = NULL;
+    Pipe_s pipe = {0};
+
+    pipe.file = bg_file;
+    pipe.bg = bg;
+    pipe.chunk_n = 4 * threads;
+    pipe.carry_size = first_n + 1;
+    if((pipe.chunks = calloc(pipe.chunk_n, sizeof(Chunk_s))) == NULL || (workers = malloc(threads * sizeof(pthread_t))) == NULL || (pipe.carry = malloc(pipe.carry_size)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    /* the line already read by the serial loop starts the first block */
+    memcpy(pipe.carry, first, first_n);
+    pipe.carry[first_n] = '\n';
+    pipe.carry_n = first_n + 1;
+    writerFlush(out);
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
+    pthread_create(&reader, NULL, readChunks, &pipe);
+    for(i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, siteChunks, &pipe);
+
+    pthread_mutex_lock(&pipe.lock);
+    while(1) {
+        chunk = &pipe.chunks[out_i % pipe.chunk_n];
+        if(chunk->state != 2) {
+            if(pipe.eof && out_i == pipe.read_i)
+                break;
+            pthread_cond_wait(&pipe.cond, &pipe.lock);
             continue;
-        lineTerminator(line);
-        temp = strtok(line, "\t");
-        i = 1;
-        n = 0;
-        ok = 0;
-        met = 0;
-        met_i = 0;
-        if(strcmp(temp, "chrom") == 0) {
-            if(ind_n == 0)
-                continue;
-            if((mlist = malloc(len * sizeof(int))) == NULL) {
-                fprintf(stderr, merror);
-                exit(EXIT_FAILURE);
+        }
+        pthread_mutex_unlock(&pipe.lock);
+        fwrite(chunk->out, 1, chunk->out_len, stdout);
+        for(i = 0; i < chunk->hit_n; i++) {
+            hit = &chunk->hits[i];
+            if(hit->body) {
+                *bmet += hit->met;
+                *bmet_i += hit->met_i;
             }
-            while(temp != NULL) {
-                if(i > 3) {
-                    for(j = 0; j < ind_n; j++) {
-                        if(strcmp(temp, inds[j]) == 0)
-                            break;
-                    }
-                    if(j == ind_n)
-                        mlist[n] = 0;
-                    else
-                        mlist[n] = 1;
-                    n++;
-                }
-                temp = strtok(NULL, "\t");
-                i++;
+            if(hit->bin >= 0) {
+                sum[hit->bin] += hit->met / hit->met_i;
+                count[hit->bin]++;
             }
+        }
+        pthread_mutex_lock(&pipe.lock);
+        chunk->state = 0;
+        out_i++;
+        pthread_cond_broadcast(&pipe.cond);
+    }
+    pthread_mutex_unlock(&pipe.lock);
+
+    pthread_join(reader, NULL);
+    for(i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+    for(i = 0; i < pipe.chunk_n; i++) {
+        free(pipe.chunks[i].lines);
+        free(pipe.chunks[i].out);
+        free(pipe.chunks[i].hits);
+    }
+    free(pipe.chunks);
+    free(pipe.carry);
+    free(workers);
+    pthread_mutex_destroy(&pipe.lock);
+    pthread_cond_destroy(&pipe.cond);
+}
+
+/* Fills free chunks with CHUNK bytes of input, cut after the last complete line. The rest is carried over to the next chunk. */
+void *readChunks(void *arg) {
+    size_t n, len;
+    char *nl = NULL;
+    Pipe_s *pipe = arg;
+    Chunk_s *chunk = NULL;
+
+    pthread_mutex_lock(&pipe->lock);
+    while(1) {
+        chunk = &pipe->chunks[pipe->read_i % pipe->chunk_n];
+        if(chunk->state != 0) {
+            pthread_cond_wait(&pipe->cond, &pipe->lock);
             continue;
         }
-        while(temp != NULL) {
-            if(i == 1)
-                strncpy(chr, temp, 49);
-            else if(i == 3) {
-                pos = atoi(temp);
-                while(bed_i < bed_n) {
-                    if(strcmp(chr, beds[bed_i].chr) == 0) {
-                        if(pos <= beds[bed_i].end + bp && pos >= beds[bed_i].start - bp) {
-                            ok = 1;
-                            break;
-                        } else if(pos < beds[bed_i].start - bp)
-                            break;
-                    } else if(strcmp(chr, beds[bed_i].chr) < 0)
-                        break;
-                    bed_i++;
+        pthread_mutex_unlock(&pipe->lock);
+        len = pipe->carry_n;
+        nl = NULL;
+        while(nl == NULL) {
+            if(chunk->size < len + CHUNK + 1) {
+                chunk->size = 2 * (len + CHUNK + 1);
+                if((chunk->lines = realloc(chunk->lines, chunk->size)) == NULL) {
+                    fprintf(stderr, merror);
+                    exit(EXIT_FAILURE);
                 }
-                if(ok == 0)
-                    break;
-            } else if(i > 3) {
-                if(temp[0] != '.') {
-                    if(ind_n > 0) {
-                        if(mlist[n] == 1) {
-                            met += atof(temp) / 100;
-                            met_i++;
-                        }
-                    } else {
-                        met += atof(temp) / 100;
-                        met_i++;
-                    }
+            }
+            if(len == pipe->carry_n)
+                memcpy(chunk->lines, pipe->carry, len);
+            if((n = fread(chunk->lines + len, 1, CHUNK, pipe->file)) == 0)
+                break;
+            for(nl = chunk->lines + len + n - 1; nl >= chunk->lines + len && *nl != '\n'; nl--)
+                ;
+            if(nl < chunk->lines + len)
+                nl = NULL;
+            len += n;
+        }
+        if(nl == NULL) {
+            /* end of file */
+            pipe->carry_n = 0;
+            if(len > 0 && chunk->lines[len - 1] != '\n')
+                chunk->lines[len++] = '\n';
+        } else {
+            pipe->carry_n = chunk->lines + len - nl - 1;
+            if(pipe->carry_n > pipe->carry_size) {
+                pipe->carry_size = 2 * pipe->carry_n;
+                if((pipe->carry = realloc(pipe->carry, pipe->carry_size)) == NULL) {
+                    fprintf(stderr, merror);
+                    exit(EXIT_FAILURE);
                 }
-                n++;
             }
-            temp = strtok(NULL, "\t");
-            i++;
+            memcpy(pipe->carry, nl + 1, pipe->carry_n);
+            len = nl + 1 - chunk->lines;
         }
-        if(temp == NULL && met_i >= min) {
-            for(i = l; i < bed_n; i++) {
-                if(strcmp(chr, beds[i].chr) == 0) {
-                    if(pos <= beds[i].end + bp && pos >= beds[i].start - bp) {
-                        if(pos < beds[i].start && beds[i].str == '+')
-                            dist = (pos - beds[i].start) / bp;
-                        else if(pos < beds[i].start && beds[i].str == '-')
-                            dist = 1 + (beds[i].start - pos) / bp;
-                        else if(pos > beds[i].end && beds[i].str == '+')
-                            dist = 1 + (pos - beds[i].end) / bp;
-                        else if(pos > beds[i].end && beds[i].str == '-')
-                            dist = (beds[i].end - pos) / bp;
-                        else {
-                            dist = (beds[i].end - pos) / (beds[i].end - beds[i].start + 1);
-                            bmet += met;
-                            bmet_i += met_i;
-                        }
-                        printf("%f\t%f\t%s\n", dist, met / met_i, beds[i].id);
-                    } else if(pos < beds[i].start - bp) {
-                        l = i;
-                        for(j = 1; j <= i; j++) {
-                            if(pos <= beds[i - j].end + bp && pos >= beds[i - j].start - bp)
-                                l = i - j;
-                            else if(pos > beds[i - j].end + bp) {
-                                if(i - j - 1 >= 0) {
-                                    if(pos > beds[i - j - 1].end + bp)
-                                        break;
-                                } else
-                                    break;
-                            }
+        chunk->len = len;
+        pthread_mutex_lock(&pipe->lock);
+        if(len == 0) {
+            pipe->eof = 1;
+            pthread_cond_broadcast(&pipe->cond);
+            break;
+        }
+        chunk->state = 1;
+        pipe->read_i++;
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    pthread_mutex_unlock(&pipe->lock);
+
+    return NULL;
+}
+
+/* Each worker takes the next unprocessed chunk and overlaps its sites with its own hit list */
+void *siteChunks(void *arg) {
+    int i, body = 0, pos = 0, hit_n = 0, hit_size = 0, *hits = NULL;
+    size_t need = 0;
+    double dist = 0, met = 0, met_i = 0;
+    char *line = NULL, *nl = NULL, *end = NULL;
+    Pipe_s *pipe = arg;
+    Bg_s *bg = pipe->bg;
+    Chunk_s *chunk = NULL;
+    Hit_s *hit = NULL;
+    bed_s *bed = NULL;
+
+    pthread_mutex_lock(&pipe->lock);
+    while(1) {
+        if(pipe->work_i == pipe->read_i) {
+            if(pipe->eof)
+                break;
+            pthread_cond_wait(&pipe->cond, &pipe->lock);
+            continue;
+        }
+        chunk = &pipe->chunks[pipe->work_i % pipe->chunk_n];
+        pipe->work_i++;
+        pthread_mutex_unlock(&pipe->lock);
+
+        chunk->hit_n = 0;
+        chunk->out_len = 0;
+        for(line = chunk->lines; line < chunk->lines + chunk->len; line = nl + 1) {
+            nl = memchr(line, '\n', chunk->lines + chunk->len - line);
+            for(end = nl; end > line && end[-1] == '\r'; end--)
+                ;
+            *end = '\0';
+            if(strncmp(line, "chrom\t", 6) == 0) {
+                if(bg->ind_n > 0) {
+                    fprintf(stderr, "\nERROR: With -threads and -inds the header has to be the first line of the BEDGRAPH file\n\n");
+                    exit(EXIT_FAILURE);
+                }
+                continue;
+            }
+            if((hit_n = readSite(bg, line, end, &hits, &hit_size, &pos, &met, &met_i)) == 0)
+                continue;
+            for(i = 0; i < hit_n; i++) {
+                bed = &bg->beds[hits[i]];
+                dist = siteDist(bed, pos, bg->bp, &body);
+                if(body || bg->bins > 0) {
+                    if(chunk->hit_n == chunk->hit_size) {
+                        chunk->hit_size = chunk->hit_size == 0 ? 1024 : 2 * chunk->hit_size;
+                        if((chunk->hits = realloc(chunk->hits, chunk->hit_size * sizeof(Hit_s))) == NULL) {
+                            fprintf(stderr, merror);
+                            exit(EXIT_FAILURE);
                         }
-                        break;
                     }
-                } else if(strcmp(chr, beds[i].chr) < 0) {
-                    l = i;
-                    for(j = 1; j <= i; j++) {
-                        if(strcmp(chr, beds[i - j].chr) == 0) {
-                            if(pos <= beds[i - j].end + bp && pos >= beds[i - j].start - bp)
-                                l = i - j;
-                            else if(pos > beds[i - j].end + bp) {
-                                if(i - j - 1 >= 0) {
-                                    if(pos > beds[i - j - 1].end + bp)
-                                        break;
-                                } else
-                                    break;
-                            }
-                        } else if(strcmp(chr, beds[i - j].chr) > 0)
-                            break;
+                    hit = &chunk->hits[chunk->hit_n++];
+                    hit->bin = bg->bins > 0 ? siteBin(bg, hits[i], dist) : -1;
+                    hit->body = body;
+                    hit->met = met;
+                    hit->met_i = met_i;
+                }
+                if(bg->bins > 0)
+                    continue;
+                need = chunk->out_len + 2 * WRITER_FLOAT + 4 + strlen(bed->id) + (bg->labels ? strlen(bg->set_labels[bed->set]) + strlen(bg->bg_label) : 0);
+                if(need > chunk->out_size) {
+                    chunk->out_size = 2 * need;
+                    if((chunk->out = realloc(chunk->out, chunk->out_size)) == NULL) {
+                        fprintf(stderr, merror);
+                        exit(EXIT_FAILURE);
                     }
-                    break;
                 }
+                chunk->out_len += formatFloat(chunk->out + chunk->out_len, dist, 6);
+                chunk->out[chunk->out_len++] = '\t';
+                chunk->out_len += formatFloat(chunk->out + chunk->out_len, met / met_i, 6);
+                chunk->out[chunk->out_len++] = '\t';
+                chunk->out_len += copyStr(chunk->out + chunk->out_len, bed->id);
+                if(bg->labels) {
+                    chunk->out[chunk->out_len++] = '\t';
+                    chunk->out_len += copyStr(chunk->out + chunk->out_len, bg->set_labels[bed->set]);
+                    chunk->out[chunk->out_len++] = '\t';
+                    chunk->out_len += copyStr(chunk->out + chunk->out_len, bg->bg_label);
+                }
+                chunk->out[chunk->out_len++] = '\n';
             }
         }
+
+        pthread_mutex_lock(&pipe->lock);
+        chunk->state = 2;
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    pthread_mutex_unlock(&pipe->lock);
+
+    free(hits);
+
+    return NULL;
+}
+
+size_t copyStr(char *s, const char *src) {
+    size_t n = strlen(src);
+
+    memcpy(s, src, n);
+
+    return n;
+}
+
+/* Prints the mean of the per-site methylation proportions in each bin, bins are given by their midpoint on the -1 to 2 scale */
+void printBins(bed_s *beds, double *sum, long long *count, char *bg_label, char **set_labels, int bins, int group, int group_n, int labels) {
+    int i, j;
+    static int header = 0;
+
+    if(header == 0) {
+        if(labels)
+            printf("bg\tbed\t");
+        if(group == 1)
+            printf("strand\t");
+        else if(group == 2)
+            printf("id\t");
+        printf("dist\tmet\tn\n");
+        header = 1;
+    }
+    for(i = 0; i < group_n; i++) {
+        for(j = 0; j < bins; j++) {
+            if(labels)
+                printf("%s\t%s\t", bg_label, set_labels[group == 2 ? beds[i].set : group == 1 ? i / 2 : i]);
+            if(group == 1)
+                printf("%c\t", i % 2 == 0 ? '+' : '-');
+            else if(group == 2)
+                printf("%s\t", beds[i].id);
+            printf("%f\t%f\t%lli\n", -1 + 3 * (j + 0.5) / bins, count[i * bins + j] > 0 ? sum[i * bins + j] / count[i * bins + j] : NAN, count[i * bins + j]);
+        }
     }
-    fprintf(stderr, "Average body methylation = %.2f\n", bmet / bmet_i);
 }
 
 int isNumeric(const char *s) {
@@ -375,12 +788,3 @@ int isNumeric(const char *s) {
     strtod(s, &p);
     return *p == '\0';
 }
-
-void lineTerminator(char *line) {
-    int i;
-
-    for(i = 0; line[i] != 0; i++) {
-        if(line[i] == '\n' || line[i] == '\r')
-            line[i] = '\0';
-    }
-}
@@ -0,0 +1,473 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Transparent input of plain, gzip and BGZF compressed files. See bgzf.h.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "bgzf.h"
+#define merror "\nERROR: System out of memory\n\n"
+#define BLOCKSIZE 65536
+#define INSIZE 262144
+
+typedef struct {
+    int state; /* 0 empty, 1 being inflated, 2 ready */
+    unsigned char in[BLOCKSIZE], out[BLOCKSIZE];
+    unsigned int in_n, out_n, crc;
+} Block_s;
+
+typedef struct Bgzf_s {
+    FILE *file, *stream; /* compressed input and the stream returned to the caller */
+    const char *path;
+    int mode; /* 0 plain, 1 gzip, 2 bgzf */
+    int bgzf, member, empty; /* BGZF header, gzip member not finished yet, last block or member was empty (the BGZF end-of-file marker) */
+    unsigned char *raw;
+    size_t raw_n, raw_i;
+    z_stream strm;
+    Block_s *ring;
+    int ring_n, thread_n, eof, quit;
+    long next_read, next_out;
+    unsigned int out_i;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t ready, space;
+    struct Bgzf_s *next; /* list of open streams for bgzfSeek() */
+} Bgzf_s;
+
+static Bgzf_s *open_list = NULL;
+
+static size_t rawRead(Bgzf_s *z, void *buf, size_t n);
+static int readBlock(Bgzf_s *z, Block_s *block);
+static void inflateBlock(Bgzf_s *z, Block_s *block);
+static void *worker(void *arg);
+static ssize_t plainRead(void *cookie, char *buf, size_t size);
+static ssize_t gzipRead(void *cookie, char *buf, size_t size);
+static ssize_t bgzfRead(void *cookie, char *buf, size_t size);
+static int bgzfClose(void *cookie);
+static void corrupted(Bgzf_s *z);
+static void truncated(Bgzf_s *z);
+static void startWorkers(Bgzf_s *z);
+static void stopWorkers(Bgzf_s *z);
+
+/* Opens a plain or compressed file for reading. Returns NULL if the file cannot be opened. */
+FILE *bgzfOpen(const char *path, int threads) {
+    int i;
+    struct stat st;
+    cookie_io_functions_t funcs = {0};
+    Bgzf_s *z = NULL;
+    FILE *file = NULL;
+
+    if((file = fopen(path, "r")) == NULL)
+        return NULL;
+
+    if((z = malloc(sizeof(Bgzf_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memset(z, 0, sizeof(Bgzf_s));
+    z->file = file;
+    z->path = path;
+    if((z->raw = malloc(INSIZE)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    z->raw_n = fread(z->raw, 1, 18, file);
+    z->bgzf = z->raw_n == 18 && (z->raw[3] & 4) && z->raw[12] == 'B' && z->raw[13] == 'C';
+
+    if(z->raw_n < 2 || z->raw[0] != 0x1f || z->raw[1] != 0x8b) {
+        if(fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) && fseek(file, 0, SEEK_SET) == 0) {
+            free(z->raw);
+            free(z);
+            return file;
+        }
+        z->mode = 0;
+        funcs.read = plainRead;
+    } else if(threads > 1 && z->bgzf) {
+        z->mode = 2;
+        z->thread_n = threads;
+        z->ring_n = 4 * threads;
+        if((z->ring = malloc(z->ring_n * sizeof(Block_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        for(i = 0; i < z->ring_n; i++)
+            z->ring[i].state = 0;
+        if((z->threads = malloc(threads * sizeof(pthread_t))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&z->lock, NULL);
+        pthread_cond_init(&z->ready, NULL);
+        pthread_cond_init(&z->space, NULL);
+        startWorkers(z);
+        funcs.read = bgzfRead;
+    } else {
+        z->mode = 1;
+        if(inflateInit2(&z->strm, 15 + 32) != Z_OK) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        z->strm.next_in = z->raw;
+        z->strm.avail_in = z->raw_n;
+        z->raw_i = z->raw_n;
+        funcs.read = gzipRead;
+    }
+    funcs.close = bgzfClose;
+    z->stream = fopencookie(z, "r", funcs);
+    z->next = open_list;
+    open_list = z;
+
+    return z->stream;
+}
+
+/* Moves a stream from bgzfOpen() to a virtual offset. Exits if the stream cannot be repositioned, e.g. a pipe or a gzip file that is not BGZF. */
+void bgzfSeek(FILE *file, long long voff) {
+    unsigned int i, skip = voff & 0xffff;
+    char temp[BLOCKSIZE];
+    Bgzf_s *z = NULL;
+
+    for(z = open_list; z != NULL && z->stream != file; z = z->next)
+        ;
+    if(z == NULL) {
+        if(fseeko(file, voff, SEEK_SET) != 0) {
+            fprintf(stderr, "\nERROR: Cannot seek in the input file\n\n");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    if(z->mode == 2)
+        stopWorkers(z);
+    if(z->mode == 0 || fseeko(z->file, voff >> 16, SEEK_SET) != 0) {
+        fprintf(stderr, "\nERROR: Cannot seek in %s\n\n", z->path);
+        exit(EXIT_FAILURE);
+    }
+    __fpurge(file);
+    clearerr(file);
+    z->raw_n = 0;
+    z->raw_i = 0;
+    if(z->mode == 2) {
+        for(i = 0; i < z->ring_n; i++)
+            z->ring[i].state = 0;
+        z->next_read = 0;
+        z->next_out = 0;
+        z->eof = 0;
+        z->quit = 0;
+        z->out_i = skip;
+        startWorkers(z);
+    } else {
+        inflateReset(&z->strm);
+        z->strm.avail_in = 0;
+        z->member = 0;
+        while(skip > 0 && (i = gzipRead(z, temp, skip)) > 0)
+            skip -= i;
+    }
+}
+
+/* Reads and inflates the next block of a BGZF file opened with fopen(). Returns 0 at the end of file, exits if the file does not end with an empty block. */
+int bgzfBlock(FILE *raw, const char *path, unsigned char *out, unsigned int *out_n) {
+    unsigned char isize[4];
+    Bgzf_s z = {0};
+    Block_s *block = NULL;
+
+    z.file = raw;
+    z.path = path;
+    if((block = malloc(sizeof(Block_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if(readBlock(&z, block) == 0) {
+        free(block);
+        /* the last block ends at the end of file, so its inflated size is in the last four bytes */
+        if(fseeko(raw, -4, SEEK_END) != 0 || fread(isize, 1, 4, raw) != 4 || (isize[0] | isize[1] | isize[2] | isize[3]) != 0)
+            truncated(&z);
+        return 0;
+    }
+    inflateBlock(&z, block);
+    memcpy(out, block->out, block->out_n);
+    *out_n = block->out_n;
+    free(block);
+
+    return 1;
+}
+
+/* Compresses n <= BGZF_DATA bytes into a BGZF block of at most BGZF_MAX bytes. Returns the size of the block. */
+unsigned int bgzfDeflate(const unsigned char *in, unsigned int n, unsigned char *out) {
+    unsigned int size = 0, crc = 0;
+    z_stream strm = {0};
+    static const unsigned char head[18] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0};
+
+    memcpy(out, head, 18);
+    if(deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    strm.next_in = (unsigned char *)in;
+    strm.avail_in = n;
+    strm.next_out = out + 18;
+    strm.avail_out = BGZF_MAX - 18 - 8;
+    if(deflate(&strm, Z_FINISH) != Z_STREAM_END) {
+        fprintf(stderr, "\nERROR: Cannot compress a BGZF block\n\n");
+        exit(EXIT_FAILURE);
+    }
+    size = 18 + strm.total_out + 8;
+    deflateEnd(&strm);
+    crc = crc32(crc32(0L, Z_NULL, 0), in, n);
+    out[16] = (size - 1) & 0xff;
+    out[17] = (size - 1) >> 8;
+    out[size - 8] = crc & 0xff;
+    out[size - 7] = (crc >> 8) & 0xff;
+    out[size - 6] = (crc >> 16) & 0xff;
+    out[size - 5] = crc >> 24;
+    out[size - 4] = n & 0xff;
+    out[size - 3] = (n >> 8) & 0xff;
+    out[size - 2] = (n >> 16) & 0xff;
+    out[size - 1] = n >> 24;
+
+    return size;
+}
+
+static void startWorkers(Bgzf_s *z) {
+    int i;
+
+    for(i = 0; i < z->thread_n; i++)
+        pthread_create(&z->threads[i], NULL, worker, z);
+}
+
+static void stopWorkers(Bgzf_s *z) {
+    int i;
+
+    pthread_mutex_lock(&z->lock);
+    z->quit = 1;
+    pthread_cond_broadcast(&z->space);
+    pthread_mutex_unlock(&z->lock);
+    for(i = 0; i < z->thread_n; i++)
+        pthread_join(z->threads[i], NULL);
+}
+
+/* Reads from the bytes already taken for format detection before reading the file itself */
+static size_t rawRead(Bgzf_s *z, void *buf, size_t n) {
+    size_t left = z->raw_n - z->raw_i;
+
+    if(left == 0)
+        return fread(buf, 1, n, z->file);
+    if(left > n)
+        left = n;
+    memcpy(buf, z->raw + z->raw_i, left);
+    z->raw_i += left;
+    if(left < n)
+        left += fread((char *)buf + left, 1, n - left, z->file);
+
+    return left;
+}
+
+/* Reads one compressed BGZF block. Returns 0 at the end of file and exits if the file ends within a block. */
+static int readBlock(Bgzf_s *z, Block_s *block) {
+    unsigned int i, xlen, bsize = 0;
+    size_t n;
+    unsigned char *head = block->in, *tail = NULL;
+
+    if((n = rawRead(z, head, 12)) != 12) {
+        if(n > 0)
+            truncated(z);
+        return 0;
+    }
+    xlen = head[10] | (head[11] << 8);
+    if(head[0] != 0x1f || head[1] != 0x8b || !(head[3] & 4) || 12 + xlen > BLOCKSIZE)
+        corrupted(z);
+    if(rawRead(z, head + 12, xlen) != xlen)
+        truncated(z);
+    for(i = 12; i + 4 <= 12 + xlen; i += 4 + (head[i + 2] | (head[i + 3] << 8))) {
+        if(head[i] == 'B' && head[i + 1] == 'C') {
+            bsize = (head[i + 4] | (head[i + 5] << 8)) + 1;
+            break;
+        }
+    }
+    if(bsize < 12 + xlen + 8 || bsize > BLOCKSIZE)
+        corrupted(z);
+    if(rawRead(z, head + 12 + xlen, bsize - 12 - xlen) != bsize - 12 - xlen)
+        truncated(z);
+    tail = head + bsize - 4;
+    z->empty = (tail[0] | tail[1] | tail[2] | tail[3]) == 0;
+    block->in_n = bsize;
+    block->out_n = xlen; /* header length until the block is inflated */
+
+    return 1;
+}
+
+static void inflateBlock(Bgzf_s *z, Block_s *block) {
+    unsigned int xlen = block->out_n, isize = 0, crc = 0;
+    unsigned char *tail = block->in + block->in_n - 8;
+    z_stream strm = {0};
+
+    crc = tail[0] | (tail[1] << 8) | (tail[2] << 16) | ((unsigned int)tail[3] << 24);
+    isize = tail[4] | (tail[5] << 8) | (tail[6] << 16) | ((unsigned int)tail[7] << 24);
+    if(inflateInit2(&strm, -15) != Z_OK) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    strm.next_in = block->in + 12 + xlen;
+    strm.avail_in = block->in_n - 12 - xlen - 8;
+    strm.next_out = block->out;
+    strm.avail_out = BLOCKSIZE;
+    if(inflate(&strm, Z_FINISH) != Z_STREAM_END || strm.total_out != isize || crc32(crc32(0L, Z_NULL, 0), block->out, isize) != crc)
+        corrupted(z);
+    inflateEnd(&strm);
+    block->out_n = isize;
+}
+
+/* Worker threads take turns reading the next block and inflate it outside the lock */
+static void *worker(void *arg) {
+    Bgzf_s *z = arg;
+    Block_s *block = NULL;
+
+    pthread_mutex_lock(&z->lock);
+    while(!z->quit && !z->eof) {
+        block = &z->ring[z->next_read % z->ring_n];
+        if(block->state != 0) {
+            pthread_cond_wait(&z->space, &z->lock);
+            continue;
+        }
+        if(readBlock(z, block) == 0) {
+            if(!z->empty)
+                truncated(z);
+            z->eof = 1;
+            pthread_cond_broadcast(&z->ready);
+            break;
+        }
+        block->state = 1;
+        z->next_read++;
+        pthread_mutex_unlock(&z->lock);
+        inflateBlock(z, block);
+        pthread_mutex_lock(&z->lock);
+        block->state = 2;
+        pthread_cond_broadcast(&z->ready);
+    }
+    pthread_mutex_unlock(&z->lock);
+
+    return NULL;
+}
+
+static ssize_t plainRead(void *cookie, char *buf, size_t size) {
+    return rawRead(cookie, buf, size);
+}
+
+static ssize_t gzipRead(void *cookie, char *buf, size_t size) {
+    int ret;
+    Bgzf_s *z = cookie;
+
+    z->strm.next_out = (unsigned char *)buf;
+    z->strm.avail_out = size;
+    while(z->strm.avail_out == size) {
+        if(z->strm.avail_in == 0) {
+            z->strm.avail_in = fread(z->raw, 1, INSIZE, z->file);
+            z->strm.next_in = z->raw;
+            if(z->strm.avail_in == 0) {
+                if(z->member || (z->bgzf && !z->empty))
+                    truncated(z);
+                break;
+            }
+        }
+        z->member = 1;
+        ret = inflate(&z->strm, Z_NO_FLUSH);
+        if(ret == Z_STREAM_END) {
+            /* concatenated gzip members, BGZF blocks are members of their own */
+            z->member = 0;
+            z->empty = z->strm.total_out == 0;
+            inflateReset(&z->strm);
+        } else if(ret != Z_OK && ret != Z_BUF_ERROR)
+            corrupted(z);
+    }
+
+    return size - z->strm.avail_out;
+}
+
+static ssize_t bgzfRead(void *cookie, char *buf, size_t size) {
+    unsigned int n;
+    size_t done = 0;
+    Bgzf_s *z = cookie;
+    Block_s *block = NULL;
+
+    pthread_mutex_lock(&z->lock);
+    while(done < size) {
+        block = &z->ring[z->next_out % z->ring_n];
+        if(block->state != 2) {
+            if(z->eof && z->next_out == z->next_read)
+                break;
+            pthread_cond_wait(&z->ready, &z->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&z->lock);
+        n = block->out_n - z->out_i;
+        if(n > size - done)
+            n = size - done;
+        memcpy(buf + done, block->out + z->out_i, n);
+        done += n;
+        z->out_i += n;
+        pthread_mutex_lock(&z->lock);
+        if(z->out_i == block->out_n) {
+            block->state = 0;
+            z->out_i = 0;
+            z->next_out++;
+            pthread_cond_broadcast(&z->space);
+        }
+    }
+    pthread_mutex_unlock(&z->lock);
+
+    return done;
+}
+
+static int bgzfClose(void *cookie) {
+    Bgzf_s *z = cookie, **prev = NULL;
+
+    for(prev = &open_list; *prev != NULL; prev = &(*prev)->next) {
+        if(*prev == z) {
+            *prev = z->next;
+            break;
+        }
+    }
+    if(z->mode == 2) {
+        stopWorkers(z);
+        pthread_mutex_destroy(&z->lock);
+        pthread_cond_destroy(&z->ready);
+        pthread_cond_destroy(&z->space);
+        free(z->threads);
+        free(z->ring);
+    } else if(z->mode == 1)
+        inflateEnd(&z->strm);
+    fclose(z->file);
+    free(z->raw);
+    free(z);
+
+    return 0;
+}
+
+static void corrupted(Bgzf_s *z) {
+    fprintf(stderr, "\nERROR: %s is not a valid gzip/BGZF file\n\n", z->path);
+    exit(EXIT_FAILURE);
+}
+
+static void truncated(Bgzf_s *z) {
+    fprintf(stderr, "\nERROR: %s is truncated, the gzip/BGZF stream ends early\n\n", z->path);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,42 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Transparent input of plain, gzip and BGZF compressed files.
+ The returned stream is an ordinary FILE, so fgets, getline and fread work on it as on any other file.
+ With threads > 1 (the -threads option of the tools) BGZF blocks (bgzip, htslib) are inflated on that many worker threads ahead of the reader,
+ otherwise and for other gzip files the input is inflated on the fly. A stream that ends within a gzip member or a BGZF file without its empty end-of-file block
+ is reported as truncated and the program exits.
+ Requires zlib and pthreads (-lz -lpthread).
+
+ BGZF files can be repositioned with bgzfSeek() to a virtual offset (compressed offset of a block << 16 | offset within the inflated block), as in tabix.
+ For plain files the virtual offset is the byte offset. bgzfBlock() reads the blocks of a BGZF file one at a time for building such indexes.
+ bgzfDeflate() compresses up to BGZF_DATA bytes into one block for writing BGZF files, and can be called from worker threads. An empty block marks the end of file.
+*/
+
+#ifndef BGZF_H
+#define BGZF_H
+
+#include <stdio.h>
+#define BGZF_DATA 65280   /* most bytes in one block written by bgzfDeflate(), as in bgzip */
+#define BGZF_MAX 65536    /* size of a compressed block */
+
+FILE *bgzfOpen(const char *path, int threads);
+void bgzfSeek(FILE *file, long long voff);
+int bgzfBlock(FILE *raw, const char *path, unsigned char *out, unsigned int *out_n);
+unsigned int bgzfDeflate(const unsigned char *in, unsigned int n, unsigned char *out);
+
+#endif
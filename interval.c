@@ -0,0 +1,267 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Interval index with chromosome interning. See interval.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "interval.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+static unsigned int hashChr(const char *chr);
+static void growTable(Index_s *x);
+static int cmpRange(const void *a, const void *b);
+static int cmpInt(const void *a, const void *b);
+static int buildTree(Range_s *r, int n);
+
+Index_s *indexInit(void) {
+    Index_s *x = NULL;
+
+    if((x = calloc(1, sizeof(Index_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    growTable(x);
+
+    return x;
+}
+
+/* Returns the id of a chromosome name, adding it if it is new */
+int indexChr(Index_s *x, const char *chr) {
+    unsigned int h;
+    int i;
+
+    if((i = indexGetChr(x, chr)) >= 0)
+        return i;
+    if(2 * (x->chr_n + 1) > x->table_n)
+        growTable(x);
+    if((x->chrs = realloc(x->chrs, (x->chr_n + 1) * sizeof(char *))) == NULL || (x->chrs[x->chr_n] = strdup(chr)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(h = hashChr(chr) & (x->table_n - 1); x->table[h] >= 0; h = (h + 1) & (x->table_n - 1))
+        ;
+    x->table[h] = x->chr_n;
+    x->chr_n++;
+
+    return x->chr_n - 1;
+}
+
+/* Returns the id of a chromosome name or -1 if no feature is on it */
+int indexGetChr(Index_s *x, const char *chr) {
+    unsigned int h;
+
+    for(h = hashChr(chr) & (x->table_n - 1); x->table[h] >= 0; h = (h + 1) & (x->table_n - 1)) {
+        if(strcmp(x->chrs[x->table[h]], chr) == 0)
+            return x->table[h];
+    }
+
+    return -1;
+}
+
+void indexAdd(Index_s *x, int chr, int start, int end, int id) {
+    if(x->n == x->size) {
+        x->size = x->size == 0 ? 1024 : 2 * x->size;
+        if((x->ranges = realloc(x->ranges, x->size * sizeof(Range_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    x->ranges[x->n].chr = chr;
+    x->ranges[x->n].start = start;
+    x->ranges[x->n].end = end;
+    x->ranges[x->n].id = id;
+    x->n++;
+}
+
+/* Sorts the ranges by chromosome and start and computes the subtree maxima of each chromosome */
+void indexBuild(Index_s *x) {
+    int i, c;
+
+    qsort(x->ranges, x->n, sizeof(Range_s), cmpRange);
+    if((x->first = malloc((x->chr_n + 1) * sizeof(int))) == NULL || (x->level = malloc((x->chr_n + 1) * sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(c = 0, i = 0; c <= x->chr_n; c++) {
+        while(i < x->n && x->ranges[i].chr < c)
+            i++;
+        x->first[c] = i;
+    }
+    for(c = 0; c < x->chr_n; c++)
+        x->level[c] = buildTree(x->ranges + x->first[c], x->first[c + 1] - x->first[c]);
+}
+
+/* Finds the ids of all ranges of chromosome chr overlapping start to end. Ids are returned in increasing order in *hits, which is grown as needed. */
+int indexFind(Index_s *x, int chr, int start, int end, int **hits, int *size) {
+    int i, i0, i1, t = 0, h = 0, n, y, sorted = 1;
+    struct {
+        int x, k, w;
+    } stack[64], z;
+    Range_s *r = NULL;
+
+    if(chr < 0 || chr >= x->chr_n || x->level[chr] < 0)
+        return 0;
+    r = x->ranges + x->first[chr];
+    n = x->first[chr + 1] - x->first[chr];
+
+    stack[t].k = x->level[chr];
+    stack[t].x = (1 << stack[t].k) - 1;
+    stack[t++].w = 0;
+    while(t > 0) {
+        z = stack[--t];
+        if(z.k <= 3) {
+            /* small subtree, scan it */
+            i0 = z.x >> z.k << z.k;
+            i1 = i0 + (1 << (z.k + 1)) - 1;
+            if(i1 > n)
+                i1 = n;
+            for(i = i0; i < i1 && r[i].start <= end; i++) {
+                if(r[i].end >= start) {
+                    if(h == *size) {
+                        *size = *size == 0 ? 64 : 2 * *size;
+                        if((*hits = realloc(*hits, *size * sizeof(int))) == NULL) {
+                            fprintf(stderr, merror);
+                            exit(EXIT_FAILURE);
+                        }
+                    }
+                    if(h > 0 && (*hits)[h - 1] > r[i].id)
+                        sorted = 0;
+                    (*hits)[h++] = r[i].id;
+                }
+            }
+        } else if(z.w == 0) {
+            /* left child first */
+            y = z.x - (1 << (z.k - 1));
+            z.w = 1;
+            stack[t++] = z;
+            if(y >= n || r[y].max >= start) {
+                stack[t].x = y;
+                stack[t].k = z.k - 1;
+                stack[t++].w = 0;
+            }
+        } else if(z.x < n && r[z.x].start <= end) {
+            if(r[z.x].end >= start) {
+                if(h == *size) {
+                    *size = *size == 0 ? 64 : 2 * *size;
+                    if((*hits = realloc(*hits, *size * sizeof(int))) == NULL) {
+                        fprintf(stderr, merror);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                if(h > 0 && (*hits)[h - 1] > r[z.x].id)
+                    sorted = 0;
+                (*hits)[h++] = r[z.x].id;
+            }
+            stack[t].x = z.x + (1 << (z.k - 1));
+            stack[t].k = z.k - 1;
+            stack[t++].w = 0;
+        }
+    }
+    if(sorted == 0)
+        qsort(*hits, h, sizeof(int), cmpInt);
+
+    return h;
+}
+
+void indexFree(Index_s *x) {
+    int i;
+
+    for(i = 0; i < x->chr_n; i++)
+        free(x->chrs[i]);
+    free(x->chrs);
+    free(x->table);
+    free(x->ranges);
+    free(x->first);
+    free(x->level);
+    free(x);
+}
+
+static unsigned int hashChr(const char *chr) {
+    unsigned int h = 2166136261u;
+
+    for(; *chr != '\0'; chr++)
+        h = (h ^ (unsigned char)*chr) * 16777619u;
+
+    return h;
+}
+
+static void growTable(Index_s *x) {
+    int i;
+    unsigned int h;
+
+    x->table_n = x->table_n == 0 ? 64 : 2 * x->table_n;
+    free(x->table);
+    if((x->table = malloc(x->table_n * sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memset(x->table, -1, x->table_n * sizeof(int));
+    for(i = 0; i < x->chr_n; i++) {
+        for(h = hashChr(x->chrs[i]) & (x->table_n - 1); x->table[h] >= 0; h = (h + 1) & (x->table_n - 1))
+            ;
+        x->table[h] = i;
+    }
+}
+
+static int cmpRange(const void *a, const void *b) {
+    const Range_s *r1 = a, *r2 = b;
+
+    if(r1->chr != r2->chr)
+        return r1->chr < r2->chr ? -1 : 1;
+    if(r1->start != r2->start)
+        return r1->start < r2->start ? -1 : 1;
+    return (r1->id > r2->id) - (r1->id < r2->id);
+}
+
+static int cmpInt(const void *a, const void *b) {
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+/* Implicit interval tree: the ranges are the in-order nodes of a binary tree where node i at level k has children i -/+ 2^(k-1).
+   Returns the level of the root, -1 if there are no ranges. */
+static int buildTree(Range_s *r, int n) {
+    int i, k, x, step, last_i = 0, last = 0, e;
+
+    if(n == 0)
+        return -1;
+    for(i = 0; i < n; i += 2) {
+        last_i = i;
+        last = r[i].max = r[i].end;
+    }
+    for(k = 1; 1 << k <= n; k++) {
+        x = 1 << (k - 1);
+        step = x << 2;
+        for(i = (x << 1) - 1; i < n; i += step) {
+            e = r[i].end;
+            if(r[i - x].max > e)
+                e = r[i - x].max;
+            if(i + x < n && r[i + x].max > e)
+                e = r[i + x].max;
+            else if(i + x >= n && last > e)
+                e = last;
+            r[i].max = e;
+        }
+        last_i = (last_i >> k) & 1 ? last_i - x : last_i + x;
+        if(last_i < n && r[last_i].max > last)
+            last = r[last_i].max;
+    }
+
+    return k - 1;
+}
@@ -0,0 +1,54 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Interval index for assigning sites to genes and other features.
+ Chromosome names are interned to integer ids once, intervals are sorted per chromosome and stored as an implicit interval tree
+ (the layout of cgranges), so all features overlapping a position are found in O(log n + hits) regardless of how much they overlap.
+ Features can be added in any order.
+
+ Typical use:
+    x = indexInit();
+    for each feature: indexAdd(x, indexChr(x, chr), start - bp, end + bp, feature_i);
+    indexBuild(x);
+    for each site: n = indexFind(x, indexGetChr(x, chr), pos, pos, &hits, &size);
+    indexFree(x);
+*/
+
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+typedef struct {
+    int chr, start, end, max, id; /* closed interval, max is the largest end in the subtree */
+} Range_s;
+
+typedef struct {
+    int chr_n, table_n, *table; /* chromosome names and their hash table */
+    char **chrs;
+    int n, size;
+    Range_s *ranges;
+    int *first, *level;         /* after indexBuild(), the ranges of chromosome c are first[c] to first[c + 1] - 1 */
+} Index_s;
+
+Index_s *indexInit(void);
+int indexChr(Index_s *x, const char *chr);
+int indexGetChr(Index_s *x, const char *chr);
+void indexAdd(Index_s *x, int chr, int start, int end, int id);
+void indexBuild(Index_s *x);
+int indexFind(Index_s *x, int chr, int start, int end, int **hits, int *size);
+void indexFree(Index_s *x);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Delete-one block jackknife. See jackknife.h.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "jackknife.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+void jackAdd(Jack_s *jack, int block, double a, double b) {
+    if(jack->n == 0 || block != jack->last) {
+        if(jack->n == jack->size) {
+            jack->size = jack->size == 0 ? 8 : 2 * jack->size;
+            if((jack->a = realloc(jack->a, jack->size * sizeof(double))) == NULL || (jack->b = realloc(jack->b, jack->size * sizeof(double))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+        jack->a[jack->n] = 0;
+        jack->b[jack->n] = 0;
+        jack->last = block;
+        jack->n++;
+    }
+    jack->a[jack->n - 1] += a;
+    jack->b[jack->n - 1] += b;
+}
+
+/* Standard error of sum(a) / sum(b): sqrt((g - 1) / g * sum((t_k - t)^2)), where t_k leaves out block k and t is the mean of t_k. NaN with less than two blocks. */
+double jackSE(Jack_s *jack) {
+    int i, g = jack->n;
+    double a = 0, b = 0, mean = 0, ss = 0, t;
+
+    if(g < 2)
+        return NAN;
+    for(i = 0; i < g; i++) {
+        a += jack->a[i];
+        b += jack->b[i];
+    }
+    for(i = 0; i < g; i++)
+        mean += (a - jack->a[i]) / (b - jack->b[i]);
+    mean /= g;
+    for(i = 0; i < g; i++) {
+        t = (a - jack->a[i]) / (b - jack->b[i]) - mean;
+        ss += t * t;
+    }
+
+    return sqrt((g - 1.0) / g * ss);
+}
+
+void jackFree(Jack_s *jack) {
+    free(jack->a);
+    free(jack->b);
+    jack->a = NULL;
+    jack->b = NULL;
+    jack->n = 0;
+    jack->size = 0;
+}
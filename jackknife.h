@@ -0,0 +1,34 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Delete-one block jackknife for ratio estimates such as Fst (sum hw / sum hb) or mean pi (sum pi / number of sites).
+ Sites are added with the id of the block they fall in. Consecutive sites of the same block share one entry, so memory grows with the number of blocks, not sites.
+*/
+
+#ifndef JACKKNIFE_H
+#define JACKKNIFE_H
+
+typedef struct {
+    int n, size, last; /* number of blocks, allocated blocks and id of the last block */
+    double *a, *b;     /* per-block sums of the numerator and the denominator */
+} Jack_s;
+
+void jackAdd(Jack_s *jack, int block, double a, double b);
+double jackSE(Jack_s *jack);
+void jackFree(Jack_s *jack);
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Single-pass reader for tab-delimited auxiliary files. See lines.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lines.h"
+#define merror "\nERROR: System out of memory\n\n"
+#define LINESIZE 1048576
+
+Lines_s *linesOpen(FILE *file) {
+    Lines_s *l = NULL;
+
+    if((l = calloc(1, sizeof(Lines_s))) == NULL || (l->buf = malloc(LINESIZE + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    l->file = file;
+    l->size = LINESIZE;
+
+    return l;
+}
+
+/* Returns the next line without the line terminator, or NULL at the end of file. The line is valid until the next call. */
+char *linesNext(Lines_s *l) {
+    char *line = NULL, *nl = NULL;
+    size_t n;
+
+    while(1) {
+        if((nl = memchr(l->buf + l->start, '\n', l->end - l->start)) != NULL || (l->eof && l->start < l->end)) {
+            line = l->buf + l->start;
+            if(nl == NULL)
+                nl = l->buf + l->end;
+            l->start = nl - l->buf + 1;
+            if(l->start > l->end)
+                l->start = l->end;
+            if(nl > line && nl[-1] == '\r')
+                nl--;
+            *nl = '\0';
+            return line;
+        }
+        if(l->eof)
+            return NULL;
+        /* move the partial line to the front and fill the rest of the buffer */
+        if(l->start > 0) {
+            memmove(l->buf, l->buf + l->start, l->end - l->start);
+            l->end -= l->start;
+            l->start = 0;
+        }
+        if(l->end == l->size) {
+            l->size *= 2;
+            if((l->buf = realloc(l->buf, l->size + 1)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if((n = fread(l->buf + l->end, 1, l->size - l->end, l->file)) == 0)
+            l->eof = 1;
+        l->end += n;
+    }
+}
+
+/* Splits a line in place at tabs. Returns the number of fields, at most max (anything after field max is cut off). */
+int linesSplit(char *line, char **fields, int max) {
+    int n = 0;
+    char *tab = NULL;
+
+    while(n < max) {
+        fields[n++] = line;
+        if((tab = strchr(line, '\t')) == NULL)
+            break;
+        *tab = '\0';
+        line = tab + 1;
+    }
+
+    return n;
+}
+
+/* Makes room for element n of a list of item sized elements, doubling the allocation when it is full */
+void *linesGrow(void *list, int n, int *size, size_t item) {
+    if(n < *size)
+        return list;
+    *size = *size == 0 ? 1024 : 2 * *size;
+    if((list = realloc(list, (size_t)*size * item)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+
+    return list;
+}
+
+void linesClose(Lines_s *l) {
+    fclose(l->file);
+    free(l->buf);
+    free(l);
+}
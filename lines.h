@@ -0,0 +1,51 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Single-pass reader for the tab-delimited auxiliary files (genes, populations, BED, MUMmer coords and snps, regions and sites).
+ Lines are returned from a large read buffer without a counting pass or rewind, so pipes and files opened with bgzfOpen() work as well.
+ Lists are grown with linesGrow() as records are parsed.
+
+ Typical use:
+    l = linesOpen(file);
+    while((line = linesNext(l)) != NULL) {
+        if(linesSplit(line, fields, 5) < 5)
+            continue;
+        list = linesGrow(list, n, &size, sizeof(*list));
+        ...parse fields into list[n++]...
+    }
+    linesClose(l);
+*/
+
+#ifndef LINES_H
+#define LINES_H
+
+#include <stdio.h>
+
+typedef struct {
+    FILE *file;
+    char *buf;
+    size_t size, start, end; /* buffer size, start of the next line and end of buffered data */
+    int eof;
+} Lines_s;
+
+Lines_s *linesOpen(FILE *file);
+char *linesNext(Lines_s *l);
+int linesSplit(char *line, char **fields, int max);
+void *linesGrow(void *list, int n, int *size, size_t item);
+void linesClose(Lines_s *l);
+
+#endif
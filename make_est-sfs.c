@@ -20,9 +20,10 @@
  Polymorphism data are assumed to be genotype probabilities in Beagle format, generated e.g. with ANGSD (-doMaf 2 -doMajorMinor 4 -doPost 1 -beagleProb 1).
 
  Only sites that have outgroup information in two of the three species are used.
- If the Beagle file contains missing data, missing alleles are imputed by drawing them from a Bernoulli distribution. 
+ If the Beagle file contains missing data, the alternative allele count of the missing alleles is drawn from a binomial distribution.
+ The draw depends only on -seed, the chromosome, the position and the label of the Beagle file, so runs are reproducible.
 
- Compiling: gcc make_est-sfs.c -o make_est-sfs -lm
+ Compiling: gcc make_est-sfs.c beagle.c bgzf.c interval.c lines.c rng.c seek.c track.c writer.c -o make_est-sfs -lm -lz -lpthread
 
  Usage:
  -coord1 [file] coordinates file from outgroup 1 (closet outgroup)
@@ -31,9 +32,24 @@
  -div1 [file] substitution file from outgroup 1 (closet outgroup)
  -div2 [file] substitution file from outgroup 2 (mid outgroup)
  -div3 [file] substitution file from outgroup 3 (distant outgroup)
- -beagle [file] genotype probabilities in Beagle format
- -region [file] tab-delimited file defining regions to include (chr, start, end)
- -sites [file] tab-delimited file defining sites to include (chr, pos)
+ -beagle [label=file] genotype probabilities in Beagle format (plain, gzip or BGZF compressed). Can be used >= 1 times, e.g. once per population.
+ -region [label=file] tab-delimited file defining regions to include (chr, start, end). Can be used >= 1 times.
+ -sites [label=file] tab-delimited file defining sites to include (chr, pos). Can be used >= 1 times.
+ Labels cannot contain '='; the argument is split at the first '=' unless it names an existing file.
+ -maketrack [file] compile the -coord and -div files into an outgroup track (4 bits per base and outgroup) and exit. -beagle is not needed.
+ -track [file] outgroup track written with -maketrack, used instead of the -coord and -div files. The track is mapped, so it is not loaded into memory and startup is immediate.
+ -stream read the -coord and -div files in step with the Beagle files instead of compiling them into a track first, so startup is immediate and memory does not grow with the alignments.
+    The Beagle files must be sorted by position and list chromosomes in the order of the MUMmer files, which must be sorted by reference position (show-coords -r, show-snps -r).
+    If an outgroup lacks chromosomes, index the Beagle files with beagle2idx so the chromosome order is known; otherwise out-of-order input stops with an error. Optional.
+ -seed [int] seed for imputing missing alleles. Default 1.
+ -threads [int] number of threads used for inflating BGZF input. Default 1.
+
+ All input files can be gzip compressed or given through a pipe, chromosome names can be any string.
+ With one -beagle and at most one -region and -sites the output is printed and the sites are written to info.txt.
+ Otherwise the Beagle files are read in parallel, merged by position, and the outgroup states of a position are looked up once for all of them.
+ Every combination of -beagle, -region and -sites is then written to label[_region][_sites]_est-sfs.txt and label[_region][_sites]_info.txt.
+ Labels default to the file name up to the first dot.
+ If a Beagle file has been indexed with beagle2idx, only the parts covering the regions (or the sites without -region) are read.
 
  Example:
  ./make_est-sfs \
@@ -43,9 +59,18 @@
     -div1 lyrata-thaliana.snps \
     -div2 lyrata-capsella.snps \
     -div3 lyrata-arabis.snps \
-    -beagle <(zcat J1.beagle.gprobs.gz) \
+    -beagle J1.beagle.gprobs.gz \
     -region DEG_field.txt \
     -sites 0fold.sites > J1_DEG_field_0fold_est-sfs.txt
+
+ ./make_est-sfs \
+    -coord1 lyrata-thaliana.coord -coord2 lyrata-capsella.coord -coord3 lyrata-arabis.coord \
+    -div1 lyrata-thaliana.snps -div2 lyrata-capsella.snps -div3 lyrata-arabis.snps \
+    -maketrack lyrata.track
+ ./make_est-sfs -track lyrata.track -beagle J1.beagle.gprobs.gz -sites 0fold.sites > J1_0fold_est-sfs.txt
+ ./make_est-sfs -coord1 lyrata-thaliana.coord -coord2 lyrata-capsella.coord -coord3 lyrata-arabis.coord \
+    -div1 lyrata-thaliana.snps -div2 lyrata-capsella.snps -div3 lyrata-arabis.snps -stream -beagle J1.beagle.gprobs.gz > J1_est-sfs.txt
+ ./make_est-sfs -track lyrata.track -beagle J1.beagle.gprobs.gz -beagle J3.beagle.gprobs.gz -region DEG_field.txt -sites 0fold.sites -sites 4fold.sites
 */
 
 #include <ctype.h>
@@ -55,9 +80,17 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "beagle.h"
+#include "bgzf.h"
+#include "interval.h"
+#include "lines.h"
+#include "rng.h"
+#include "seek.h"
+#include "track.h"
+#include "writer.h"
 #define merror "\nERROR: System out of memory\n"
-#define NA 0.333333
 
+/* Both tables start with the chromosome id, see sortChr() */
 typedef struct {
     int chr, start, stop;
     char id[50];
@@ -68,15 +101,41 @@ typedef struct {
     char ref, alt;
 } Site_s;
 
+/* -region or -sites file */
+typedef struct {
+    char *label;
+    int n;
+    Region_s *regions;
+    Site_s *sites;
+} Set_s;
+
+/* -beagle file and its position in the merged input */
+typedef struct {
+    Beagle_s *beagle;
+    Seek_s *seek;           /* position index of the file, if any */
+    char *label, *last, *path;
+    int chr, out_chr, eof;
+    unsigned long long seed; /* -seed mixed with the label */
+    int *rg_i, *site_i;     /* cursors of every region and site set */
+    Writer_s **out, **info; /* outputs of every combination of region and site set */
+} Pop_s;
+
 void openFiles(int argc, char *argv[]);
-Region_s *readRegions(FILE *region_file, int *n);
-Site_s *readSites(FILE *site_file, int *n);
-Region_s *readCoord(FILE *coord_file, int *n);
-Site_s *readDiv(FILE *div_file, int *n);
-void readBeagle(FILE *beagle_file, Region_s *coord1, Region_s *coord2, Region_s *coord3, Region_s *regions, Site_s *div1, Site_s *div2, Site_s *div3, Site_s *sites, int co_n1, int co_n2, int co_n3, int rg_n, int div_n1, int div_n2, int div_n3, int site_n);
-char defOut(Region_s *coord, Site_s *div, char ref, int chr, int pos, int co_n, int div_n, int *co_i, int *div_i);
-void printOut(char nuc, int end);
-void lineTerminator(char *line);
+Region_s *readRegions(FILE *region_file, Index_s *chrs, int *n);
+Site_s *readSites(FILE *site_file, Index_s *chrs, int *n);
+void *sortChr(void *list, int n, size_t item, int chr_n);
+int firstChr(void *list, int n, size_t item, int chr);
+void readBeagle(Pop_s *pops, Set_s *rsets, Set_s *ssets, Index_s *chrs, Track_s *track, int pop_n, int rs_n, int ss_n);
+void openPop(Pop_s *pop, FILE *beagle_file, Set_s *rsets, Set_s *ssets, int rs_n, int ss_n, int single);
+int nextSite(Pop_s *pop, Set_s *rsets, Set_s *ssets, Index_s *chrs, Track_s *track, int rs_n, int ss_n);
+void printSite(Pop_s *pop, Set_s *rsets, Set_s *ssets, int *states, int rs_n, int ss_n);
+int inRegion(Set_s *set, int *i, int chr, int pos);
+int inSite(Set_s *set, int *i, int chr, int pos);
+char *fileLabel(char *arg, char **file);
+void seekSets(Seek_s *seek, Set_s *rsets, Set_s *ssets, Index_s *chrs, int rs_n, int ss_n);
+int isNumeric(const char *s);
+void printCount(Writer_s *out, char nuc, char ref, char alt, double ref_i, double alt_i, char sep);
+void printOut(Writer_s *out, char nuc, int end);
 
 int main(int argc, char *argv[]) {
     int second = 0, minute = 0, hour = 0;
@@ -108,84 +167,127 @@ int main(int argc, char *argv[]) {
 }
 
 void openFiles(int argc, char *argv[]) {
-    int i, co_n1 = 0, co_n2 = 0, co_n3 = 0, rg_n = 0, div_n1 = 0, div_n2 = 0, div_n3 = 0, site_n = 0;
-    FILE *coord_file1 = NULL, *coord_file2 = NULL, *coord_file3 = NULL, *div_file1 = NULL, *div_file2 = NULL, *div_file3 = NULL, *beagle_file = NULL, *region_file = NULL, *site_file = NULL;
-    Region_s *coord1, *coord2, *coord3, *regions;
-    Site_s *div1, *div2, *div3, *sites;
+    int i, j, pop_n = 0, rs_n = 0, ss_n = 0, named = 0, stream = 0, threads = 1;
+    unsigned long long seed = 1;
+    char *file = NULL, *coord_paths[3] = {NULL}, *div_paths[3] = {NULL};
+    FILE *coord_files[3] = {NULL}, *div_files[3] = {NULL}, *file_in = NULL, **beagle_files = NULL, *track_file = NULL, *out_file = NULL;
+    Set_s *rsets = NULL, *ssets = NULL;
+    Pop_s *pops = NULL;
+    Index_s *chrs = NULL;
+    Track_s *track = NULL;
+
+    chrs = indexInit();
 
     fprintf(stderr, "\nParameters:\n");
 
     for(i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-coord1") == 0) {
-            if((coord_file1 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            coord_paths[0] = argv[++i];
             fprintf(stderr, "\t-coord1 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-coord2") == 0) {
-            if((coord_file2 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            coord_paths[1] = argv[++i];
             fprintf(stderr, "\t-coord2 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-coord3") == 0) {
-            if((coord_file3 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            coord_paths[2] = argv[++i];
             fprintf(stderr, "\t-coord3 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-div1") == 0) {
-            if((div_file1 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            div_paths[0] = argv[++i];
             fprintf(stderr, "\t-div1 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-div2") == 0) {
-            if((div_file2 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            div_paths[1] = argv[++i];
             fprintf(stderr, "\t-div2 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-div3") == 0) {
-            if((div_file3 = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            div_paths[2] = argv[++i];
             fprintf(stderr, "\t-div3 %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-beagle") == 0) {
-            if((beagle_file = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+            if((beagle_files = realloc(beagle_files, (pop_n + 1) * sizeof(FILE *))) == NULL || (pops = realloc(pops, (pop_n + 1) * sizeof(Pop_s))) == NULL) {
+                fprintf(stderr, merror);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-beagle %s\n", argv[i]);
+            fprintf(stderr, "\t-beagle %s\n", argv[++i]);
+            memset(&pops[pop_n], 0, sizeof(Pop_s));
+            pops[pop_n].label = fileLabel(argv[i], &file);
+            pops[pop_n].path = file;
+            if(file != argv[i])
+                named = 1;
+            pop_n++;
         }
 
         else if(strcmp(argv[i], "-region") == 0) {
-            if((region_file = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+            if((rsets = realloc(rsets, (rs_n + 1) * sizeof(Set_s))) == NULL) {
+                fprintf(stderr, merror);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-region %s\n", argv[i]);
+            fprintf(stderr, "\t-region %s\n", argv[++i]);
+            memset(&rsets[rs_n], 0, sizeof(Set_s));
+            rsets[rs_n].label = fileLabel(argv[i], &file);
+            if((file_in = bgzfOpen(file, 1)) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", file);
+                exit(EXIT_FAILURE);
+            }
+            rsets[rs_n].regions = readRegions(file_in, chrs, &rsets[rs_n].n);
+            rs_n++;
         }
 
         else if(strcmp(argv[i], "-sites") == 0) {
-            if((site_file = fopen(argv[++i], "r")) == NULL) {
+            if((ssets = realloc(ssets, (ss_n + 1) * sizeof(Set_s))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-sites %s\n", argv[++i]);
+            memset(&ssets[ss_n], 0, sizeof(Set_s));
+            ssets[ss_n].label = fileLabel(argv[i], &file);
+            if((file_in = bgzfOpen(file, 1)) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", file);
+                exit(EXIT_FAILURE);
+            }
+            ssets[ss_n].sites = readSites(file_in, chrs, &ssets[ss_n].n);
+            ss_n++;
+        }
+
+        else if(strcmp(argv[i], "-track") == 0) {
+            if((track_file = fopen(argv[++i], "rb")) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-sites %s\n", argv[i]);
+            fprintf(stderr, "\t-track %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-stream") == 0) {
+            stream = 1;
+            fprintf(stderr, "\t-stream\n");
+        }
+
+        else if(strcmp(argv[i], "-threads") == 0) {
+            if(isNumeric(argv[++i]))
+                threads = atoi(argv[i]);
+            fprintf(stderr, "\t-threads %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-seed") == 0) {
+            if(isNumeric(argv[++i]))
+                seed = strtoull(argv[i], NULL, 10);
+            fprintf(stderr, "\t-seed %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-maketrack") == 0) {
+            if((out_file = fopen(argv[++i], "wb")) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot create file %s\n\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-maketrack %s\n", argv[i]);
         }
 
         else {
@@ -196,433 +298,470 @@ void openFiles(int argc, char *argv[]) {
 
     fprintf(stderr, "\n");
 
-    if(div_file1 == NULL || div_file2 == NULL || div_file3 == NULL || coord_file1 == NULL || coord_file2 == NULL || coord_file3 == NULL || beagle_file == NULL) {
-        fprintf(stderr, "ERROR: The following parameters are required: -coord1 [file] -coord2 [file] -coord3 [file] -div1 [file] -div2 [file] -div3 [file] -beagle [file]\n\n");
-        exit(EXIT_FAILURE);
-    }
-
-    if(region_file != NULL)
-        regions = readRegions(region_file, &rg_n);
-    if(site_file != NULL)
-        sites = readSites(site_file, &site_n);
-
-    coord1 = readCoord(coord_file1, &co_n1);
-    coord2 = readCoord(coord_file2, &co_n2);
-    coord3 = readCoord(coord_file3, &co_n3);
-    div1 = readDiv(div_file1, &div_n1);
-    div2 = readDiv(div_file2, &div_n2);
-    div3 = readDiv(div_file3, &div_n3);
-    readBeagle(beagle_file, coord1, coord2, coord3, regions, div1, div2, div3, sites, co_n1, co_n2, co_n3, rg_n, div_n1, div_n2, div_n3, site_n);
-}
-
-Region_s *readRegions(FILE *region_file, int *n) {
-    int i, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line, *temp;
-    Region_s *list;
-
-    while((c = fgetc(region_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
+    for(i = 0; i < 3; i++) {
+        if(track_file == NULL && (coord_paths[i] == NULL || div_paths[i] == NULL)) {
+            fprintf(stderr, "ERROR: The following parameters are required: -coord1 [file] -coord2 [file] -coord3 [file] -div1 [file] -div2 [file] -div3 [file] (or -track [file]) -beagle [file]\n\n");
+            exit(EXIT_FAILURE);
         }
     }
-
-    rewind(region_file);
-
-    if((list = malloc((line_i) * sizeof(Region_s))) == NULL) {
-        fprintf(stderr, merror);
+    if(out_file == NULL && pop_n == 0) {
+        fprintf(stderr, "ERROR: -beagle [file] is required!\n\n");
         exit(EXIT_FAILURE);
     }
-
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
-        fprintf(stderr, merror);
+    if(stream == 1 && (track_file != NULL || out_file != NULL)) {
+        fprintf(stderr, "ERROR: -stream reads the -coord and -div files and cannot be combined with -track or -maketrack!\n\n");
         exit(EXIT_FAILURE);
     }
 
-    while(fgets(line, maxchar + 1, region_file) != NULL) {
-        if(isdigit(line[0])) {
-            lineTerminator(line);
-            list[*n].chr = atoi(strtok(line, "\t"));
-            list[*n].start = atoi(strtok(NULL, "\t"));
-            list[*n].stop = atoi(strtok(NULL, "\t"));
-            *n = *n + 1;
+    for(i = 0; i < 3 && track_file == NULL; i++) {
+        if((coord_files[i] = bgzfOpen(coord_paths[i], threads)) == NULL) {
+            fprintf(stderr, "\nERROR: Cannot open file %s\n\n", coord_paths[i]);
+            exit(EXIT_FAILURE);
+        }
+        if((div_files[i] = bgzfOpen(div_paths[i], threads)) == NULL) {
+            fprintf(stderr, "\nERROR: Cannot open file %s\n\n", div_paths[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(i = 0; i < pop_n && out_file == NULL; i++) {
+        if((beagle_files[i] = bgzfOpen(pops[i].path, threads)) == NULL) {
+            fprintf(stderr, "\nERROR: Cannot open file %s\n\n", pops[i].path);
+            exit(EXIT_FAILURE);
         }
     }
 
-    free(line);
-    fclose(region_file);
+    if(track_file != NULL) {
+        track = trackOpen(track_file);
+        if(track->head->out_n != 3) {
+            fprintf(stderr, "ERROR: The outgroup track needs to have three outgroups\n\n");
+            exit(EXIT_FAILURE);
+        }
+    } else if(stream == 1)
+        track = trackStream(coord_files, div_files, 3);
+    else
+        track = trackBuild(coord_files, div_files, 3);
+    if(out_file != NULL) {
+        trackWrite(track, out_file);
+        fprintf(stderr, "Wrote outgroup track of %i chromosomes\n", track->head->chr_n);
+        trackClose(track);
+        return;
+    }
 
-    return list;
+    /* chromosome ids follow the order of first appearance, so the tables are regrouped by id and the Beagle files may list chromosomes in any order */
+    for(i = 0; i < rs_n; i++)
+        rsets[i].regions = sortChr(rsets[i].regions, rsets[i].n, sizeof(Region_s), chrs->chr_n);
+    for(i = 0; i < ss_n; i++)
+        ssets[i].sites = sortChr(ssets[i].sites, ssets[i].n, sizeof(Site_s), chrs->chr_n);
+
+    for(i = 0; i < pop_n; i++) {
+        pops[i].seed = rngHash(pops[i].label, seed);
+        if((rs_n > 0 || ss_n > 0 || stream == 1) && (pops[i].seek = seekOpen(pops[i].path)) != NULL) {
+            for(j = 0; stream == 1 && j < pops[i].seek->chr_n; j++)
+                trackChr(track, pops[i].seek->chrs[j]); /* chromosome ids in file order, so the streamed track can tell chromosomes missing from an outgroup */
+            if(rs_n > 0 || ss_n > 0)
+                seekSets(pops[i].seek, rsets, ssets, chrs, rs_n, ss_n);
+            else {
+                seekFree(pops[i].seek);
+                pops[i].seek = NULL;
+            }
+        }
+        openPop(&pops[i], beagle_files[i], rsets, ssets, rs_n, ss_n, pop_n == 1 && named == 0 && rs_n <= 1 && ss_n <= 1);
+    }
+    readBeagle(pops, rsets, ssets, chrs, track, pop_n, rs_n, ss_n);
+
+    for(i = 0; i < rs_n; i++)
+        free(rsets[i].regions);
+    for(i = 0; i < ss_n; i++)
+        free(ssets[i].sites);
+    free(rsets);
+    free(ssets);
+    free(pops);
+    free(beagle_files);
+    trackClose(track);
+    indexFree(chrs);
 }
 
-Site_s *readSites(FILE *site_file, int *n) {
-    int i, j, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line, *temp;
-    Site_s *list;
-
-    while((c = fgetc(site_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
-        }
+/* Adds the regions to read from an indexed Beagle file: every -region set, or every -sites set without -region */
+void seekSets(Seek_s *seek, Set_s *rsets, Set_s *ssets, Index_s *chrs, int rs_n, int ss_n) {
+    int i, j;
+
+    for(i = 0; i < rs_n; i++) {
+        for(j = 0; j < rsets[i].n; j++)
+            seekAdd(seek, chrs->chrs[rsets[i].regions[j].chr], rsets[i].regions[j].start, rsets[i].regions[j].stop);
+    }
+    for(i = 0; i < ss_n && rs_n == 0; i++) {
+        for(j = 0; j < ssets[i].n; j++)
+            seekAdd(seek, chrs->chrs[ssets[i].sites[j].chr], ssets[i].sites[j].pos, ssets[i].sites[j].pos);
     }
+}
 
-    rewind(site_file);
+/* Splits label=file given to -beagle, -region and -sites at the first '=', so a label cannot contain '='. An argument that is an existing file is taken as a plain
+   file name even if it contains '='. Without a label the file name up to the first dot is used. */
+char *fileLabel(char *arg, char **file) {
+    char *eq = NULL, *label = NULL, *dot = NULL;
 
-    if((list = malloc(line_i * sizeof(Site_s))) == NULL) {
-        fprintf(stderr, merror);
+    if(arg == NULL) {
+        fprintf(stderr, "\nERROR: Missing file name\n\n");
         exit(EXIT_FAILURE);
     }
-
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+    if(access(arg, F_OK) != 0 && (eq = strchr(arg, '=')) != NULL) {
+        *eq = '\0';
+        *file = eq + 1;
+        return arg;
+    }
+    *file = arg;
+    if((label = strrchr(arg, '/')) == NULL)
+        label = arg;
+    else
+        label++;
+    if((label = strdup(label)) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
+    if((dot = strchr(label, '.')) != NULL && dot != label)
+        *dot = '\0';
 
-    while(fgets(line, maxchar + 1, site_file) != NULL) {
-        if(isdigit(line[0])) {
-            lineTerminator(line);
-            list[*n].chr = atoi(strtok(line, "\t"));
-            list[*n].pos = atoi(strtok(NULL, "\t"));
+    return label;
+}
+
+Region_s *readRegions(FILE *region_file, Index_s *chrs, int *n) {
+    int size = 0;
+    char *line, *fields[3];
+    Region_s *list = NULL;
+    Lines_s *lines = NULL;
+
+    lines = linesOpen(region_file);
+    while((line = linesNext(lines)) != NULL) {
+        if(linesSplit(line, fields, 3) == 3 && isdigit(fields[1][0])) {
+            list = linesGrow(list, *n, &size, sizeof(Region_s));
+            list[*n].chr = indexChr(chrs, fields[0]);
+            list[*n].start = atoi(fields[1]);
+            list[*n].stop = atoi(fields[2]);
             *n = *n + 1;
         }
     }
-
-    free(line);
-    fclose(site_file);
+    linesClose(lines);
 
     return list;
 }
 
-Region_s *readCoord(FILE *coord_file, int *n) {
-    int i, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line, *temp;
-    Region_s *list;
-
-    while((c = fgetc(coord_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
+Site_s *readSites(FILE *site_file, Index_s *chrs, int *n) {
+    int size = 0;
+    char *line, *fields[2];
+    Site_s *list = NULL;
+    Lines_s *lines = NULL;
+
+    lines = linesOpen(site_file);
+    while((line = linesNext(lines)) != NULL) {
+        if(linesSplit(line, fields, 2) == 2 && isdigit(fields[1][0])) {
+            list = linesGrow(list, *n, &size, sizeof(Site_s));
+            list[*n].chr = indexChr(chrs, fields[0]);
+            list[*n].pos = atoi(fields[1]);
+            *n = *n + 1;
         }
     }
+    linesClose(lines);
 
-    rewind(coord_file);
+    return list;
+}
 
-    if((list = malloc((line_i) * sizeof(Region_s))) == NULL) {
-        fprintf(stderr, merror);
-        exit(EXIT_FAILURE);
-    }
+/* Stable counting sort of a table by chromosome id, the first int of each record. Returns the sorted copy and frees the original. */
+void *sortChr(void *list, int n, size_t item, int chr_n) {
+    int i, *first = NULL;
+    char *sorted = NULL;
 
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+    if(n == 0)
+        return list;
+    if((first = calloc(chr_n + 1, sizeof(int))) == NULL || (sorted = malloc((size_t)n * item)) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-
-    while(fgets(line, maxchar + 1, coord_file) != NULL) {
-        lineTerminator(line);
-        list[*n].start = atoi(strtok(line, "\t"));
-        list[*n].stop = atoi(strtok(NULL, "\t"));
-        for(i = 0; i < 6; i++)
-            temp = strtok(NULL, "\t");
-        if(isdigit(temp[0])) {
-            list[*n].chr = temp[0] - '0';
-            *n = *n + 1;
-        }
-    }
-
-    free(line);
-    fclose(coord_file);
-
-    return list;
+    for(i = 0; i < n; i++)
+        first[*(int *)((char *)list + i * item) + 1]++;
+    for(i = 0; i < chr_n; i++)
+        first[i + 1] += first[i];
+    for(i = 0; i < n; i++)
+        memcpy(sorted + (size_t)first[*(int *)((char *)list + i * item)]++ * item, (char *)list + i * item, item);
+    free(first);
+    free(list);
+
+    return sorted;
 }
 
-Site_s *readDiv(FILE *div_file, int *n) {
-    int i, j, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line, *temp;
-    Site_s *list;
-
-    while((c = fgetc(div_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
-        }
+/* Index of the first record of chromosome chr (or of the next chromosome) in a table sorted with sortChr() */
+int firstChr(void *list, int n, size_t item, int chr) {
+    int lo = 0, hi = n, mid;
+
+    while(lo < hi) {
+        mid = (lo + hi) / 2;
+        if(*(int *)((char *)list + mid * item) < chr)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    rewind(div_file);
+    return lo;
+}
 
-    if((list = malloc(line_i * sizeof(Site_s))) == NULL) {
+/* Opens the Beagle file of a population and its outputs, stdout and info.txt for a single set, otherwise one file pair per combination of region and site set */
+void openPop(Pop_s *pop, FILE *beagle_file, Set_s *rsets, Set_s *ssets, int rs_n, int ss_n, int single) {
+    int r, s, c, comb_n;
+    char name[1024];
+    FILE *file = NULL;
+
+    comb_n = (rs_n > 0 ? rs_n : 1) * (ss_n > 0 ? ss_n : 1);
+    pop->beagle = beagleOpen(beagle_file);
+    if(pop->seek != NULL)
+        beagleSeek(pop->beagle, pop->seek);
+    pop->chr = -1;
+    pop->out_chr = -1;
+    if((pop->rg_i = calloc(rs_n + 1, sizeof(int))) == NULL || (pop->site_i = calloc(ss_n + 1, sizeof(int))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+    if((pop->out = malloc(comb_n * sizeof(Writer_s *))) == NULL || (pop->info = malloc(comb_n * sizeof(Writer_s *))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-
-    while(fgets(line, maxchar + 1, div_file) != NULL) {
-        lineTerminator(line);
-        list[*n].pos = atoi(strtok(line, "\t"));
-        temp = strtok(NULL, "\t");
-        list[*n].ref = temp[0];
-        temp = strtok(NULL, "\t");
-        list[*n].alt = temp[0];
-        for(i = 0; i < 6; i++)
-            temp = strtok(NULL, "\t");
-        if(isdigit(temp[0])) {
-            list[*n].chr = temp[0] - '0';
-            *n = *n + 1;
+    if(single) {
+        if((file = fopen("info.txt", "w")) == NULL) {
+            fprintf(stderr, "\nERROR: Cannot create file 'info.txt' \n\n");
+            exit(EXIT_FAILURE);
+        }
+        pop->out[0] = writerOpen(stdout);
+        pop->info[0] = writerOpen(file);
+        return;
+    }
+    for(r = 0, c = 0; r < (rs_n > 0 ? rs_n : 1); r++) {
+        for(s = 0; s < (ss_n > 0 ? ss_n : 1); s++, c++) {
+            snprintf(name, sizeof(name), "%s%s%s%s%s_est-sfs.txt", pop->label, rs_n > 0 ? "_" : "", rs_n > 0 ? rsets[r].label : "", ss_n > 0 ? "_" : "", ss_n > 0 ? ssets[s].label : "");
+            if((file = fopen(name, "w")) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot create file '%s' \n\n", name);
+                exit(EXIT_FAILURE);
+            }
+            pop->out[c] = writerOpen(file);
+            strcpy(name + strlen(name) - strlen("est-sfs.txt"), "info.txt");
+            if((file = fopen(name, "w")) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot create file '%s' \n\n", name);
+                exit(EXIT_FAILURE);
+            }
+            pop->info[c] = writerOpen(file);
         }
     }
-
-    free(line);
-    fclose(div_file);
-
-    return list;
 }
 
-void readBeagle(FILE *beagle_file, Region_s *coord1, Region_s *coord2, Region_s *coord3, Region_s *regions, Site_s *div1, Site_s *div2, Site_s *div3, Site_s *sites, int co_n1, int co_n2, int co_n3, int rg_n, int div_n1, int div_n2, int div_n3, int site_n) {
-    int i, j = 0, chr = 0, pos = 0, co_i1 = 0, co_i2 = 0, co_i3 = 0, rg_i = 0, div_i1 = 0, div_i2 = 0, div_i3 = 0, site_i = 0, ok = 0;
-    double ref_i = 0, alt_i = 0, mis_i = 0, p = 0, ind[3] = {0};
-    char ref = 'N', alt = 'N', out1 = 'N', out2 = 'N', out3 = 'N', *line = NULL, *loc = NULL, *temp = NULL, *end = NULL;
-    size_t len = 0;
-    ssize_t read;
-    FILE *out_file;
+/* Merges the Beagle files by position. The outgroup states of a position are looked up once and used for every file that has the site. */
+void readBeagle(Pop_s *pops, Set_s *rsets, Set_s *ssets, Index_s *chrs, Track_s *track, int pop_n, int rs_n, int ss_n) {
+    int i, o, min = -1, chr = -1, pos = 0, states[3], comb_n;
 
-    srand(time(NULL));
+    for(i = 0; i < pop_n; i++)
+        nextSite(&pops[i], rsets, ssets, chrs, track, rs_n, ss_n);
 
-    if((out_file = fopen("info.txt", "w")) == NULL) {
-        fprintf(stderr, "\nERROR: Cannot create file 'info.txt' \n\n");
-        exit(EXIT_FAILURE);
+    while(1) {
+        min = -1;
+        for(i = 0; i < pop_n; i++) {
+            if(pops[i].eof == 0 && (min < 0 || pops[i].out_chr < pops[min].out_chr || (pops[i].out_chr == pops[min].out_chr && pops[i].beagle->pos < pops[min].beagle->pos)))
+                min = i;
+        }
+        if(min < 0)
+            break;
+        chr = pops[min].out_chr;
+        pos = pops[min].beagle->pos;
+        for(o = 0; o < 3; o++)
+            states[o] = trackState(track, chr, o, pos);
+        for(i = 0; i < pop_n; i++) {
+            if(pops[i].eof == 1 || pops[i].out_chr != chr || pops[i].beagle->pos != pos)
+                continue;
+            printSite(&pops[i], rsets, ssets, states, rs_n, ss_n);
+            nextSite(&pops[i], rsets, ssets, chrs, track, rs_n, ss_n);
+        }
     }
 
-    while((read = getline(&line, &len, beagle_file)) != -1) {
-        if(line[0] == '\n' || line[0] == 'm')
-            continue;
-        lineTerminator(line);
-        temp = strtok_r(line, "\t", &end);
-        chr = atoi(strtok(temp, "_"));
-        pos = atoi(strtok(NULL, "_"));
-        if(rg_n > 0) {
-            while(rg_i < rg_n) {
-                if(chr == regions[rg_i].chr) {
-                    if(pos <= regions[rg_i].stop && pos >= regions[rg_i].start) {
-                        ok = 1;
-                        break;
-                    } else if(pos < regions[rg_i].start)
-                        break;
-                } else if(chr < regions[rg_i].chr)
-                    break;
-                rg_i++;
-            }
-            if(ok == 0)
-                continue;
+    comb_n = (rs_n > 0 ? rs_n : 1) * (ss_n > 0 ? ss_n : 1);
+    for(i = 0; i < pop_n; i++) {
+        for(o = 0; o < comb_n; o++) {
+            writerClose(pops[i].out[o]);
+            writerClose(pops[i].info[o]);
         }
-        if(site_n > 0) {
-            ok = 0;
-            while(site_i < site_n) {
-                if(chr == sites[site_i].chr) {
-                    if(pos == sites[site_i].pos) {
-                        ok = 1;
-                        break;
-                    } else if(pos < sites[site_i].pos)
-                        break;
-                } else if(chr < sites[site_i].chr)
-                    break;
-                site_i++;
+        free(pops[i].out);
+        free(pops[i].info);
+        free(pops[i].rg_i);
+        free(pops[i].site_i);
+        free(pops[i].last);
+        beagleClose(pops[i].beagle);
+    }
+}
+
+/* Moves a population to its next site on a chromosome covered by the outgroup track. Returns 0 at the end of the file. */
+int nextSite(Pop_s *pop, Set_s *rsets, Set_s *ssets, Index_s *chrs, Track_s *track, int rs_n, int ss_n) {
+    int i;
+
+    while(beagleNext(pop->beagle)) {
+        if(pop->last == NULL || strcmp(pop->beagle->chr, pop->last) != 0) {
+            /* new chromosome: move the region and site cursors to its first record */
+            free(pop->last);
+            if((pop->last = strdup(pop->beagle->chr)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
             }
-            if(ok == 0)
-                continue;
+            pop->chr = indexGetChr(chrs, pop->beagle->chr);
+            pop->out_chr = trackChr(track, pop->beagle->chr);
+            for(i = 0; i < rs_n; i++)
+                pop->rg_i[i] = firstChr(rsets[i].regions, rsets[i].n, sizeof(Region_s), pop->chr);
+            for(i = 0; i < ss_n; i++)
+                pop->site_i[i] = firstChr(ssets[i].sites, ssets[i].n, sizeof(Site_s), pop->chr);
         }
-        i = 1;
-        ref_i = 0;
-        alt_i = 0;
-        mis_i = 0;
-        ok = 0;
-        out1 = 'N';
-        out2 = 'N';
-        out3 = 'N';
-        while(temp != NULL) {
-            if(i == 2) {
-                if(temp[0] == '0')
-                    ref = 'A';
-                else if(temp[0] == '1')
-                    ref = 'C';
-                else if(temp[0] == '2')
-                    ref = 'G';
-                else
-                    ref = 'T';
-            } else if(i == 3) {
-                if(temp[0] == '0')
-                    alt = 'A';
-                else if(temp[0] == '1')
-                    alt = 'C';
-                else if(temp[0] == '2')
-                    alt = 'G';
-                else
-                    alt = 'T';
-                ok = 0;
-                out1 = defOut(coord1, div1, ref, chr, pos, co_n1, div_n1, &co_i1, &div_i1);
-                out2 = defOut(coord2, div2, ref, chr, pos, co_n2, div_n2, &co_i2, &div_i2);
-                out3 = defOut(coord3, div3, ref, chr, pos, co_n3, div_n3, &co_i3, &div_i3);
-                if((out1 == 'N' && out2 == 'N') || (out1 == 'N' && out3 == 'N') || (out2 == 'N' && out3 == 'N'))
-                    break;
-            } else if(i > 3) {
-                ind[j] = atof(temp);
-                j++;
-                if(j == 3) {
-                    if(ind[0] != NA | ind[1] != NA | ind[2] != NA) {
-                        ref_i += 2 * ind[0] + ind[1];
-                        alt_i += ind[1] + 2 * ind[2];
-                    } else
-                        mis_i += 2;
-                    j = 0;
-                }
-            }
-            temp = strtok_r(NULL, "\t", &end);
-            i++;
+        if(pop->out_chr >= 0)
+            return 1;
+    }
+    pop->eof = 1;
+
+    return 0;
+}
+
+/* Writes the current site of a population to every combination of region and site set that includes it */
+void printSite(Pop_s *pop, Set_s *rsets, Set_s *ssets, int *states, int rs_n, int ss_n) {
+    int i, r, s, c, ok = 0, pos = pop->beagle->pos, rok[rs_n + 1], sok[ss_n + 1];
+    double ref_i = 0, alt_i = 0, mis_i = 0, p = 0;
+    char ref = 'N', alt = 'N', out1 = 'N', out2 = 'N', out3 = 'N';
+    Beagle_s *beagle = pop->beagle;
+    Rng_s rng;
+
+    rok[0] = 1;
+    sok[0] = 1;
+    for(r = 0; r < rs_n; r++)
+        ok += rok[r] = inRegion(&rsets[r], &pop->rg_i[r], pop->chr, pos);
+    if(rs_n > 0 && ok == 0)
+        return;
+    for(s = 0, ok = 0; s < ss_n; s++)
+        ok += sok[s] = inSite(&ssets[s], &pop->site_i[s], pop->chr, pos);
+    if(ss_n > 0 && ok == 0)
+        return;
+    if(beagle->major == '0')
+        ref = 'A';
+    else if(beagle->major == '1')
+        ref = 'C';
+    else if(beagle->major == '2')
+        ref = 'G';
+    else
+        ref = 'T';
+    if(beagle->minor == '0')
+        alt = 'A';
+    else if(beagle->minor == '1')
+        alt = 'C';
+    else if(beagle->minor == '2')
+        alt = 'G';
+    else
+        alt = 'T';
+    out1 = trackStateBase(states[0], ref);
+    out2 = trackStateBase(states[1], ref);
+    out3 = trackStateBase(states[2], ref);
+    if((out1 == 'N' && out2 == 'N') || (out1 == 'N' && out3 == 'N') || (out2 == 'N' && out3 == 'N'))
+        return;
+    beagleProbs(beagle);
+    for(i = 0; i < beagle->ind_n; i++) {
+        if(beagle->miss[i] == 0) {
+            ref_i += 2 * beagle->p0[i] + beagle->p1[i];
+            alt_i += beagle->p1[i] + 2 * beagle->p2[i];
+        } else
+            mis_i += 2;
+    }
+    if(mis_i > 0) {
+        p = round(alt_i) / round(ref_i + alt_i);
+        if(p == 0)
+            ref_i += mis_i;
+        else if(p == 1)
+            alt_i += mis_i;
+        else {
+            rngInit(&rng, pop->seed, rngHash(beagle->chr, 0), pos);
+            i = rngBinomial(&rng, mis_i, p);
+            alt_i += i;
+            ref_i += mis_i - i;
         }
-        if(temp != NULL)
-            continue;
-        if(mis_i > 0) {
-            p = round(alt_i) / round(ref_i + alt_i);
-            if(p == 0)
-                ref_i += mis_i;
-            else if(p == 1)
-                alt_i += mis_i;
-            else {
-                for(i = 0; i < mis_i; i++) {
-                    if((double)rand() / RAND_MAX < p)
-                        alt_i++;
-                    else
-                        ref_i++;
-                }
-            }
+    }
+    ref_i = round(ref_i);
+    alt_i = round(alt_i);
+    for(r = 0, c = 0; r < (rs_n > 0 ? rs_n : 1); r++) {
+        for(s = 0; s < (ss_n > 0 ? ss_n : 1); s++, c++) {
+            if(rok[r] == 0 || sok[s] == 0)
+                continue;
+            writerStr(pop->info[c], beagle->chr);
+            writerChar(pop->info[c], '\t');
+            writerInt(pop->info[c], pos);
+            writerChar(pop->info[c], '\n');
+            printCount(pop->out[c], 'A', ref, alt, ref_i, alt_i, ',');
+            printCount(pop->out[c], 'C', ref, alt, ref_i, alt_i, ',');
+            printCount(pop->out[c], 'G', ref, alt, ref_i, alt_i, ',');
+            printCount(pop->out[c], 'T', ref, alt, ref_i, alt_i, '\t');
+            printOut(pop->out[c], out1, 0);
+            printOut(pop->out[c], out2, 0);
+            printOut(pop->out[c], out3, 1);
         }
-        fprintf(out_file, "%i\t%i\n", chr, pos);
-        ref_i = round(ref_i);
-        alt_i = round(alt_i);
-        if(ref == 'A')
-            printf("%.0f,", ref_i);
-        else if(alt == 'A')
-            printf("%.0f,", alt_i);
-        else
-            printf("0,");
-        if(ref == 'C')
-            printf("%.0f,", ref_i);
-        else if(alt == 'C')
-            printf("%.0f,", alt_i);
-        else
-            printf("0,");
-        if(ref == 'G')
-            printf("%.0f,", ref_i);
-        else if(alt == 'G')
-            printf("%.0f,", alt_i);
-        else
-            printf("0,");
-        if(ref == 'T')
-            printf("%.0f\t", ref_i);
-        else if(alt == 'T')
-            printf("%.0f\t", alt_i);
-        else
-            printf("0\t");
-        printOut(out1, 0);
-        printOut(out2, 0);
-        printOut(out3, 1);
     }
-    free(line);
-    free(coord1);
-    free(coord2);
-    free(coord3);
-    free(div1);
-    free(div2);
-    free(div3);
-    if(rg_n > 0)
-        free(regions);
-    if(site_n > 0)
-        free(sites);
-    fclose(beagle_file);
 }
 
-char defOut(Region_s *coord, Site_s *div, char ref, int chr, int pos, int co_n, int div_n, int *co_i, int *div_i) {
-    int ok = 0;
-
-    while(*co_i < co_n) {
-        if(chr == coord[*co_i].chr) {
-            if(pos <= coord[*co_i].stop && pos >= coord[*co_i].start) {
-                ok = 1;
-                while(*div_i < div_n) {
-                    if(chr == div[*div_i].chr) {
-                        if(pos == div[*div_i].pos) {
-                            ok = 2;
-                            break;
-                        } else if(pos < div[*div_i].pos)
-                            break;
-                    } else if(chr < div[*div_i].chr)
-                        break;
-                    *div_i = *div_i + 1;
-                }
-                if(ok == 1)
-                    return ref;
-                else if(ok == 2) {
-                    if(div[*div_i].alt == '.')
-                        return 'N';
-                    else
-                        return div[*div_i].alt;
-                }
-                break;
-            } else if(pos < coord[*co_i].start)
-                break;
-        } else if(chr < coord[*co_i].chr)
-            break;
-        *co_i = *co_i + 1;
+/* Moves the cursor of a region set to the site and returns 1 if a region includes it */
+int inRegion(Set_s *set, int *i, int chr, int pos) {
+    while(*i < set->n) {
+        if(chr == set->regions[*i].chr) {
+            if(pos <= set->regions[*i].stop && pos >= set->regions[*i].start)
+                return 1;
+            else if(pos < set->regions[*i].start)
+                return 0;
+        } else if(chr < set->regions[*i].chr)
+            return 0;
+        *i = *i + 1;
     }
 
-    return 'N';
+    return 0;
 }
 
-void printOut(char nuc, int end) {
-    if(end == 0) {
-        if(nuc == 'A')
-            printf("1,0,0,0 ");
-        else if(nuc == 'C')
-            printf("0,1,0,0 ");
-        else if(nuc == 'G')
-            printf("0,0,1,0 ");
-        else if(nuc == 'T')
-            printf("0,0,0,1 ");
-        else
-            printf("0,0,0,0 ");
-    } else {
-        if(nuc == 'A')
-            printf("1,0,0,0\n");
-        else if(nuc == 'C')
-            printf("0,1,0,0\n");
-        else if(nuc == 'G')
-            printf("0,0,1,0\n");
-        else if(nuc == 'T')
-            printf("0,0,0,1\n");
-        else
-            printf("0,0,0,0\n");
+/* Moves the cursor of a site set to the site and returns 1 if the set includes it */
+int inSite(Set_s *set, int *i, int chr, int pos) {
+    while(*i < set->n) {
+        if(chr == set->sites[*i].chr) {
+            if(pos == set->sites[*i].pos)
+                return 1;
+            else if(pos < set->sites[*i].pos)
+                return 0;
+        } else if(chr < set->sites[*i].chr)
+            return 0;
+        *i = *i + 1;
     }
+
+    return 0;
 }
 
-void lineTerminator(char *line) {
-    int i;
-    for(i = 0; line[i] != 0; i++) {
-        if(line[i] == '\n' || line[i] == '\r')
-            line[i] = '\0';
-    }
+/* Allele count of one base in the population */
+void printCount(Writer_s *out, char nuc, char ref, char alt, double ref_i, double alt_i, char sep) {
+    if(ref == nuc)
+        writerFloat(out, ref_i, 0);
+    else if(alt == nuc)
+        writerFloat(out, alt_i, 0);
+    else
+        writerChar(out, '0');
+    writerChar(out, sep);
+}
+
+void printOut(Writer_s *out, char nuc, int end) {
+    if(nuc == 'A')
+        writerStr(out, "1,0,0,0");
+    else if(nuc == 'C')
+        writerStr(out, "0,1,0,0");
+    else if(nuc == 'G')
+        writerStr(out, "0,0,1,0");
+    else if(nuc == 'T')
+        writerStr(out, "0,0,0,1");
+    else
+        writerStr(out, "0,0,0,0");
+    writerChar(out, end == 0 ? ' ' : '\n');
+}
+
+int isNumeric(const char *s) {
+    char *p;
+
+    if(s == NULL || *s == '\0' || isspace(*s))
+        return 0;
+    strtod(s, &p);
+    return *p == '\0';
 }
@@ -0,0 +1,139 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Partial results and merging. See partial.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lines.h"
+#include "partial.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+void partError(const char *path, const char *what);
+
+/* Reads a partial file into a new table (p NULL) or adds its sums to those of p */
+Part_s *partRead(Part_s *p, FILE *file, const char *path) {
+    int i, j, first = 0, row_i = 0;
+    double x = 0;
+    char *line = NULL, *end = NULL, *next = NULL;
+    Lines_s *lines = NULL;
+
+    lines = linesOpen(file);
+    if((line = linesNext(lines)) == NULL || strncmp(line, "#partial\t", 9) != 0)
+        partError(path, "is not a partial file");
+    if(p == NULL) {
+        first = 1;
+        if((p = calloc(1, sizeof(Part_s))) == NULL || (p->head = strdup(line)) == NULL || (p->meta = malloc((strlen(line) + 1) * sizeof(char *))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        p->meta[p->meta_n++] = p->head;
+        for(end = p->head; (end = strchr(end, '\t')) != NULL;) {
+            *end++ = '\0';
+            p->meta[p->meta_n++] = end;
+        }
+        if((i = partGet(p, "keys")) < 0 || (p->key_n = atoi(p->meta[i])) < 1)
+            partError(path, "has no key columns");
+    } else {
+        /* the settings must match those of the first file field by field */
+        for(i = 0, end = line; i < p->meta_n; i++) {
+            j = strlen(p->meta[i]);
+            if(strncmp(end, p->meta[i], j) != 0 || end[j] != (i < p->meta_n - 1 ? '\t' : '\0'))
+                partError(path, "was not made with the same settings as the first partial file");
+            end += j + 1;
+        }
+    }
+
+    if((line = linesNext(lines)) == NULL)
+        partError(path, "has no column header");
+    for(i = 1, end = line; (end = strchr(end, '\t')) != NULL; end++)
+        i++;
+    if(first == 1)
+        p->col_n = i - p->key_n;
+    if(p->col_n < 1 || i - p->key_n != p->col_n)
+        partError(path, "does not have the columns of the first partial file");
+
+    while((line = linesNext(lines)) != NULL) {
+        if(*line == '\0')
+            continue;
+        for(i = 0, end = line; i < p->key_n && end != NULL; i++)
+            end = strchr(end + (i > 0), '\t');
+        if(end == NULL)
+            partError(path, "has a row without sums");
+        *end = '\0';
+        if(first == 1) {
+            p->keys = linesGrow(p->keys, p->row_n, &p->size, sizeof(char *));
+            if((p->keys[p->row_n] = strdup(line)) == NULL || (p->vals = realloc(p->vals, (size_t)p->size * p->col_n * sizeof(double))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            memset(p->vals + (size_t)p->row_n * p->col_n, 0, p->col_n * sizeof(double));
+            p->row_n++;
+        } else if(row_i >= p->row_n || strcmp(p->keys[row_i], line) != 0)
+            partError(path, "does not list the same genes in the same order as the first partial file");
+        *end = '\t';
+        for(j = 0; j < p->col_n; j++) {
+            x = 0;
+            if(*end != '\t' || (x = strtod(end + 1, &next), next == end + 1))
+                partError(path, "has a row with missing or non-numeric sums");
+            p->vals[(size_t)row_i * p->col_n + j] += x;
+            end = next;
+        }
+        if(*end != '\0')
+            partError(path, "has a row with too many columns");
+        row_i++;
+    }
+    if(row_i != p->row_n)
+        partError(path, "does not list the same genes in the same order as the first partial file");
+    linesClose(lines);
+    p->file_n++;
+
+    return p;
+}
+
+/* Index of the value of name in the settings line (name value pairs after the program), -1 if there is none */
+int partGet(Part_s *p, const char *name) {
+    int i;
+
+    for(i = 2; i < p->meta_n - 1; i += 2) {
+        if(strcmp(p->meta[i], name) == 0)
+            return i + 1;
+    }
+
+    return -1;
+}
+
+void partError(const char *path, const char *what) {
+    fprintf(stderr, "\nERROR: %s %s!\n\n", path, what);
+    exit(EXIT_FAILURE);
+}
+
+void partFree(Part_s *p) {
+    int i;
+
+    if(p == NULL)
+        return;
+    for(i = 0; i < p->row_n; i++)
+        free(p->keys[i]);
+    free(p->keys);
+    free(p->vals);
+    free(p->meta);
+    free(p->head);
+    free(p);
+}
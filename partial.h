@@ -0,0 +1,49 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Partial results of runs split by chromosome, region or sites (-partial in probs2fst and probs2pi) and merging them (-merge).
+ A partial file is a tab-delimited table: a settings line, a column header and one row per gene (population, pair) with key columns followed by the raw sums.
+    #partial  prog  keys  [key_n]  [name  value]...  pops  [pop_n]  [names]...
+ Sums are written with 17 significant digits so they are read back exactly. Shards are merged only if their settings lines are identical
+ and they list the same rows in the same order. The values of each row are added in the order of the files.
+
+ Typical use:
+    p = partRead(NULL, file, path);
+    p = partRead(p, file2, path2);
+    bp = atoi(p->meta[partGet(p, "bp")]);
+    ...row i has key p->keys[i] and values p->vals[i * p->col_n] ... p->vals[i * p->col_n + p->col_n - 1]...
+    partFree(p);
+*/
+
+#ifndef PARTIAL_H
+#define PARTIAL_H
+
+#include <stdio.h>
+
+typedef struct {
+    char *head;   /* settings line of the first file */
+    char **meta;  /* settings split into fields */
+    int meta_n, key_n, col_n, row_n, size, file_n;
+    char **keys;  /* key columns of each row, joined by tabs */
+    double *vals; /* col_n sums of each row */
+} Part_s;
+
+Part_s *partRead(Part_s *p, FILE *file, const char *path);
+int partGet(Part_s *p, const char *name);
+void partFree(Part_s *p);
+
+#endif
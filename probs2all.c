@@ -0,0 +1,345 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Program for running probs2fst, probs2pi and make_est-sfs on the same Beagle file with a single decompress-and-parse pass.
+ The Beagle file is parsed once into a binary columnar file (as with beagle2bin), and the programs are then run at the same time on the binary file,
+ which they read through mmap without parsing. Each program keeps its own options and output, and the results are identical to running it on the Beagle file.
+ probs2fst, probs2pi, make_est-sfs and beagle2bin are looked up from the directory of probs2all, or from PATH.
+
+ Compiling: gcc probs2all.c -o probs2all
+
+ Usage:
+ -beagle [file] Posterior genotype probabilities in Beagle format. Can be gzip or BGZF compressed, or already converted with beagle2bin (the parsing step is then skipped).
+ -store [file] Name of the binary file, which is kept. Optional, by default a temporary file label.probs2all_[pid].bin in the current directory that is removed at the end.
+    make_est-sfs labels the file (and seeds the imputation of missing data) by the file name up to the first dot, so keep the label of the Beagle file for identical results.
+ -fst [options] Run probs2fst with the options that follow, up to the next -fst, -pi or -sfs.
+ -pi [options] Run probs2pi with the options that follow.
+ -sfs [options] Run make_est-sfs with the options that follow.
+ -out [file] Within -fst, -pi or -sfs: file for the output the program prints. Required for all but one of them.
+ The programs can be given in any combination and more than once.
+
+ Example:
+ ./probs2all -beagle postprobs.beagle.gz \
+    -fst -pop list1.txt -pop list2.txt -genes genes.txt -bp 1000 -out fst.txt \
+    -pi -genes genes.txt -bp 1000 -out pi.txt \
+    -sfs -track lyrata.track -sites 0fold.sites -out 0fold_est-sfs.txt
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#define merror "\nERROR: System out of memory\n\n"
+#define STORE_MAGIC "BGLSTOR1"
+
+/* One program run on the binary file */
+typedef struct {
+    char *prog, *out;
+    char **args;
+    int n;
+    pid_t pid;
+} Consumer_s;
+
+void openFiles(int argc, char *argv[]);
+Consumer_s *addConsumer(Consumer_s *list, int *n, char *prog);
+void addArg(Consumer_s *c, char *arg);
+int isStore(const char *path);
+char *progPath(const char *name);
+pid_t runProg(char *path, char **args, const char *out);
+int waitProg(pid_t pid, const char *name);
+char *beagleLabel(const char *path);
+char *consumerProg(const char *arg);
+
+int main(int argc, char *argv[]) {
+    int second = 0, minute = 0, hour = 0;
+    time_t timer = 0;
+
+    timer = time(NULL);
+    openFiles(argc, argv);
+    second = time(NULL) - timer;
+    minute = second / 60;
+    hour = second / 3600;
+
+    fprintf(stderr, "\nDone!");
+    if(hour > 0)
+        fprintf(stderr, "\nElapsed time: %i h, %i min & %i sec\n\n", hour, minute - hour * 60, second - minute * 60);
+    else if(minute > 0)
+        fprintf(stderr, "\nElapset time: %i min & %i sec\n\n", minute, second - minute * 60);
+    else if(second > 5)
+        fprintf(stderr, "\nElapsed time: %i sec\n\n", second);
+    else
+        fprintf(stderr, "\n\n");
+
+    return 0;
+}
+
+void openFiles(int argc, char *argv[]) {
+    int i, con_n = 0, stdout_n = 0, temp = 0, fail = 0;
+    char *beagle_path = NULL, *store_path = NULL, *path = NULL, *label = NULL, *prog = NULL, *args[6];
+    char name[1024];
+    Consumer_s *cons = NULL, *c = NULL;
+
+    fprintf(stderr, "\nParameters:\n");
+
+    for(i = 1; i < argc; i++) {
+        if((prog = consumerProg(argv[i])) != NULL) {
+            fprintf(stderr, "\t%s", argv[i]);
+            cons = addConsumer(cons, &con_n, prog);
+            c = &cons[con_n - 1];
+        }
+
+        else if(c != NULL && strcmp(argv[i], "-out") == 0) {
+            if(argv[++i] == NULL) {
+                fprintf(stderr, "\nERROR: Missing file name\n\n");
+                exit(EXIT_FAILURE);
+            }
+            c->out = argv[i];
+            fprintf(stderr, " -out %s", argv[i]);
+        }
+
+        else if(c != NULL) {
+            if(strcmp(argv[i], "-beagle") == 0) {
+                fprintf(stderr, "\nERROR: -beagle is given once, before -fst, -pi and -sfs\n\n");
+                exit(EXIT_FAILURE);
+            }
+            addArg(c, argv[i]);
+            fprintf(stderr, " %s", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-beagle") == 0) {
+            if(argv[++i] == NULL || access(argv[i], R_OK) != 0) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-beagle %s\n", argv[i]);
+            beagle_path = argv[i];
+        }
+
+        else if(strcmp(argv[i], "-store") == 0) {
+            if(argv[++i] == NULL) {
+                fprintf(stderr, "\nERROR: Missing file name\n\n");
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-store %s\n", argv[i]);
+            store_path = argv[i];
+        }
+
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+
+        if(c != NULL && (i + 1 >= argc || consumerProg(argv[i + 1]) != NULL))
+            fprintf(stderr, "\n");
+    }
+
+    fprintf(stderr, "\n");
+
+    if(beagle_path == NULL || con_n == 0) {
+        fprintf(stderr, "\nERROR: -beagle [file] and at least one of -fst, -pi and -sfs are required!\n");
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < con_n; i++)
+        stdout_n += cons[i].out == NULL;
+    if(stdout_n > 1) {
+        fprintf(stderr, "\nERROR: -out [file] is required for all but one of -fst, -pi and -sfs!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* the shared parsing step */
+    if(isStore(beagle_path))
+        store_path = beagle_path;
+    else {
+        if(store_path == NULL) {
+            label = beagleLabel(beagle_path);
+            snprintf(name, sizeof(name), "%s.probs2all_%i.bin", label, (int)getpid());
+            free(label);
+            store_path = name;
+            temp = 1;
+        }
+        fprintf(stderr, "Parsing %s into %s\n", beagle_path, store_path);
+        path = progPath("beagle2bin");
+        args[0] = path;
+        args[1] = "-beagle";
+        args[2] = beagle_path;
+        args[3] = "-out";
+        args[4] = store_path;
+        args[5] = NULL;
+        if(waitProg(runProg(path, args, NULL), "beagle2bin") != 0) {
+            if(temp)
+                unlink(store_path);
+            exit(EXIT_FAILURE);
+        }
+        free(path);
+    }
+
+    for(i = 0; i < con_n; i++) {
+        c = &cons[i];
+        path = progPath(c->prog);
+        c->args[0] = path;
+        addArg(c, "-beagle");
+        addArg(c, store_path);
+        addArg(c, NULL);
+        fprintf(stderr, "Running %s%s%s\n", c->prog, c->out != NULL ? " > " : "", c->out != NULL ? c->out : "");
+        c->pid = runProg(path, c->args, c->out);
+    }
+    for(i = 0; i < con_n; i++) {
+        if(waitProg(cons[i].pid, cons[i].prog) != 0)
+            fail = 1;
+    }
+
+    if(temp)
+        unlink(store_path);
+    for(i = 0; i < con_n; i++) {
+        free(cons[i].args[0]);
+        free(cons[i].args);
+    }
+    free(cons);
+
+    if(fail) {
+        fprintf(stderr, "\nERROR: Not all programs finished successfully\n\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+Consumer_s *addConsumer(Consumer_s *list, int *n, char *prog) {
+    if((list = realloc(list, (*n + 1) * sizeof(Consumer_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memset(&list[*n], 0, sizeof(Consumer_s));
+    list[*n].prog = prog;
+    addArg(&list[*n], prog); /* replaced by the path */
+    *n = *n + 1;
+
+    return list;
+}
+
+void addArg(Consumer_s *c, char *arg) {
+    if((c->args = realloc(c->args, (c->n + 1) * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    c->args[c->n++] = arg;
+}
+
+/* 1 if the file is a binary Beagle file written by beagle2bin */
+int isStore(const char *path) {
+    char magic[8] = {0};
+    FILE *file = NULL;
+
+    if((file = fopen(path, "rb")) == NULL)
+        return 0;
+    if(fread(magic, 1, 8, file) != 8)
+        memset(magic, 0, 8);
+    fclose(file);
+
+    return memcmp(magic, STORE_MAGIC, 8) == 0;
+}
+
+/* Path of a program in the directory of this program, or the plain name to be searched from PATH */
+char *progPath(const char *name) {
+    char self[4096], *path = NULL, *slash = NULL;
+    ssize_t len;
+
+    if((path = malloc(sizeof(self) + strlen(name) + 2)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if((len = readlink("/proc/self/exe", self, sizeof(self) - 1)) > 0) {
+        self[len] = '\0';
+        if((slash = strrchr(self, '/')) != NULL) {
+            sprintf(path, "%.*s/%s", (int)(slash - self), self, name);
+            if(access(path, X_OK) == 0)
+                return path;
+        }
+    }
+    strcpy(path, name);
+
+    return path;
+}
+
+/* Starts a program with its output written to out (stdout if NULL) */
+pid_t runProg(char *path, char **args, const char *out) {
+    int fd;
+    pid_t pid;
+
+    fflush(stdout);
+    fflush(stderr);
+    if((pid = fork()) < 0) {
+        fprintf(stderr, "\nERROR: Cannot start %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if(pid > 0)
+        return pid;
+    if(out != NULL) {
+        if((fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+            fprintf(stderr, "\nERROR: Cannot create file %s\n\n", out);
+            _exit(EXIT_FAILURE);
+        }
+        dup2(fd, 1);
+        close(fd);
+    }
+    execvp(path, args);
+    fprintf(stderr, "\nERROR: Cannot run %s (compile it into the directory of probs2all or add it to PATH)\n\n", path);
+    _exit(EXIT_FAILURE);
+}
+
+int waitProg(pid_t pid, const char *name) {
+    int status = 0;
+
+    if(waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "\nERROR: %s failed\n\n", name);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Program run by -fst, -pi and -sfs, NULL for other arguments */
+char *consumerProg(const char *arg) {
+    if(strcmp(arg, "-fst") == 0)
+        return "probs2fst";
+    if(strcmp(arg, "-pi") == 0)
+        return "probs2pi";
+    if(strcmp(arg, "-sfs") == 0)
+        return "make_est-sfs";
+
+    return NULL;
+}
+
+/* The label make_est-sfs gives to a file: the file name up to the first dot */
+char *beagleLabel(const char *path) {
+    char *label = NULL, *dot = NULL;
+    const char *base = NULL;
+
+    if((base = strrchr(path, '/')) == NULL)
+        base = path;
+    else
+        base++;
+    if((label = strdup(base)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if((dot = strchr(label, '.')) != NULL && dot != label)
+        *dot = '\0';
+
+    return label;
+}
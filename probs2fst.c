@@ -17,29 +17,69 @@
 
  Program for estimating Weir & Cockerham's Fst across arbitrary number of populations using genotype probabilities.
 
- Compiling: gcc probs2fst.c -o probs2fst -lm
+ Compiling: gcc probs2fst.c beagle.c bgzf.c interval.c jackknife.c lines.c partial.c samples.c seek.c simd.c sitebin.c stats.c window.c writer.c -o probs2fst -lm -lz -lpthread
 
  Usage:
- -beagle [file] Posterior genotype probabilities in Beagle format (generated e.g. with Angsd or PCAngsd).
- -pop [file] File listing individuals from a single population. Can be used >= 2 times.
- -genes [file] Tab delimited file listing genes (format chr, start, end, strand [+ or -], id). Optional.
+ -beagle [file] Posterior genotype probabilities in Beagle format (generated e.g. with Angsd or PCAngsd). Can be gzip or BGZF compressed, or converted with beagle2bin (optionally quantised with -bits).
+ -pop [file] File listing individuals from a single population. Can be used >= 2 times. Duplicated names and names missing from the Beagle file are reported.
+ -genes [file] Tab delimited file listing genes (format chr, start, end, strand [+ or -], id). Does not need to be sorted. Optional.
+    If the Beagle file has been indexed with beagle2idx, only the parts covering the genes (+- bp) are read.
  -bp [int] Distance around genes to calculate Fst for up- and downstream areas. Optional.
  -min [int] Minimum number of individuals per population required to consider a site. Default 1.
  -maf [double] Minimum minor allele frequency required to consider a site. Default 0.
+ -threads [int] Number of threads used for inflating BGZF input, parsing and estimating Fst. Output is identical to a single-threaded run. Default 1.
+ -window [int] Size of sliding windows in bp. Fst of each window is printed as soon as the window closes instead of per-site values. Optional.
+ -step [int] Step between window starts in bp. Default same as -window.
+ -jackknife [int] Block size in bp for delete-one block jackknife standard errors of gene Fst, computed in the same pass. Adds a _se column after each region (95% CI = Fst +- 1.96 * se). Optional.
+ -pairwise Estimate Fst for every pair of populations in one pass. Output is a genome-wide matrix, or with -genes one line per gene and pair. Optional.
+ -stats [file] Write a JSON summary of the run to file: time spent loading files, matching individuals, waiting for input, parsing, overlapping genes, estimating and writing output,
+    bytes read and the number of sites parsed, outside genes, filtered and kept. Also prints the current position and sites/sec to stderr every 10 seconds. With -threads the phase times are summed over threads. Optional.
+ -partial Print the summed variance components (hw, hb and n) of every gene region, or with -pairwise and no -genes of every population pair, instead of Fst.
+    For runs split by chromosome, region or sites, e.g. over cluster nodes. Every shard must use the same pop files, genes file, -bp, -min, -maf and -pairwise. Cannot be combined with -window or -jackknife. Optional.
+ -bin [file] Write per-site hw, hb and n (number of individuals) as BGZF compressed binary records instead of text, compressed on -threads threads, and a block index to file.idx.
+    Read with sitebin2txt, which can print single regions (fst = hw / hb). Per-site output only: cannot be combined with -genes, -pairwise or -window. Optional.
+ -cache [file] Cache of the per-site hw, hb and n of every site (and pair with -pairwise) that passes -min and -maf, stored like -bin. If file was written for the same Beagle file (path, size and modification time),
+    pop files, -min, -maf and -pairwise, the sites are read from it instead of the Beagle file, so that a rerun with other -genes, -bp, -window or -jackknife only aggregates them.
+    Otherwise the whole Beagle file is read (without its index) and file is written again. Optional.
+ -merge [file] Partial file written with -partial. Can be used >= 1 times. The sums of the shards are added and printed as the normal gene table or matrix, replacing all other options.
+    The result is identical to a single run when every gene lies within one shard (e.g. shards by chromosome). A gene split between shards may differ in the last bits of its sums.
 
  Example:
- ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -pop list3.txt -genes genes.txt -bp 1000 -min 6 -maf 0.05 > test.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -pop list3.txt -genes genes.txt -bp 1000 -min 6 -maf 0.05 -threads 8 > test.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -pop list3.txt -pairwise > matrix.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -window 10000 -step 2000 > windows.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -genes genes.txt -jackknife 500 > test_se.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -threads 8 -stats run.json > test.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -threads 8 -bin sites.bin
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -genes genes.txt -bp 1000 -cache fst.cache > test.txt
+ ./probs2fst -beagle postprobs.beagle -pop list1.txt -pop list2.txt -genes exons.txt -cache fst.cache > exons.txt
+ ./probs2fst -beagle chr1.beagle -pop list1.txt -pop list2.txt -genes genes.txt -bp 1000 -partial > chr1.part
+ ./probs2fst -merge chr1.part -merge chr2.part -merge chr3.part > test.txt
 */
 
 #include <ctype.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "beagle.h"
+#include "bgzf.h"
+#include "interval.h"
+#include "lines.h"
+#include "jackknife.h"
+#include "partial.h"
+#include "samples.h"
+#include "seek.h"
+#include "simd.h"
+#include "sitebin.h"
+#include "stats.h"
+#include "window.h"
+#include "writer.h"
 #define merror "\nERROR: System out of memory\n\n"
-#define NA 0.333333
+#define CHUNK 4096
 
 typedef struct {
     int n;
@@ -50,16 +90,84 @@ typedef struct {
     int start, end;
     char str, chr[101], id[101];
     Var_s up, cds, down;
+    Var_s *pair; /* -pairwise: up, cds and down of every population pair */
+    Jack_s jack[3]; /* -jackknife: blocks of up, cds and down */
 } Gene_s;
 
+typedef struct {
+    int pos;
+    char *chr;
+    Var_s vars;
+} Hit_s;
+
+/* Where kept sites go: per-site output, genes, -pairwise totals or -window accumulators */
+typedef struct {
+    Gene_s *genes;
+    Index_s *index;
+    Window_s *window;
+    Writer_s *writer; /* per-site and window lines */
+    Sitebin_s *bin;   /* -bin: per-site records instead of lines */
+    Sitebin_s *save;  /* -cache being written, with vals holding the record of a site */
+    double *vals;
+    Var_s *total, *acc;
+    int gene_n, pair_n, block, hit_size, *hits, *slots;
+} Out_s;
+
+typedef struct {
+    int pop_n, *start, *all;  /* the selected columns of population k are start[k] to start[k + 1] - 1 */
+    double *dose, *het, *n;   /* sums of each population at the current site */
+    double *p;
+} Est_s;
+
+typedef struct {
+    int state, line_n, hit_n, site_n, skip_n, pos; /* state: 0 free, 1 read, 2 processed. skip_n: sites outside genes, pos: last site */
+    size_t size, out_size, out_len;
+    long long bytes; /* input read by the end of the chunk */
+    char *lines, *out, *chr;
+    Hit_s *hits;
+    Var_s *pairs; /* -pairwise: pair_n components for each hit */
+} Chunk_s;
+
+typedef struct {
+    Beagle_s *beagle;
+    Chunk_s *chunks;
+    Index_s *index;
+    Stats_s *stats, sum; /* sum: phase times of the reader and workers */
+    int **plist;
+    int chunk_n, eof, pop_n, gene_n, plist_n, pair_n, text, min; /* text: per-site output formatted by the workers */
+    long read_i, work_i;
+    double maf;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Pipe_s;
+
 void openFiles(int argc, char *argv[]);
-char **readPop(FILE *pop_file, int *n);
 Gene_s *readGenes(FILE *gene_file, int *n);
-void readBeagle(FILE *beagle_file, char ***pops, Gene_s *genes, int bp, int pop_n, int gene_n, int ind_n, int min, double maf);
-Var_s estVars(double **dosage, int **plist, int pop_n, int ind_n, int plist_n, int min, double maf);
+void readBeagle(FILE *beagle_file, Seek_s *seek, Stats_s *stats, Samples_s *samples, char **names, Gene_s *genes, int bp, int pop_n, int gene_n, int ind_n, int min, double maf, int threads, int pairwise, int window, int step, int block, int partial, char *bin_path, Sitebin_s *cache);
+void readThreads(Beagle_s *beagle, Out_s *out, Stats_s *stats, int **plist, int pop_n, int plist_n, int min, double maf, int threads, int *site_i, int *kept_i, int *outside_i);
+void *readChunks(void *arg);
+void *estChunks(void *arg);
+Index_s *indexGenes(Gene_s *genes, int gene_n, int bp);
+void addOut(Out_s *out, char *chr, int pos, Var_s *vars);
+Sitebin_s *openCache(char *path, char *beagle_path, Samples_s *samples, char **names, int pop_n, int min, double maf, int pairwise, int threads);
+void saveSite(Out_s *out, char *chr, int pos, Var_s *vars);
+int readCache(Sitebin_s *cache, Var_s *vars, int n);
+void addWindow(Out_s *out, char *chr, int pos, Var_s vars);
+void addSite(Gene_s *genes, int *hits, int hit_n, int pos, Var_s *vars, int pair_n, int block);
+void addVar(Var_s *sum, Var_s vars);
+void printGenes(Gene_s *genes, int gene_n, int bp, int block);
+void printPairs(Gene_s *genes, Var_s *total, char **names, int gene_n, int pop_n, int bp);
+void printPartial(Gene_s *genes, Var_s *total, char **names, int gene_n, int pop_n, int pair_n, int bp, int min, double maf);
+void printVar(Var_s vars);
+void mergeParts(Part_s *part);
+Var_s readVar(double *vals);
+Est_s *estInit(int **plist, int plist_n, int pop_n, int *cols);
+void estFree(Est_s *est);
+void sumPops(Beagle_s *beagle, Est_s *est);
+Var_s estVars(Est_s *est, int *pops, int pop_n, int min, double maf);
+int estPairs(Est_s *est, Var_s *pairs, int min, double maf);
 double estFst(Var_s vars);
 int isNumeric(const char *s);
-void lineTerminator(char *line);
 
 int main(int argc, char *argv[]) {
     int second = 0, minute = 0, hour = 0;
@@ -85,41 +193,47 @@ int main(int argc, char *argv[]) {
 }
 
 void openFiles(int argc, char *argv[]) {
-    int i, j, gene_n = 0, min = 1, pop_n = 0, ind_n = 0, bp = 0;
-    double maf = 0;
-    char ***pops = NULL;
+    int i, j, gene_n = 0, min = 1, pop_n = 0, ind_n = 0, bp = 0, threads = 1, pairwise = 0, window = 0, step = 0, block = 0, partial = 0;
+    double maf = 0, start = 0;
+    char **names = NULL;
     Gene_s *genes = NULL;
-    FILE *beagle_file = NULL, *pop_file = NULL, *gene_file = NULL;
+    Samples_s *samples = NULL;
+    char *beagle_path = NULL, *bin_path = NULL, *cache_path = NULL;
+    Seek_s *seek = NULL;
+    Stats_s *stats = NULL;
+    Part_s *part = NULL;
+    Sitebin_s *cache = NULL;
+    FILE *beagle_file = NULL, *pop_file = NULL, *gene_file = NULL, *part_file = NULL;
 
+    start = statsNow();
     fprintf(stderr, "\nParameters:\n");
 
-    if((pops = malloc(argc * sizeof(char **))) == NULL) {
+    if((names = malloc(argc * sizeof(char *))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
+    samples = samplesInit();
 
     for(i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-beagle") == 0) {
-            if((beagle_file = fopen(argv[++i], "r")) == NULL) {
-                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
-                exit(EXIT_FAILURE);
-            }
+            beagle_path = argv[++i];
             fprintf(stderr, "\t-beagle %s\n", argv[i]);
         }
 
         else if(strcmp(argv[i], "-pop") == 0) {
-            if((pop_file = fopen(argv[++i], "r")) == NULL) {
+            if((pop_file = bgzfOpen(argv[++i], 1)) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
             fprintf(stderr, "\t-pop %s\n", argv[i]);
 
-            pops[pop_n] = readPop(pop_file, &ind_n);
+            names[pop_n] = argv[i];
+            ind_n += samplesRead(samples, pop_file, pop_n, argv[i]);
             pop_n++;
         }
 
         else if(strcmp(argv[i], "-genes") == 0) {
-            if((gene_file = fopen(argv[++i], "r")) == NULL) {
+            if((gene_file = bgzfOpen(argv[++i], 1)) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
@@ -144,6 +258,64 @@ void openFiles(int argc, char *argv[]) {
             fprintf(stderr, "\t-maf %s\n", argv[i]);
         }
 
+        else if(strcmp(argv[i], "-threads") == 0) {
+            if(isNumeric(argv[++i]))
+                threads = atoi(argv[i]);
+            fprintf(stderr, "\t-threads %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-window") == 0) {
+            if(isNumeric(argv[++i]))
+                window = atoi(argv[i]);
+            fprintf(stderr, "\t-window %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-step") == 0) {
+            if(isNumeric(argv[++i]))
+                step = atoi(argv[i]);
+            fprintf(stderr, "\t-step %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-jackknife") == 0) {
+            if(isNumeric(argv[++i]))
+                block = atoi(argv[i]);
+            fprintf(stderr, "\t-jackknife %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-pairwise") == 0) {
+            pairwise = 1;
+            fprintf(stderr, "\t-pairwise\n");
+        }
+
+        else if(strcmp(argv[i], "-stats") == 0) {
+            stats = statsOpen(argv[++i], "probs2fst", start);
+            fprintf(stderr, "\t-stats %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-partial") == 0) {
+            partial = 1;
+            fprintf(stderr, "\t-partial\n");
+        }
+
+        else if(strcmp(argv[i], "-bin") == 0) {
+            bin_path = argv[++i];
+            fprintf(stderr, "\t-bin %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-cache") == 0) {
+            cache_path = argv[++i];
+            fprintf(stderr, "\t-cache %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-merge") == 0) {
+            if((part_file = bgzfOpen(argv[++i], 1)) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-merge %s\n", argv[i]);
+            part = partRead(part, part_file, argv[i]);
+        }
+
         else {
             fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
             exit(EXIT_FAILURE);
@@ -152,366 +324,971 @@ void openFiles(int argc, char *argv[]) {
 
     fprintf(stderr, "\n");
 
-    if(beagle_file == NULL) {
+    if(part != NULL) {
+        mergeParts(part);
+        partFree(part);
+        samplesFree(samples);
+        free(names);
+        statsClose(stats);
+        return;
+    }
+
+    if(beagle_path == NULL) {
         fprintf(stderr, "\nERROR: -beagle [file] is required!\n");
         exit(EXIT_FAILURE);
     }
+    if((beagle_file = bgzfOpen(beagle_path, threads)) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot open file %s\n\n", beagle_path);
+        exit(EXIT_FAILURE);
+    }
 
     if(pop_n < 2) {
         fprintf(stderr, "\nERROR: at least two population files (-pop [file) are required!\n");
         exit(EXIT_FAILURE);
     }
 
-    if(gene_file != NULL)
+    if(window > 0 && (gene_file != NULL || pairwise == 1)) {
+        fprintf(stderr, "\nERROR: -window cannot be combined with -genes or -pairwise!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(step <= 0 || step > window)
+        step = window;
+    if(block > 0 && (gene_file == NULL || pairwise == 1)) {
+        fprintf(stderr, "\nERROR: -jackknife requires -genes and cannot be combined with -pairwise!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(partial == 1 && (window > 0 || block > 0 || (gene_file == NULL && pairwise == 0))) {
+        fprintf(stderr, "\nERROR: -partial requires -genes or -pairwise and cannot be combined with -window or -jackknife!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(bin_path != NULL && (window > 0 || gene_file != NULL || pairwise == 1)) {
+        fprintf(stderr, "\nERROR: -bin is for per-site output and cannot be combined with -genes, -pairwise or -window!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(cache_path != NULL)
+        cache = openCache(cache_path, beagle_path, samples, names, pop_n, min, maf, pairwise, threads);
+
+    if(gene_file != NULL) {
         genes = readGenes(gene_file, &gene_n);
+        if(cache == NULL && (seek = seekOpen(beagle_path)) != NULL) {
+            for(i = 0; i < gene_n; i++)
+                seekAdd(seek, genes[i].chr, genes[i].start - bp, genes[i].end + bp);
+        }
+    }
 
-    readBeagle(beagle_file, pops, genes, bp, pop_n, gene_n, ind_n, min, maf);
+    readBeagle(beagle_file, seek, stats, samples, names, genes, bp, pop_n, gene_n, ind_n, min, maf, threads, pairwise, window, step, block, partial, bin_path, cache);
 }
 
-char **readPop(FILE *pop_file, int *n) {
-    int i = 0, char_i = 0, maxchar = 0, line_i = 0;
-    char c, *line, **list;
+Gene_s *readGenes(FILE *gene_file, int *n) {
+    int size = 0;
+    char *line = NULL, *fields[5];
+    Gene_s *list = NULL;
+    Lines_s *lines = NULL;
 
-    while((c = fgetc(pop_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
-        }
+    lines = linesOpen(gene_file);
+    while((line = linesNext(lines)) != NULL) {
+        if(linesSplit(line, fields, 5) < 5)
+            continue;
+        list = linesGrow(list, *n, &size, sizeof(Gene_s));
+        memset(&list[*n], 0, sizeof(Gene_s));
+        strncpy(list[*n].chr, fields[0], 100);
+        list[*n].start = atoi(fields[1]);
+        list[*n].end = atoi(fields[2]);
+        list[*n].str = fields[3][0];
+        strncpy(list[*n].id, fields[4], 100);
+        *n = *n + 1;
     }
+    linesClose(lines);
+
+    return list;
+}
 
-    rewind(pop_file);
+void readBeagle(FILE *beagle_file, Seek_s *seek, Stats_s *stats, Samples_s *samples, char **names, Gene_s *genes, int bp, int pop_n, int gene_n, int ind_n, int min, double maf, int threads, int pairwise, int window, int step, int block, int partial, char *bin_path, Sitebin_s *cache) {
+    int i, e, k = 0, l = 0, p_i = 0, hit_size = 0, kept_i = 0, site_i = 0, outside_i = 0, **plist = NULL, *cols = NULL, *hits = NULL;
+    char *bin_names[3] = {"hw", "hb", "n"};
+    Var_s vars = {0}, *pairs = NULL;
+    Est_s *est = NULL;
+    Out_s out = {0};
+    Beagle_s *beagle = NULL;
 
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+    if((plist = malloc(ind_n * sizeof(int *))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    if((list = malloc((line_i + 1) * sizeof(char *))) == NULL) {
+    for(i = 0; i < ind_n; i++) {
+        if((plist[i] = malloc(2 * sizeof(int))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    statsPhase(stats, STATS_MATCH);
+    beagle = beagleOpen(beagle_file);
+    beagle->timed = stats != NULL;
+    if(seek != NULL)
+        beagleSeek(beagle, seek);
+    if(beagle->names != NULL) {
+        for(i = 0; i < beagle->ind_n; i++) {
+            for(e = samplesColumn(samples, beagle->names[i], i), l = 0; e >= 0; e = samples->next[e], l++) {
+                plist[p_i][0] = i;
+                plist[p_i][1] = samples->group[e];
+                p_i++;
+            }
+            if(l > 1)
+                fprintf(stderr, "Warning: %s is listed in more than one population\n", beagle->names[i]);
+        }
+    }
+    if(p_i == 0) {
+        fprintf(stderr, "ERROR: Individuals in pop files were not found in the Beagle file!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    samplesMissing(samples, "Beagle");
+    fprintf(stderr, "Kept %i individuals from %i populations\n", p_i, pop_n);
+    if((cols = malloc(p_i * sizeof(int))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    for(i = 0; i < line_i + 1; i++) {
-        if((list[i] = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+    est = estInit(plist, p_i, pop_n, cols);
+    beagleSelect(beagle, cols, p_i);
+    free(cols);
+    out.genes = genes;
+    out.gene_n = gene_n;
+    out.block = block;
+    if(cache != NULL && cache->write == 1) {
+        out.save = cache;
+        if((out.vals = malloc(cache->val_n * sizeof(double))) == NULL) {
             fprintf(stderr, merror);
             exit(EXIT_FAILURE);
         }
+        cache = NULL;
     }
-    i = 0;
-    while(fgets(line, maxchar + 1, pop_file) != NULL) {
-        if(line[0] == '\n')
-            continue;
-        lineTerminator(line);
-        strcpy(list[i], line);
-        i++;
-        *n = *n + 1;
+    if(pairwise == 1) {
+        out.pair_n = pop_n * (pop_n - 1) / 2;
+        if((pairs = malloc(out.pair_n * sizeof(Var_s))) == NULL || (out.total = calloc(out.pair_n, sizeof(Var_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        for(i = 0; i < gene_n; i++) {
+            if((genes[i].pair = calloc(3 * out.pair_n, sizeof(Var_s))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+    } else if(bin_path != NULL)
+        out.bin = sitebinCreate(bin_path, bin_names, 3, NULL, threads);
+    else if(gene_n == 0) {
+        if(isatty(1))
+            fprintf(stderr, "\n");
+        if(window > 0)
+            printf("chr\tstart\tend\tfst\tn\n");
+        else
+            printf("chr\tbp\tfst\n");
     }
-    list[i][0] = '\0';
+    if(window > 0) {
+        out.window = windowInit(window, step);
+        if((out.acc = calloc(out.window->slot_n, sizeof(Var_s))) == NULL || (out.slots = malloc(out.window->slot_n * sizeof(int))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if(gene_n > 0)
+        out.index = indexGenes(genes, gene_n, bp);
+    out.writer = writerOpen(stdout);
 
-    free(line);
-    fclose(pop_file);
+    if(beagle->map != NULL || cache != NULL)
+        threads = 1; /* the binary store or the cache is already parsed */
+    if(threads > 1)
+        readThreads(beagle, &out, stats, plist, pop_n, p_i, min, maf, threads, &site_i, &kept_i, &outside_i);
 
-    return list;
-}
+    while(threads <= 1) {
+        statsPhase(stats, STATS_PARSE);
+        if(cache != NULL) {
+            if(readCache(cache, out.pair_n > 0 ? pairs : &vars, out.pair_n > 0 ? out.pair_n : 1) == 0)
+                break;
+            site_i++;
+            kept_i++;
+            statsPhase(stats, STATS_OUTPUT);
+            addOut(&out, cache->chr, cache->pos, out.pair_n > 0 ? pairs : &vars);
+            continue;
+        }
+        if(beagleNext(beagle) == 0)
+            break;
+        site_i++;
+        statsProgress(stats, beagle->chr, beagle->pos, site_i, beagle->bytes);
+        if(gene_n > 0 && out.save == NULL) {
+            statsPhase(stats, STATS_OVERLAP);
+            if(indexFind(out.index, indexGetChr(out.index, beagle->chr), beagle->pos, beagle->pos, &hits, &hit_size) == 0) {
+                outside_i++;
+                continue;
+            }
+            statsPhase(stats, STATS_PARSE);
+        }
+        if(beagle->quant == 0)
+            beagleProbs(beagle);
+        statsPhase(stats, STATS_COMPUTE);
+        sumPops(beagle, est);
+        if(out.pair_n > 0) {
+            if(estPairs(est, pairs, min, maf) == 0)
+                continue;
+        } else {
+            vars = estVars(est, est->all, pop_n, min, maf);
+            if(isnan(vars.hw) == 1)
+                continue;
+        }
+        kept_i++;
+        statsPhase(stats, STATS_OUTPUT);
+        addOut(&out, beagle->chr, beagle->pos, out.pair_n > 0 ? pairs : &vars);
+    }
+    statsPhase(stats, STATS_OUTPUT);
+    if(window > 0)
+        addWindow(&out, NULL, 0, vars);
+    writerClose(out.writer);
+    sitebinClose(out.bin);
+    sitebinClose(out.save);
+    sitebinClose(cache);
 
-Gene_s *readGenes(FILE *gene_file, int *n) {
-    int i, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line = NULL;
-    Gene_s *list = NULL;
+    if(out.pair_n > 0 || gene_n > 0) {
+        if(isatty(1))
+            fprintf(stderr, "\n");
+        if(partial == 1)
+            printPartial(genes, out.total, names, gene_n, pop_n, out.pair_n, bp, min, maf);
+        else if(out.pair_n > 0)
+            printPairs(genes, out.total, names, gene_n, pop_n, bp);
+        else
+            printGenes(genes, gene_n, bp, block);
+    }
+
+    if(isatty(1))
+        fprintf(stderr, "\n");
+    fprintf(stderr, "Kept %i out of %i sites\n", kept_i, site_i);
+    if(stats != NULL) {
+        stats->time[STATS_PARSE] -= beagle->wait;
+        stats->time[STATS_READ] += beagle->wait;
+        stats->threads = threads;
+        stats->bytes = beagle->bytes;
+        stats->parsed = site_i;
+        stats->outside = outside_i;
+        stats->kept = kept_i;
+    }
 
-    while((c = fgetc(gene_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
+    estFree(est);
+    for(i = 0; i < ind_n; i++)
+        free(plist[i]);
+    free(plist);
+    samplesFree(samples);
+    free(names);
+    free(pairs);
+    free(out.total);
+    free(out.vals);
+    free(out.hits);
+    free(hits);
+    if(window > 0) {
+        free(out.acc);
+        free(out.slots);
+        windowFree(out.window);
+    }
+    if(gene_n > 0) {
+        for(i = 0; i < gene_n; i++) {
+            free(genes[i].pair);
+            for(k = 0; k < 3; k++)
+                jackFree(&genes[i].jack[k]);
         }
+        free(genes);
+        indexFree(out.index);
     }
+    beagleClose(beagle);
+    statsClose(stats);
+}
 
-    rewind(gene_file);
+/* Reader, workers and writer of the -threads mode. The reader splits the input into chunks of lines, workers parse them and estimate the variance components,
+   and the calling thread writes the per-site output and adds sites to genes and windows in input order, so the results are identical to a serial run. */
+void readThreads(Beagle_s *beagle, Out_s *out, Stats_s *stats, int **plist, int pop_n, int plist_n, int min, double maf, int threads, int *site_i, int *kept_i, int *outside_i) {
+    int i;
+    long out_i = 0;
+    pthread_t reader, *workers = NULL;
+    Chunk_s *chunk = NULL;
+    Pipe_s pipe = {0};
 
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
-        fprintf(stderr, merror);
-        exit(EXIT_FAILURE);
-    }
-    if((list = malloc(line_i * sizeof(Gene_s))) == NULL) {
+    pipe.beagle = beagle;
+    pipe.plist = plist;
+    pipe.index = out->index;
+    pipe.stats = stats;
+    pipe.pop_n = pop_n;
+    pipe.gene_n = out->save == NULL ? out->gene_n : 0; /* a cache keeps the sites outside genes */
+    pipe.plist_n = plist_n;
+    pipe.pair_n = out->pair_n;
+    pipe.text = out->gene_n == 0 && out->pair_n == 0 && out->window == NULL && out->bin == NULL && out->save == NULL;
+    pipe.min = min;
+    pipe.maf = maf;
+    pipe.chunk_n = 4 * threads;
+    if((pipe.chunks = calloc(pipe.chunk_n, sizeof(Chunk_s))) == NULL || (workers = malloc(threads * sizeof(pthread_t))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    memset(list, 0, sizeof(Gene_s) * line_i);
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
+    pthread_create(&reader, NULL, readChunks, &pipe);
+    for(i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, estChunks, &pipe);
 
-    while(fgets(line, maxchar + 1, gene_file) != NULL) {
-        if(line[0] == '\n')
+    statsPhase(stats, STATS_WAIT);
+    pthread_mutex_lock(&pipe.lock);
+    while(1) {
+        chunk = &pipe.chunks[out_i % pipe.chunk_n];
+        if(chunk->state != 2) {
+            if(pipe.eof && out_i == pipe.read_i)
+                break;
+            pthread_cond_wait(&pipe.cond, &pipe.lock);
             continue;
-        lineTerminator(line);
-        strncpy(list[*n].chr, strtok(line, "\t"), 100);
-        list[*n].start = atoi(strtok(NULL, "\t"));
-        list[*n].end = atoi(strtok(NULL, "\t"));
-        list[*n].str = strtok(NULL, "\t")[0];
-        strncpy(list[*n].id, strtok(NULL, "\t"), 100);
-        *n = *n + 1;
+        }
+        pthread_mutex_unlock(&pipe.lock);
+        statsPhase(stats, STATS_OUTPUT);
+        *site_i += chunk->site_n;
+        *kept_i += chunk->hit_n;
+        *outside_i += chunk->skip_n;
+        if(chunk->site_n > 0)
+            statsProgress(stats, chunk->chr, chunk->pos, *site_i, chunk->bytes);
+        if(pipe.text == 1)
+            fwrite(chunk->out, 1, chunk->out_len, stdout);
+        else {
+            for(i = 0; i < chunk->hit_n; i++)
+                addOut(out, chunk->hits[i].chr, chunk->hits[i].pos, out->pair_n > 0 ? chunk->pairs + i * out->pair_n : &chunk->hits[i].vars);
+        }
+        statsPhase(stats, STATS_WAIT);
+        pthread_mutex_lock(&pipe.lock);
+        chunk->state = 0;
+        out_i++;
+        pthread_cond_broadcast(&pipe.cond);
     }
+    pthread_mutex_unlock(&pipe.lock);
 
-    free(line);
-    fclose(gene_file);
+    pthread_join(reader, NULL);
+    for(i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+    statsMerge(stats, &pipe.sum);
+    for(i = 0; i < pipe.chunk_n; i++) {
+        free(pipe.chunks[i].lines);
+        free(pipe.chunks[i].out);
+        free(pipe.chunks[i].hits);
+        free(pipe.chunks[i].pairs);
+    }
+    free(pipe.chunks);
+    free(workers);
+    pthread_mutex_destroy(&pipe.lock);
+    pthread_cond_destroy(&pipe.cond);
+}
 
-    return list;
+void *readChunks(void *arg) {
+    int n;
+    Pipe_s *pipe = arg;
+    Chunk_s *chunk = NULL;
+    Stats_s local, *part = NULL;
+
+    if(pipe->stats != NULL) {
+        part = &local;
+        statsInit(part);
+    }
+
+    statsPhase(part, STATS_WAIT);
+    pthread_mutex_lock(&pipe->lock);
+    while(1) {
+        chunk = &pipe->chunks[pipe->read_i % pipe->chunk_n];
+        if(chunk->state != 0) {
+            pthread_cond_wait(&pipe->cond, &pipe->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&pipe->lock);
+        statsPhase(part, STATS_PARSE);
+        n = beagleChunk(pipe->beagle, &chunk->lines, &chunk->size, CHUNK);
+        chunk->bytes = pipe->beagle->bytes;
+        statsPhase(part, STATS_WAIT);
+        pthread_mutex_lock(&pipe->lock);
+        if(n == 0) {
+            pipe->eof = 1;
+            pthread_cond_broadcast(&pipe->cond);
+            break;
+        }
+        chunk->line_n = n;
+        chunk->state = 1;
+        pipe->read_i++;
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    statsPhase(part, STATS_WAIT);
+    statsMerge(&pipe->sum, part);
+    pthread_mutex_unlock(&pipe->lock);
+
+    return NULL;
 }
 
-void readBeagle(FILE *beagle_file, char ***pops, Gene_s *genes, int bp, int pop_n, int gene_n, int ind_n, int min, double maf) {
-    int i, j = 0, k = 0, l = 0, m = 0, n = 0, pos = 0, ok = 0, p_i = 0, gene_i = 0, kept_i = 0, site_i = 0, **plist = NULL;
-    double prob[3] = {0}, **dosage;
-    char chr[101], *line = NULL, *temp = NULL, *end = NULL;
-    Var_s vars = {0};
+/* Each worker takes the next unprocessed chunk */
+void *estChunks(void *arg) {
+    int i, hit_size = 0, *hits = NULL;
     size_t len = 0;
-    ssize_t read;
+    char *line = NULL, *next = NULL;
+    Var_s vars = {0};
+    Pipe_s *pipe = arg;
+    Chunk_s *chunk = NULL;
+    Est_s *est = NULL;
+    Beagle_s *parser = NULL;
+    Stats_s local, *part = NULL;
 
-    if((plist = malloc(ind_n * sizeof(int *))) == NULL) {
-        fprintf(stderr, merror);
-        exit(EXIT_FAILURE);
+    parser = beagleCopy(pipe->beagle);
+    est = estInit(pipe->plist, pipe->plist_n, pipe->pop_n, NULL);
+    if(pipe->stats != NULL) {
+        part = &local;
+        statsInit(part);
     }
-    for(i = 0; i < ind_n; i++) {
-        if((plist[i] = malloc(2 * sizeof(int))) == NULL) {
+
+    statsPhase(part, STATS_WAIT);
+    pthread_mutex_lock(&pipe->lock);
+    while(1) {
+        if(pipe->work_i == pipe->read_i) {
+            if(pipe->eof)
+                break;
+            pthread_cond_wait(&pipe->cond, &pipe->lock);
+            continue;
+        }
+        chunk = &pipe->chunks[pipe->work_i % pipe->chunk_n];
+        pipe->work_i++;
+        pthread_mutex_unlock(&pipe->lock);
+
+        chunk->site_n = 0;
+        chunk->hit_n = 0;
+        chunk->skip_n = 0;
+        chunk->out_len = 0;
+        if(pipe->text == 0 && (chunk->hits = realloc(chunk->hits, chunk->line_n * sizeof(Hit_s))) == NULL) {
             fprintf(stderr, merror);
             exit(EXIT_FAILURE);
         }
-    }
-
-    while((read = getline(&line, &len, beagle_file)) != -1) {
-        if(line[0] == '\n')
-            continue;
-        temp = strtok_r(line, "\t", &end);
-        i = 1;
-        j = 0;
-        k = 0;
-        if(strcmp(temp, "marker") == 0) {
-            lineTerminator(line);
-            while(temp != NULL) {
-                if(i > 3) {
-                    if(j == 0) {
-                        for(k = 0; k < pop_n; k++) {
-                            for(l = 0; pops[k][l][0] != '\0'; l++) {
-                                if(strcmp(temp, pops[k][l]) == 0) {
-                                    plist[p_i][0] = n;
-                                    plist[p_i][1] = k;
-                                    p_i++;
-                                }
-                            }
-                        }
-                        n++;
-                    }
-                    j++;
-                    if(j == 3)
-                        j = 0;
+        if(pipe->pair_n > 0 && (chunk->pairs = realloc(chunk->pairs, chunk->line_n * pipe->pair_n * sizeof(Var_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        for(i = 0, line = chunk->lines; i < chunk->line_n; i++, line = next) {
+            next = line + strlen(line) + 1;
+            statsPhase(part, STATS_PARSE);
+            if(beagleLine(parser, line) == 0)
+                continue;
+            chunk->site_n++;
+            chunk->chr = parser->chr;
+            chunk->pos = parser->pos;
+            if(pipe->gene_n > 0) {
+                statsPhase(part, STATS_OVERLAP);
+                if(indexFind(pipe->index, indexGetChr(pipe->index, parser->chr), parser->pos, parser->pos, &hits, &hit_size) == 0) {
+                    chunk->skip_n++;
+                    continue;
                 }
-                temp = strtok_r(NULL, "\t", &end);
-                i++;
+                statsPhase(part, STATS_PARSE);
             }
-            if(p_i == 0) {
-                fprintf(stderr, "ERROR: Individuals in pop files were not found in the Beagle file!\n\n");
-                exit(EXIT_FAILURE);
+            beagleProbs(parser);
+            statsPhase(part, STATS_COMPUTE);
+            sumPops(parser, est);
+            if(pipe->pair_n > 0) {
+                if(estPairs(est, chunk->pairs + chunk->hit_n * pipe->pair_n, pipe->min, pipe->maf) == 0)
+                    continue;
+            } else {
+                vars = estVars(est, est->all, pipe->pop_n, pipe->min, pipe->maf);
+                if(isnan(vars.hw) == 1)
+                    continue;
             }
-            if(p_i < ind_n)
-                fprintf(stderr, "Warning: Pop files contain individuals that are not in the Beagle file\n");
-            fprintf(stderr, "Kept %i individuals from %i populations\n", p_i, pop_n);
-            if((dosage = malloc(n * sizeof(double *))) == NULL) {
-                fprintf(stderr, merror);
-                exit(EXIT_FAILURE);
+            statsPhase(part, STATS_OUTPUT);
+            if(pipe->text == 0) {
+                chunk->hits[chunk->hit_n].chr = parser->chr;
+                chunk->hits[chunk->hit_n].pos = parser->pos;
+                chunk->hits[chunk->hit_n].vars = vars;
+            } else {
+                len = strlen(parser->chr);
+                if(chunk->out_len + len + WRITER_INT + WRITER_FLOAT + 3 > chunk->out_size) {
+                    chunk->out_size = 2 * (chunk->out_len + len + WRITER_INT + WRITER_FLOAT + 3);
+                    if((chunk->out = realloc(chunk->out, chunk->out_size)) == NULL) {
+                        fprintf(stderr, merror);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                memcpy(chunk->out + chunk->out_len, parser->chr, len);
+                chunk->out_len += len;
+                chunk->out[chunk->out_len++] = '\t';
+                chunk->out_len += formatInt(chunk->out + chunk->out_len, parser->pos);
+                chunk->out[chunk->out_len++] = '\t';
+                chunk->out_len += formatFloat(chunk->out + chunk->out_len, estFst(vars), 6);
+                chunk->out[chunk->out_len++] = '\n';
             }
-            for(j = 0; j < n; j++) {
-                if((dosage[j] = malloc(2 * sizeof(double))) == NULL) {
+            chunk->hit_n++;
+        }
+
+        statsPhase(part, STATS_WAIT);
+        pthread_mutex_lock(&pipe->lock);
+        chunk->state = 2;
+        pthread_cond_broadcast(&pipe->cond);
+    }
+    statsPhase(part, STATS_WAIT);
+    statsMerge(&pipe->sum, part);
+    pthread_mutex_unlock(&pipe->lock);
+
+    free(hits);
+    estFree(est);
+    beagleClose(parser);
+
+    return NULL;
+}
+
+/* Indexes the genes together with their flanks (+- bp) */
+Index_s *indexGenes(Gene_s *genes, int gene_n, int bp) {
+    int i;
+    Index_s *index = NULL;
+
+    index = indexInit();
+    for(i = 0; i < gene_n; i++)
+        indexAdd(index, indexChr(index, genes[i].chr), genes[i].start - bp, genes[i].end + bp, i);
+    indexBuild(index);
+
+    return index;
+}
+
+/* Adds a kept site to the output. With -pairwise vars holds one entry for each population pair. */
+void addOut(Out_s *out, char *chr, int pos, Var_s *vars) {
+    int i, hit_n = 0;
+    double vals[3];
+
+    if(out->save != NULL)
+        saveSite(out, chr, pos, vars);
+    if(out->window != NULL)
+        addWindow(out, chr, pos, vars[0]);
+    else if(out->gene_n > 0) {
+        hit_n = indexFind(out->index, indexGetChr(out->index, chr), pos, pos, &out->hits, &out->hit_size);
+        addSite(out->genes, out->hits, hit_n, pos, vars, out->pair_n, out->block);
+    } else if(out->pair_n > 0) {
+        for(i = 0; i < out->pair_n; i++)
+            addVar(&out->total[i], vars[i]);
+    } else if(out->bin != NULL) {
+        vals[0] = vars[0].hw;
+        vals[1] = vars[0].hb;
+        vals[2] = vars[0].n;
+        sitebinAdd(out->bin, chr, pos, vals);
+    } else {
+        writerStr(out->writer, chr);
+        writerChar(out->writer, '\t');
+        writerInt(out->writer, pos);
+        writerChar(out->writer, '\t');
+        writerFloat(out->writer, estFst(vars[0]), 6);
+        writerChar(out->writer, '\n');
+    }
+}
+
+/* -cache: opens the cache for reading if it matches the input and settings, otherwise creates it with hw, hb and n of every site (or pop1:pop2_hw, ... of every pair) */
+Sitebin_s *openCache(char *path, char *beagle_path, Samples_s *samples, char **names, int pop_n, int min, double maf, int pairwise, int threads) {
+    int i, j, k, n = 0, val_n = pairwise == 1 ? 3 * pop_n * (pop_n - 1) / 2 : 3;
+    char settings[256], *key = NULL, **vnames = NULL, *types[3] = {"hw", "hb", "n"};
+    Sitebin_s *cache = NULL;
+
+    sprintf(settings, "pops\t%i\t%016llx\tmin\t%i\tmaf\t%.17g\tpairwise\t%i", pop_n, samplesHash(samples), min, maf, pairwise);
+    key = sitebinKey("probs2fst", beagle_path, settings);
+    if((cache = sitebinCache(path, key, threads)) != NULL) {
+        free(key);
+        return cache;
+    }
+    if((vnames = malloc(val_n * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < pop_n; i++) {
+        for(j = i + 1; j < pop_n && pairwise == 1; j++) {
+            for(k = 0; k < 3; k++, n++) {
+                if((vnames[n] = malloc(strlen(names[i]) + strlen(names[j]) + 5)) == NULL) {
                     fprintf(stderr, merror);
                     exit(EXIT_FAILURE);
                 }
+                sprintf(vnames[n], "%s:%s_%s", names[i], names[j], types[k]);
             }
-            if(gene_n == 0) {
-                if(isatty(1))
-                    fprintf(stderr, "\n");
-                printf("chr\tbp\tfst\n");
+        }
+    }
+    for(k = 0; k < 3 && pairwise == 0; k++) {
+        if((vnames[k] = strdup(types[k])) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    fprintf(stderr, "Writing per-site values to cache %s\n", path);
+    cache = sitebinCreate(path, vnames, val_n, key, threads);
+    for(i = 0; i < val_n; i++)
+        free(vnames[i]);
+    free(vnames);
+    free(key);
+
+    return cache;
+}
+
+/* Adds hw, hb and n of the site (or of every pair) to the cache */
+void saveSite(Out_s *out, char *chr, int pos, Var_s *vars) {
+    int i, n = out->save->val_n / 3;
+
+    for(i = 0; i < n; i++) {
+        out->vals[3 * i] = vars[i].hw;
+        out->vals[3 * i + 1] = vars[i].hb;
+        out->vals[3 * i + 2] = vars[i].n;
+    }
+    sitebinAdd(out->save, chr, pos, out->vals);
+}
+
+/* Reads the next site of the cache into the n entries of vars. Returns 0 at the end of the cache. */
+int readCache(Sitebin_s *cache, Var_s *vars, int n) {
+    int i;
+
+    if(sitebinNext(cache) == 0)
+        return 0;
+    for(i = 0; i < n; i++) {
+        vars[i].hw = cache->vals[3 * i];
+        vars[i].hb = cache->vals[3 * i + 1];
+        vars[i].n = (int)cache->vals[3 * i + 2];
+    }
+
+    return 1;
+}
+
+/* Prints the windows that closed before the site and adds the site to the open ones. chr NULL prints the remaining windows. */
+void addWindow(Out_s *out, char *chr, int pos, Var_s vars) {
+    int i, n, slot;
+    Window_s *w = out->window;
+
+    while((slot = windowClose(w, chr, pos)) >= 0) {
+        writerStr(out->writer, w->chr);
+        writerChar(out->writer, '\t');
+        writerInt(out->writer, w->start);
+        writerChar(out->writer, '\t');
+        writerInt(out->writer, w->end);
+        writerChar(out->writer, '\t');
+        writerFloat(out->writer, estFst(out->acc[slot]), 6);
+        writerChar(out->writer, '\t');
+        writerInt(out->writer, out->acc[slot].n);
+        writerChar(out->writer, '\n');
+        memset(&out->acc[slot], 0, sizeof(Var_s));
+    }
+    if(chr == NULL)
+        return;
+    n = windowOpen(w, chr, pos, out->slots);
+    for(i = 0; i < n; i++)
+        addVar(&out->acc[out->slots[i]], vars);
+}
+
+/* Adds the variance components of a site to the up, cds or down region of every gene it falls in. With -pairwise vars holds one entry for each population pair. */
+void addSite(Gene_s *genes, int *hits, int hit_n, int pos, Var_s *vars, int pair_n, int block) {
+    int i, j, r;
+    Var_s *region[3];
+
+    for(i = 0; i < hit_n; i++) {
+        if(pos < genes[hits[i]].start && genes[hits[i]].str == '+')
+            r = 0;
+        else if(pos < genes[hits[i]].start && genes[hits[i]].str == '-')
+            r = 2;
+        else if(pos > genes[hits[i]].end && genes[hits[i]].str == '+')
+            r = 2;
+        else if(pos > genes[hits[i]].end && genes[hits[i]].str == '-')
+            r = 0;
+        else
+            r = 1;
+        if(pair_n == 0) {
+            region[0] = &genes[hits[i]].up;
+            region[1] = &genes[hits[i]].cds;
+            region[2] = &genes[hits[i]].down;
+            addVar(region[r], vars[0]);
+            if(block > 0)
+                jackAdd(&genes[hits[i]].jack[r], pos / block, vars[0].hw, vars[0].hb);
+        } else {
+            for(j = 0; j < pair_n; j++)
+                addVar(&genes[hits[i]].pair[r * pair_n + j], vars[j]);
+        }
+    }
+}
+
+void addVar(Var_s *sum, Var_s vars) {
+    if(isnan(vars.hw))
+        return;
+    sum->hw += vars.hw;
+    sum->hb += vars.hb;
+    sum->n++;
+}
+
+void printGenes(Gene_s *genes, int gene_n, int bp, int block) {
+    int i;
+
+    if(block > 0 && bp == 0) {
+        printf("id\tcoding_fst\tcoding_n\tcoding_se\n");
+        for(i = 0; i < gene_n; i++)
+            printf("%s\t%f\t%i\t%f\n", genes[i].id, estFst(genes[i].cds), genes[i].cds.n, jackSE(&genes[i].jack[1]));
+    } else if(block > 0) {
+        printf("id\tup_fst\tup_n\tup_se\tcoding_fst\tcoding_n\tcoding_se\tdown_fst\tdown_n\tdown_se\n");
+        for(i = 0; i < gene_n; i++)
+            printf("%s\t%f\t%i\t%f\t%f\t%i\t%f\t%f\t%i\t%f\n", genes[i].id, estFst(genes[i].up), genes[i].up.n, jackSE(&genes[i].jack[0]), estFst(genes[i].cds), genes[i].cds.n, jackSE(&genes[i].jack[1]), estFst(genes[i].down), genes[i].down.n, jackSE(&genes[i].jack[2]));
+    } else if(bp == 0) {
+        printf("id\tcoding_fst\tcoding_n\n");
+        for(i = 0; i < gene_n; i++)
+            printf("%s\t%f\t%i\n", genes[i].id, estFst(genes[i].cds), genes[i].cds.n);
+    } else {
+        printf("id\tup_fst\tup_n\tcoding_fst\tcoding_n\tdown_fst\tdown_n\n");
+        for(i = 0; i < gene_n; i++)
+            printf("%s\t%f\t%i\t%f\t%i\t%f\t%i\n", genes[i].id, estFst(genes[i].up), genes[i].up.n, estFst(genes[i].cds), genes[i].cds.n, estFst(genes[i].down), genes[i].down.n);
+    }
+}
+
+/* Prints the genome-wide Fst matrix, or with genes one line for each gene and population pair */
+void printPairs(Gene_s *genes, Var_s *total, char **names, int gene_n, int pop_n, int bp) {
+    int i, j, k, pair_n = pop_n * (pop_n - 1) / 2;
+    Var_s *pair = NULL;
+
+    if(gene_n == 0) {
+        printf("pop");
+        for(i = 0; i < pop_n; i++)
+            printf("\t%s", names[i]);
+        printf("\n");
+        for(i = 0; i < pop_n; i++) {
+            printf("%s", names[i]);
+            for(j = 0; j < pop_n; j++) {
+                if(i == j)
+                    printf("\t%f", 0.0);
+                else {
+                    /* index of pair (a, b), a < b, in the order of estPairs() */
+                    k = i < j ? i * pop_n - i * (i + 1) / 2 + j - i - 1 : j * pop_n - j * (j + 1) / 2 + i - j - 1;
+                    printf("\t%f", estFst(total[k]));
+                }
             }
-            continue;
+            printf("\n");
         }
-        site_i++;
-        strncpy(chr, strtok(temp, "_"), 100);
-        pos = atoi(strtok(NULL, "_"));
-        if(gene_n > 0) {
-            ok = 0;
-            while(gene_i < gene_n) {
-                if(strcmp(chr, genes[gene_i].chr) == 0) {
-                    if(pos <= genes[gene_i].end + bp && pos >= genes[gene_i].start - bp) {
-                        ok = 1;
-                        break;
-                    } else if(pos < genes[gene_i].start - bp)
-                        break;
-                } else if(strcmp(chr, genes[gene_i].chr) < 0)
-                    break;
-                gene_i++;
+        return;
+    }
+
+    if(bp == 0)
+        printf("id\tpop1\tpop2\tcoding_fst\tcoding_n\n");
+    else
+        printf("id\tpop1\tpop2\tup_fst\tup_n\tcoding_fst\tcoding_n\tdown_fst\tdown_n\n");
+    for(i = 0; i < gene_n; i++) {
+        for(j = 0, k = 0; j < pop_n; j++) {
+            for(; k < (j + 1) * pop_n - (j + 1) * (j + 2) / 2; k++) {
+                pair = genes[i].pair + k;
+                printf("%s\t%s\t%s", genes[i].id, names[j], names[j + 1 + k - (j * pop_n - j * (j + 1) / 2)]);
+                if(bp == 0)
+                    printf("\t%f\t%i\n", estFst(pair[pair_n]), pair[pair_n].n);
+                else
+                    printf("\t%f\t%i\t%f\t%i\t%f\t%i\n", estFst(pair[0]), pair[0].n, estFst(pair[pair_n]), pair[pair_n].n, estFst(pair[2 * pair_n]), pair[2 * pair_n].n);
             }
-            if(ok == 0)
-                continue;
         }
-        while(temp != NULL) {
-            if(i > 3) {
-                prob[j] = atof(temp);
-                j++;
-                if(j == 3) {
-                    if(prob[0] != NA | prob[1] != NA | prob[2] != NA) {
-                        dosage[k][0] = prob[1] + 2 * prob[2];
-                        dosage[k][1] = prob[1];
-                    } else
-                        dosage[k][0] = 9;
-                    j = 0;
-                    k++;
-                }
+    }
+}
+
+/* -partial: the settings that shards must share, then the sums of each gene (and pair) or of each pair, in the order printed by printGenes() and printPairs() */
+void printPartial(Gene_s *genes, Var_s *total, char **names, int gene_n, int pop_n, int pair_n, int bp, int min, double maf) {
+    int i, j, k, l;
+
+    printf("#partial\tprobs2fst\tkeys\t%i\tbp\t%i\tmin\t%i\tmaf\t%.17g\tpairwise\t%i\tgenes\t%i\tpops\t%i", gene_n == 0 ? 2 : pair_n > 0 ? 3 : 1, bp, min, maf, pair_n > 0, gene_n, pop_n);
+    for(i = 0; i < pop_n; i++)
+        printf("\t%s", names[i]);
+    printf("\n");
+    if(gene_n == 0) {
+        printf("pop1\tpop2\thw\thb\tn\n");
+        for(i = 0, k = 0; i < pop_n; i++) {
+            for(j = i + 1; j < pop_n; j++, k++) {
+                printf("%s\t%s", names[i], names[j]);
+                printVar(total[k]);
+                printf("\n");
             }
-            temp = strtok_r(NULL, "\t", &end);
-            i++;
         }
-        if(temp == NULL) {
-            vars = estVars(dosage, plist, pop_n, n, p_i, min, maf);
-            if(isnan(vars.hw) == 1)
-                continue;
-            kept_i++;
-            if(gene_n == 0)
-                printf("%s\t%i\t%f\n", chr, pos, estFst(vars));
-            else {
-                for(i = m; i < gene_n; i++) {
-                    if(strcmp(chr, genes[i].chr) == 0) {
-                        if(pos <= genes[i].end + bp && pos >= genes[i].start - bp) {
-                            if(pos < genes[i].start && genes[i].str == '+') {
-                                genes[i].up.hw += vars.hw;
-                                genes[i].up.hb += vars.hb;
-                                genes[i].up.n++;
-                            } else if(pos < genes[i].start && genes[i].str == '-') {
-                                genes[i].down.hw += vars.hw;
-                                genes[i].down.hb += vars.hb;
-                                genes[i].down.n++;
-                            } else if(pos > genes[i].end && genes[i].str == '+') {
-                                genes[i].down.hw += vars.hw;
-                                genes[i].down.hb += vars.hb;
-                                genes[i].down.n++;
-                            } else if(pos > genes[i].end && genes[i].str == '-') {
-                                genes[i].up.hw += vars.hw;
-                                genes[i].up.hb += vars.hb;
-                                genes[i].up.n++;
-                            } else {
-                                genes[i].cds.hw += vars.hw;
-                                genes[i].cds.hb += vars.hb;
-                                genes[i].cds.n++;
-                            }
-                        } else if(pos < genes[i].start - bp) {
-                            m = i;
-                            for(j = 1; j <= i; j++) {
-                                if(pos <= genes[i - j].end + bp && pos >= genes[i - j].start - bp)
-                                    m = i - j;
-                                else if(pos > genes[i - j].end + bp) {
-                                    if(i - j - 1 >= 0) {
-                                        if(pos > genes[i - j - 1].end + bp)
-                                            break;
-                                    } else
-                                        break;
-                                }
-                            }
-                            break;
-                        }
-                    } else if(strcmp(chr, genes[i].chr) < 0) {
-                        m = i;
-                        for(j = 1; j <= i; j++) {
-                            if(strcmp(chr, genes[i - j].chr) == 0) {
-                                if(pos <= genes[i - j].end + bp && pos >= genes[i - j].start - bp)
-                                    m = i - j;
-                                else if(pos > genes[i - j].end + bp) {
-                                    if(i - j - 1 >= 0) {
-                                        if(pos > genes[i - j - 1].end + bp)
-                                            break;
-                                    } else
-                                        break;
-                                }
-                            } else if(strcmp(chr, genes[i - j].chr) > 0)
-                                break;
-                        }
-                        break;
-                    }
-                }
+        return;
+    }
+    printf(pair_n > 0 ? "id\tpop1\tpop2" : "id");
+    printf("\tup_hw\tup_hb\tup_n\tcoding_hw\tcoding_hb\tcoding_n\tdown_hw\tdown_hb\tdown_n\n");
+    for(l = 0; l < gene_n; l++) {
+        if(pair_n == 0) {
+            printf("%s", genes[l].id);
+            printVar(genes[l].up);
+            printVar(genes[l].cds);
+            printVar(genes[l].down);
+            printf("\n");
+            continue;
+        }
+        for(i = 0, k = 0; i < pop_n; i++) {
+            for(j = i + 1; j < pop_n; j++, k++) {
+                printf("%s\t%s\t%s", genes[l].id, names[i], names[j]);
+                printVar(genes[l].pair[k]);
+                printVar(genes[l].pair[pair_n + k]);
+                printVar(genes[l].pair[2 * pair_n + k]);
+                printf("\n");
             }
         }
     }
+}
 
-    if(gene_n > 0) {
-        if(isatty(1))
-            fprintf(stderr, "\n");
-        if(bp == 0) {
-            printf("id\tcoding_fst\tcoding_n\n");
-            for(i = 0; i < gene_n; i++)
-                printf("%s\t%f\t%i\n", genes[i].id, estFst(genes[i].cds), genes[i].cds.n);
-        } else {
-            printf("id\tup_fst\tup_n\tcoding_fst\tcoding_n\tdown_fst\tdown_n\n");
-            for(i = 0; i < gene_n; i++)
-                printf("%s\t%f\t%i\t%f\t%i\t%f\t%i\n", genes[i].id, estFst(genes[i].up), genes[i].up.n, estFst(genes[i].cds), genes[i].cds.n, estFst(genes[i].down), genes[i].down.n);
+/* Sums with 17 significant digits, so that -merge reads back the same doubles */
+void printVar(Var_s vars) {
+    printf("\t%.17g\t%.17g\t%i", vars.hw, vars.hb, vars.n);
+}
+
+/* -merge: rebuilds the genes (or pair totals) from the summed partial files and prints them like a single run */
+void mergeParts(Part_s *part) {
+    int i, k, r, row, pop_n = 0, pair_n = 0, gene_n = 0, bp = 0, pairwise = 0;
+    char **names = NULL;
+    Var_s *total = NULL;
+    Gene_s *genes = NULL;
+
+    if(strcmp(part->meta[1], "probs2fst") != 0 || partGet(part, "bp") < 0 || partGet(part, "pairwise") < 0 || partGet(part, "genes") < 0 || (i = partGet(part, "pops")) < 0) {
+        fprintf(stderr, "\nERROR: -merge requires partial files written by probs2fst -partial!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    pop_n = atoi(part->meta[i]);
+    names = part->meta + i + 1;
+    bp = atoi(part->meta[partGet(part, "bp")]);
+    pairwise = atoi(part->meta[partGet(part, "pairwise")]);
+    gene_n = atoi(part->meta[partGet(part, "genes")]);
+    if(pairwise == 1)
+        pair_n = pop_n * (pop_n - 1) / 2;
+    if(i + pop_n >= part->meta_n || part->row_n != (gene_n == 0 ? pair_n : gene_n * (pairwise == 1 ? pair_n : 1)) || part->col_n != (gene_n == 0 ? 3 : 9)) {
+        fprintf(stderr, "\nERROR: The partial files do not have the rows and columns given in their settings!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "Merged %i partial files\n", part->file_n);
+
+    if(gene_n == 0) {
+        if((total = malloc(pair_n * sizeof(Var_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
         }
+        for(k = 0; k < pair_n; k++)
+            total[k] = readVar(part->vals + 3 * k);
+        printPairs(NULL, total, names, 0, pop_n, bp);
+        free(total);
+        return;
     }
 
-    if(isatty(1))
-        fprintf(stderr, "\n");
-    fprintf(stderr, "Kept %i out of %i sites\n", kept_i, site_i);
+    if((genes = calloc(gene_n, sizeof(Gene_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0, row = 0; i < gene_n; i++) {
+        strncpy(genes[i].id, part->keys[row], 100);
+        genes[i].id[strcspn(genes[i].id, "\t")] = '\0';
+        if(pairwise == 0) {
+            genes[i].up = readVar(part->vals + 9 * row);
+            genes[i].cds = readVar(part->vals + 9 * row + 3);
+            genes[i].down = readVar(part->vals + 9 * row + 6);
+            row++;
+            continue;
+        }
+        if((genes[i].pair = malloc(3 * pair_n * sizeof(Var_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        for(k = 0; k < pair_n; k++, row++) {
+            for(r = 0; r < 3; r++)
+                genes[i].pair[r * pair_n + k] = readVar(part->vals + 9 * row + 3 * r);
+        }
+    }
+    if(pairwise == 1)
+        printPairs(genes, NULL, names, gene_n, pop_n, bp);
+    else
+        printGenes(genes, gene_n, bp, 0);
 
-    free(line);
-    free(plist);
-    free(pops);
-    if(gene_n > 0)
-        free(genes);
-    fclose(beagle_file);
+    for(i = 0; i < gene_n; i++)
+        free(genes[i].pair);
+    free(genes);
 }
 
-Var_s estVars(double **dosage, int **plist, int pop_n, int ind_n, int plist_n, int min, double maf) {
-    int i, j, ok = 1;
-    double a = 0, b = 0, c = 0, pbar = 0, nbar = 0, hbar = 0, n_sum = 0, n_sum2 = 0, nc = 0, r = 0, s2 = 0, *p = NULL, *n = NULL;
+Var_s readVar(double *vals) {
     Var_s vars;
 
-    if((p = malloc(pop_n * sizeof(double))) == NULL) {
+    vars.hw = vals[0];
+    vars.hb = vals[1];
+    vars.n = (int)vals[2];
+
+    return vars;
+}
+
+/* Orders the kept individuals by population, so that each population is a contiguous range of the selected columns that the SIMD kernels sum in one go.
+   If cols is given it is filled with the Beagle column of each selected slot. */
+Est_s *estInit(int **plist, int plist_n, int pop_n, int *cols) {
+    int i, k, n = 0;
+    Est_s *est = NULL;
+
+    if((est = malloc(sizeof(Est_s))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    if((n = malloc(pop_n * sizeof(double))) == NULL) {
+    est->pop_n = pop_n;
+    if((est->start = malloc((pop_n + 1) * sizeof(int))) == NULL || (est->all = malloc(pop_n * sizeof(int))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    memset(p, 0, sizeof(double) * pop_n);
-    memset(n, 0, sizeof(double) * pop_n);
-
-    for(i = 0; i < ind_n; i++) {
-        if(dosage[i][0] == 9)
-            continue;
-        for(j = 0; j < plist_n; j++) {
-            if(plist[j][0] == i) {
-                p[plist[j][1]] += dosage[i][0];
-                n[plist[j][1]]++;
-                pbar += dosage[i][0];
-                hbar += dosage[i][1];
-                n_sum++;
+    if((est->dose = malloc(4 * pop_n * sizeof(double))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    est->het = est->dose + pop_n;
+    est->n = est->het + pop_n;
+    est->p = est->n + pop_n;
+    for(k = 0; k < pop_n; k++) {
+        est->all[k] = k;
+        est->start[k] = n;
+        for(i = 0; i < plist_n; i++) {
+            if(plist[i][1] == k) {
+                if(cols != NULL)
+                    cols[n] = plist[i][0];
+                n++;
             }
         }
     }
+    est->start[pop_n] = n;
+
+    return est;
+}
+
+void estFree(Est_s *est) {
+    free(est->start);
+    free(est->all);
+    free(est->dose);
+    free(est);
+}
+
+/* Sums the dosage, heterozygosity and sample size of each population once per site */
+void sumPops(Beagle_s *beagle, Est_s *est) {
+    int i;
+    Dose_s sum;
+
+    for(i = 0; i < est->pop_n; i++) {
+        if(beagleDose(beagle, est->start[i], est->start[i + 1], &est->dose[i], &est->het[i], &est->n[i]))
+            continue;
+        sum = sumDosage(beagle->p1 + est->start[i], beagle->p2 + est->start[i], beagle->miss + est->start[i], est->start[i + 1] - est->start[i]);
+        est->dose[i] = sum.dose;
+        est->het[i] = sum.het;
+        est->n[i] = sum.n;
+    }
+}
+
+/* Weir & Cockerham's variance components among the pop_n populations listed in pops */
+Var_s estVars(Est_s *est, int *pops, int pop_n, int min, double maf) {
+    int i, ok = 1;
+    double a = 0, b = 0, c = 0, pbar = 0, nbar = 0, hbar = 0, n_sum = 0, n_sum2 = 0, nc = 0, r = 0, s2 = 0, *p = est->p, *n = est->n;
+    Var_s vars;
+
+    for(i = 0; i < pop_n; i++) {
+        pbar += est->dose[pops[i]];
+        hbar += est->het[pops[i]];
+        n_sum += n[pops[i]];
+    }
     for(i = 0; i < pop_n; i++) {
-        p[i] /= n[i] * 2;
-        n_sum2 += (n[i] * n[i]);
-        if(n[i] < min)
+        p[i] = est->dose[pops[i]] / (n[pops[i]] * 2);
+        n_sum2 += (n[pops[i]] * n[pops[i]]);
+        if(n[pops[i]] < min)
             ok = 0;
     }
     r = (double)pop_n;
     nbar = n_sum / r;
     pbar /= n_sum * 2;
     hbar /= n_sum;
+    vars.n = n_sum; /* individuals at the site, for -bin (addVar() counts sites) */
     if(ok == 0 || pbar < maf || 1 - pbar < maf) {
-        free(p);
-        free(n);
         vars.hw = 0.0 / 0.0;
         return vars;
     }
     for(i = 0; i < pop_n; i++)
-        s2 += n[i] * (p[i] - pbar) * (p[i] - pbar);
+        s2 += n[pops[i]] * (p[i] - pbar) * (p[i] - pbar);
     s2 /= (r - 1.0) * nbar;
     nc = n_sum - (n_sum2 / n_sum) / (r - 1.0);
     a = (s2 - (pbar * (1.0 - pbar) - (((r - 1.0) * s2) / r) - (hbar / 4.0)) / (nbar - 1.0)) * nbar / nc;
@@ -523,11 +1300,27 @@ Var_s estVars(double **dosage, int **plist, int pop_n, int ind_n, int plist_n, i
         vars.hw = a;
         vars.hb = a + b + c;
     }
-    free(p);
-    free(n);
     return vars;
 }
 
+/* Variance components of every population pair (0, 1), (0, 2), ..., (1, 2), ... Returns the number of pairs that passed the filters. */
+int estPairs(Est_s *est, Var_s *pairs, int min, double maf) {
+    int i, j, k = 0, ok = 0, pops[2];
+
+    for(i = 0; i < est->pop_n; i++) {
+        for(j = i + 1; j < est->pop_n; j++) {
+            pops[0] = i;
+            pops[1] = j;
+            pairs[k] = estVars(est, pops, 2, min, maf);
+            if(isnan(pairs[k].hw) == 0)
+                ok++;
+            k++;
+        }
+    }
+
+    return ok;
+}
+
 double estFst(Var_s vars) {
     return vars.hw / vars.hb;
 }
@@ -540,12 +1333,3 @@ int isNumeric(const char *s) {
     strtod(s, &p);
     return *p == '\0';
 }
-
-void lineTerminator(char *line) {
-    int i;
-
-    for(i = 0; line[i] != 0; i++) {
-        if(line[i] == '\n' || line[i] == '\r')
-            line[i] = '\0';
-    }
-}
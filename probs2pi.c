@@ -15,19 +15,49 @@
  
  ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
 
- Program for estimating pairwise nucleotide diversity (pi) using genotype probabilities.
+ Program for estimating pairwise nucleotide diversity (pi), Watterson's theta and Tajima's D using genotype probabilities.
  The probability file is expected to include both variant and invariant sites.
+ A site counts as segregating when its expected alternative allele count rounds to 1 ... n - 1, where n is the number of sampled chromosomes.
+ With -theta, Watterson's theta (tW) sums segregating sites divided by a_n of each site. Tajima's D compares tW with pi corrected by n / (n - 1) at each site (the tP column stays uncorrected),
+ and its variance uses the constants e1 and e2 of each segregating site's n, averaged over the segregating sites of a gene region or window.
 
- Compiling: gcc probs2pi.c -o probs2pi -lm
+ Compiling: gcc probs2pi.c beagle.c bgzf.c interval.c jackknife.c lines.c partial.c samples.c seek.c simd.c sitebin.c stats.c window.c writer.c -o probs2pi -lm -lz -lpthread
 
  Usage:
- -beagle [file] Posterior genotype probabilities in Beagle format (generated e.g., with Angsd or PCAngsd).
- -genes [file] Tab delimited file listing genes (format chr, start, end, strand [+ or -], id). Optional.
+ -beagle [file] Posterior genotype probabilities in Beagle format (generated e.g., with Angsd or PCAngsd). Can be gzip or BGZF compressed, or converted with beagle2bin (optionally quantised with -bits).
+ -pop [file] File listing individuals from a single population. Can be used >= 1 times to estimate every population in one pass. Duplicated names and names missing from the Beagle file are reported. Optional, by default all individuals form one population.
+ -genes [file] Tab delimited file listing genes (format chr, start, end, strand [+ or -], id). Does not need to be sorted. Optional.
+    If the Beagle file has been indexed with beagle2idx, only the parts covering the genes (+- bp) are read.
  -bp [int] Distance around genes to calculate pi for up- and downstream areas. Optional.
  -min [int] Minimum number of individuals required to consider a site. Default 2.
+ -window [int] Size of sliding windows in bp. The summed pi (tP) and number of sites of each window (and tW and Tajima's D with -theta) are printed as soon as the window closes instead of per-site values. Optional.
+ -step [int] Step between window starts in bp. Default same as -window.
+ -theta Add Watterson's theta (tW) and Tajima's D columns to the gene and window tables. Optional.
+ -jackknife [int] Block size in bp for delete-one block jackknife standard errors, computed in the same pass. Adds a _se column after each region giving the standard error of mean pi per site (tP / n). Optional.
+ -stats [file] Write a JSON summary of the run to file: time spent loading files, matching individuals, waiting for input, parsing, overlapping genes, estimating and writing output,
+    bytes read and the number of sites parsed, outside genes, filtered and kept. Also prints the current position and sites/sec to stderr every 10 seconds. Optional.
+ -partial Print the sums of every gene region (tP, tW, segregating sites, sampled chromosomes, number of sites, and the corrected pi and variance constants of Tajima's D) instead of the gene table. Requires -genes.
+    For runs split by chromosome, region or sites, e.g. over cluster nodes. Every shard must use the same pop files, genes file, -bp and -min. Cannot be combined with -jackknife. Optional.
+ -bin [file] Write per-site pi and n (sampled chromosomes) of every population as BGZF compressed binary records instead of text, and a block index to file.idx.
+    Read with sitebin2txt, which can print single regions. Populations without enough individuals at a site get nan. Per-site output only: cannot be combined with -genes or -window. Optional.
+ -cache [file] Cache of the per-site pi, n and segregating state of every population at the sites that pass -min, stored like -bin. If file was written for the same Beagle file (path, size and modification time),
+    pop files and -min, the sites are read from it instead of the Beagle file, so that a rerun with other -genes, -bp, -window or -jackknife only aggregates them.
+    Otherwise the whole Beagle file is read (without its index) and file is written again. Optional.
+ -threads [int] Number of threads used for inflating BGZF input and compressing -bin and -cache. Output is identical to a single-threaded run. Default 1.
+ -merge [file] Partial file written with -partial. Can be used >= 1 times. The sums of the shards are added and printed as the normal gene table, replacing all other options but -theta.
+    The result is identical to a single run when every gene lies within one shard (e.g. shards by chromosome). A gene split between shards may differ in the last bits of its sums.
 
  Example:
  ./probs2pi -beagle postprobs.beagle -genes genes.txt -bp 1000 -min 6 > test.txt
+ ./probs2pi -beagle postprobs.beagle -window 10000 -step 2000 > windows.txt
+ ./probs2pi -beagle postprobs.beagle -genes genes.txt -bp 1000 -jackknife 500 > test_se.txt
+ ./probs2pi -beagle postprobs.beagle -genes genes.txt -bp 1000 -stats run.json > test.txt
+ ./probs2pi -beagle postprobs.beagle -pop list1.txt -pop list2.txt -pop list3.txt -genes genes.txt -bp 1000 -theta > pops.txt
+ ./probs2pi -beagle postprobs.beagle -pop list1.txt -pop list2.txt -bin sites.bin
+ ./probs2pi -beagle postprobs.beagle -genes genes.txt -bp 1000 -cache pi.cache > test.txt
+ ./probs2pi -beagle postprobs.beagle -genes exons.txt -cache pi.cache > exons.txt
+ ./probs2pi -beagle chr1.beagle -genes genes.txt -bp 1000 -partial > chr1.part
+ ./probs2pi -merge chr1.part -merge chr2.part -merge chr3.part > test.txt
 */
 
 #include <ctype.h>
@@ -37,26 +67,61 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include "beagle.h"
+#include "bgzf.h"
+#include "interval.h"
+#include "lines.h"
+#include "jackknife.h"
+#include "partial.h"
+#include "samples.h"
+#include "seek.h"
+#include "simd.h"
+#include "sitebin.h"
+#include "stats.h"
+#include "window.h"
+#include "writer.h"
 #define merror "\nERROR: System out of memory\n\n"
-#define NA 0.333333
 
 typedef struct {
     int L;
-    double tP;
+    double tP, tW, S, n; /* summed pi, Watterson's theta, segregating sites and sample sizes (chromosomes) */
+    double tD;           /* summed pi with the n / (n - 1) correction, for Tajima's D */
+    double e1, e2;       /* summed variance constants of Tajima's D of the segregating sites */
 } Theta_s;
 
 typedef struct {
     int start, end;
     char str, chr[101], id[101];
-    Theta_s up, cds, down;
+    Theta_s *theta; /* up, cds and down of every population */
+    Jack_s *jack;   /* -jackknife: blocks of up, cds and down of every population */
 } Gene_s;
 
+/* a_n of Watterson's theta and the variance constants e1 and e2 of Tajima's D (Tajima 1989) for a sample size */
+typedef struct {
+    double a, e1, e2;
+} An_s;
+
+/* Estimates of one population at the current site */
+typedef struct {
+    int ok, n;
+    double pi, seg;
+} Site_s;
+
 void openFiles(int argc, char *argv[]);
 Gene_s *readGenes(FILE *gene_file, int *n);
-void readBeagle(FILE *beagle_file, Gene_s *genes, int bp, int gene_n, int min);
-void printOut(Gene_s gene, int bp, int i);
+void readBeagle(FILE *beagle_file, Seek_s *seek, Stats_s *stats, Samples_s *samples, char **names, Gene_s *genes, int bp, int pop_n, int gene_n, int min, int window, int step, int block, int partial, int theta, int threads, char *bin_path, Sitebin_s *cache);
+int *popCols(Beagle_s *beagle, Samples_s *samples, int pop_n, int *off);
+Index_s *indexGenes(Gene_s *genes, int gene_n, int bp);
+void addTheta(Theta_s *t, Site_s *site, An_s *an);
+void addWindow(Writer_s *out, Window_s *w, Theta_s *acc, int *slots, char *chr, int pos, Site_s *sites, An_s *an, char **names, int pop_n, int theta);
+Sitebin_s *openCache(char *path, char *beagle_path, Samples_s *samples, char **names, int pop_n, int min, int threads);
+void saveSite(Sitebin_s *cache, char *chr, int pos, Site_s *sites, int pop_n, double *vals);
+int readCache(Sitebin_s *cache, Site_s *sites, int pop_n);
+void printOut(Gene_s gene, char **names, int bp, int block, int theta, int i, int k);
+void printPartial(Gene_s *genes, char **names, int gene_n, int pop_n, int bp, int min);
+void mergeParts(Part_s *part, int theta);
+double tajimaD(Theta_s t);
 int isNumeric(const char *s);
-void lineTerminator(char *line);
 
 int main(int argc, char *argv[]) {
     int second = 0, minute = 0, hour = 0;
@@ -82,23 +147,46 @@ int main(int argc, char *argv[]) {
 }
 
 void openFiles(int argc, char *argv[]) {
-    int i, j, gene_n = 0, min = 2, bp = 0;
+    int i, gene_n = 0, min = 2, pop_n = 0, bp = 0, window = 0, step = 0, block = 0, partial = 0, theta = 0, threads = 1;
+    double start = 0;
     Gene_s *genes = NULL;
-    FILE *beagle_file = NULL, *gene_file = NULL;
-
+    char **names = NULL, *beagle_path = NULL, *bin_path = NULL, *cache_path = NULL;
+    Samples_s *samples = NULL;
+    Seek_s *seek = NULL;
+    Stats_s *stats = NULL;
+    Part_s *part = NULL;
+    Sitebin_s *cache = NULL;
+    FILE *beagle_file = NULL, *pop_file = NULL, *gene_file = NULL, *part_file = NULL;
+
+    start = statsNow();
     fprintf(stderr, "\nParameters:\n");
 
+    if((names = malloc(argc * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    samples = samplesInit();
+
     for(i = 1; i < argc; i++) {
         if(strcmp(argv[i], "-beagle") == 0) {
-            if((beagle_file = fopen(argv[++i], "r")) == NULL) {
+            beagle_path = argv[++i];
+            fprintf(stderr, "\t-beagle %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-pop") == 0) {
+            if((pop_file = bgzfOpen(argv[++i], 1)) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
-            fprintf(stderr, "\t-beagle %s\n", argv[i]);
+            fprintf(stderr, "\t-pop %s\n", argv[i]);
+
+            names[pop_n] = argv[i];
+            samplesRead(samples, pop_file, pop_n, argv[i]);
+            pop_n++;
         }
 
         else if(strcmp(argv[i], "-genes") == 0) {
-            if((gene_file = fopen(argv[++i], "r")) == NULL) {
+            if((gene_file = bgzfOpen(argv[++i], 1)) == NULL) {
                 fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
                 exit(EXIT_FAILURE);
             }
@@ -117,6 +205,64 @@ void openFiles(int argc, char *argv[]) {
             fprintf(stderr, "\t-min %s\n", argv[i]);
         }
 
+        else if(strcmp(argv[i], "-jackknife") == 0) {
+            if(isNumeric(argv[++i]))
+                block = atoi(argv[i]);
+            fprintf(stderr, "\t-jackknife %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-stats") == 0) {
+            stats = statsOpen(argv[++i], "probs2pi", start);
+            fprintf(stderr, "\t-stats %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-window") == 0) {
+            if(isNumeric(argv[++i]))
+                window = atoi(argv[i]);
+            fprintf(stderr, "\t-window %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-step") == 0) {
+            if(isNumeric(argv[++i]))
+                step = atoi(argv[i]);
+            fprintf(stderr, "\t-step %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-threads") == 0) {
+            if(isNumeric(argv[++i]))
+                threads = atoi(argv[i]);
+            fprintf(stderr, "\t-threads %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-theta") == 0) {
+            theta = 1;
+            fprintf(stderr, "\t-theta\n");
+        }
+
+        else if(strcmp(argv[i], "-partial") == 0) {
+            partial = 1;
+            fprintf(stderr, "\t-partial\n");
+        }
+
+        else if(strcmp(argv[i], "-bin") == 0) {
+            bin_path = argv[++i];
+            fprintf(stderr, "\t-bin %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-cache") == 0) {
+            cache_path = argv[++i];
+            fprintf(stderr, "\t-cache %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-merge") == 0) {
+            if((part_file = bgzfOpen(argv[++i], 1)) == NULL) {
+                fprintf(stderr, "\nERROR: Cannot open file %s\n\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            fprintf(stderr, "\t-merge %s\n", argv[i]);
+            part = partRead(part, part_file, argv[i]);
+        }
+
         else {
             fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
             exit(EXIT_FAILURE);
@@ -125,219 +271,637 @@ void openFiles(int argc, char *argv[]) {
 
     fprintf(stderr, "\n");
 
-    if(beagle_file == NULL) {
+    if(part != NULL) {
+        mergeParts(part, theta);
+        partFree(part);
+        samplesFree(samples);
+        free(names);
+        statsClose(stats);
+        return;
+    }
+
+    if(beagle_path == NULL) {
         fprintf(stderr, "\nERROR: -beagle [file] is required!\n");
         exit(EXIT_FAILURE);
     }
+    if((beagle_file = bgzfOpen(beagle_path, threads)) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot open file %s\n\n", beagle_path);
+        exit(EXIT_FAILURE);
+    }
+
+    if(window > 0 && gene_file != NULL) {
+        fprintf(stderr, "\nERROR: -window cannot be combined with -genes!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(step <= 0 || step > window)
+        step = window;
+    if(block > 0 && gene_file == NULL) {
+        fprintf(stderr, "\nERROR: -jackknife requires -genes!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(partial == 1 && (gene_file == NULL || block > 0)) {
+        fprintf(stderr, "\nERROR: -partial requires -genes and cannot be combined with -jackknife!\n");
+        exit(EXIT_FAILURE);
+    }
+    if(bin_path != NULL && (window > 0 || gene_file != NULL)) {
+        fprintf(stderr, "\nERROR: -bin is for per-site output and cannot be combined with -genes or -window!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(cache_path != NULL)
+        cache = openCache(cache_path, beagle_path, samples, names, pop_n, min, threads);
 
-    if(gene_file != NULL)
+    if(gene_file != NULL) {
         genes = readGenes(gene_file, &gene_n);
+        if(cache == NULL && (seek = seekOpen(beagle_path)) != NULL) {
+            for(i = 0; i < gene_n; i++)
+                seekAdd(seek, genes[i].chr, genes[i].start - bp, genes[i].end + bp);
+        }
+    }
+
+    readBeagle(beagle_file, seek, stats, samples, names, genes, bp, pop_n, gene_n, min, window, step, block, partial, theta, threads, bin_path, cache);
 
-    readBeagle(beagle_file, genes, bp, gene_n, min);
+    samplesFree(samples);
+    free(names);
 }
 
 Gene_s *readGenes(FILE *gene_file, int *n) {
-    int i, char_i = 0, line_i = 0, maxchar = 0;
-    char c, *line = NULL;
+    int size = 0;
+    char *line = NULL, *fields[5];
     Gene_s *list = NULL;
+    Lines_s *lines = NULL;
 
-    while((c = fgetc(gene_file)) != EOF) {
-        char_i++;
-        if(c == '\n') {
-            line_i++;
-            if(char_i > maxchar)
-                maxchar = char_i;
-            char_i = 0;
-        }
+    lines = linesOpen(gene_file);
+    while((line = linesNext(lines)) != NULL) {
+        if(linesSplit(line, fields, 5) < 5)
+            continue;
+        list = linesGrow(list, *n, &size, sizeof(Gene_s));
+        memset(&list[*n], 0, sizeof(Gene_s));
+        strncpy(list[*n].chr, fields[0], 100);
+        list[*n].start = atoi(fields[1]);
+        list[*n].end = atoi(fields[2]);
+        list[*n].str = fields[3][0];
+        strncpy(list[*n].id, fields[4], 100);
+        *n = *n + 1;
     }
+    linesClose(lines);
 
-    rewind(gene_file);
+    return list;
+}
 
-    if((line = malloc((maxchar + 1) * sizeof(char))) == NULL) {
+void readBeagle(FILE *beagle_file, Seek_s *seek, Stats_s *stats, Samples_s *samples, char **names, Gene_s *genes, int bp, int pop_n, int gene_n, int min, int window, int step, int block, int partial, int theta, int threads, char *bin_path, Sitebin_s *cache) {
+    int i, k, r, pos = 0, hit_n = 0, hit_size = 0, kept_i = 0, site_i = 0, outside_i = 0, ok = 0, *hits = NULL, *slots = NULL, *cols = NULL, *off = NULL;
+    double dose = 0, a2 = 0, b1 = 0, b2 = 0, c1 = 0, c2 = 0, *vals = NULL;
+    char *chr = NULL, **bin_names = NULL;
+    Dose_s sum;
+    An_s *an = NULL;
+    Site_s *sites = NULL;
+    Theta_s *acc = NULL;
+    Window_s *w = NULL;
+    Writer_s *out = NULL;
+    Index_s *index = NULL;
+    Beagle_s *beagle = NULL;
+    Sitebin_s *bin = NULL, *save = NULL;
+
+    statsPhase(stats, STATS_MATCH);
+    beagle = beagleOpen(beagle_file);
+    beagle->timed = stats != NULL;
+    if(seek != NULL)
+        beagleSeek(beagle, seek);
+    if((off = malloc((pop_n + 2) * sizeof(int))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    if((list = malloc(line_i * sizeof(Gene_s))) == NULL) {
+    if(pop_n > 0) {
+        cols = popCols(beagle, samples, pop_n, off);
+        beagleSelect(beagle, cols, off[pop_n]);
+        free(cols);
+    } else {
+        /* all individuals form one population */
+        pop_n = 1;
+        off[0] = 0;
+        off[1] = beagle->ind_n;
+        names = NULL;
+    }
+    /* a_n of Watterson's theta and e1, e2 of Tajima's D for every sample size */
+    if((sites = calloc(pop_n, sizeof(Site_s))) == NULL || (an = calloc(2 * beagle->ind_n + 2, sizeof(An_s))) == NULL) {
         fprintf(stderr, merror);
         exit(EXIT_FAILURE);
     }
-    memset(list, 0, sizeof(Gene_s) * line_i);
-
-    while(fgets(line, maxchar + 1, gene_file) != NULL) {
-        if(line[0] == '\n')
-            continue;
-        lineTerminator(line);
-        strncpy(list[*n].chr, strtok(line, "\t"), 100);
-        list[*n].start = atoi(strtok(NULL, "\t"));
-        list[*n].end = atoi(strtok(NULL, "\t"));
-        list[*n].str = strtok(NULL, "\t")[0];
-        strncpy(list[*n].id, strtok(NULL, "\t"), 100);
-        *n = *n + 1;
+    for(i = 2; i <= 2 * beagle->ind_n + 1; i++) {
+        an[i].a = an[i - 1].a + 1.0 / (i - 1);
+        a2 += 1.0 / ((double)(i - 1) * (i - 1));
+        b1 = (i + 1.0) / (3.0 * (i - 1));
+        b2 = 2.0 * ((double)i * i + i + 3) / (9.0 * i * (i - 1));
+        c1 = b1 - 1 / an[i].a;
+        c2 = b2 - (i + 2) / (an[i].a * i) + a2 / (an[i].a * an[i].a);
+        if(i >= 4) { /* both are 0 below four chromosomes, up to rounding */
+            an[i].e1 = c1 / an[i].a;
+            an[i].e2 = c2 / (an[i].a * an[i].a + a2);
+        }
+    }
+    if(cache != NULL && cache->write == 1) {
+        save = cache;
+        cache = NULL;
+    }
+    if((bin_path != NULL || save != NULL) && (vals = malloc(3 * pop_n * sizeof(double))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
     }
 
-    free(line);
-    fclose(gene_file);
-
-    return list;
-}
-
-void readBeagle(FILE *beagle_file, Gene_s *genes, int bp, int gene_n, int min) {
-    int i, j = 0, k = 0, pos = 0, ok = 0, gene_i = 0, kept_i = 0, site_i = 0;
-    double prob[3] = {0}, p = 0, n = 0;
-    char chr[101], *line = NULL, *temp = NULL, *end = NULL;
-    size_t len = 0;
-    ssize_t read;
+    out = writerOpen(stdout);
+    if(gene_n > 0) {
+        index = indexGenes(genes, gene_n, bp);
+        for(i = 0; i < gene_n; i++) {
+            if((genes[i].theta = calloc(3 * pop_n, sizeof(Theta_s))) == NULL || (genes[i].jack = calloc(3 * pop_n, sizeof(Jack_s))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    if(window > 0) {
+        w = windowInit(window, step);
+        if((acc = calloc(w->slot_n * pop_n, sizeof(Theta_s))) == NULL || (slots = malloc(w->slot_n * sizeof(int))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        if(isatty(1))
+            fprintf(stderr, "\n");
+        printf(names == NULL ? "chr\tstart\tend\ttP\tn" : "chr\tstart\tend\tpop\ttP\tn");
+        printf(theta ? "\ttW\tD\n" : "\n");
+    } else if(bin_path != NULL) {
+        /* pi and n of every population, named <pop>_pi and <pop>_n with -pop */
+        if((bin_names = malloc(2 * pop_n * sizeof(char *))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        for(k = 0; k < 2 * pop_n; k++) {
+            if((bin_names[k] = malloc((names == NULL ? 0 : strlen(names[k / 2])) + 4)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            if(names == NULL)
+                strcpy(bin_names[k], k % 2 == 0 ? "pi" : "n");
+            else
+                sprintf(bin_names[k], k % 2 == 0 ? "%s_pi" : "%s_n", names[k / 2]);
+        }
+        bin = sitebinCreate(bin_path, bin_names, 2 * pop_n, NULL, threads);
+    } else if(gene_n == 0 && names != NULL) {
+        printf("chr\tpos");
+        for(k = 0; k < pop_n; k++)
+            printf("\t%s", names[k]);
+        printf("\n");
+    }
 
-    while((read = getline(&line, &len, beagle_file)) != -1) {
-        if(line[0] == '\n')
-            continue;
-        temp = strtok_r(line, "\t", &end);
-        i = 1;
-        j = 0;
-        p = 0;
-        n = 0;
-        if(strcmp(temp, "marker") == 0)
-            continue;
-        site_i++;
-        strncpy(chr, strtok(temp, "_"), 100);
-        pos = atoi(strtok(NULL, "_"));
-        if(gene_n > 0) {
-            ok = 0;
-            while(gene_i < gene_n) {
-                if(strcmp(chr, genes[gene_i].chr) == 0) {
-                    if(pos <= genes[gene_i].end + bp && pos >= genes[gene_i].start - bp) {
-                        ok = 1;
-                        break;
-                    } else if(pos < genes[gene_i].start - bp)
-                        break;
-                } else if(strcmp(chr, genes[gene_i].chr) < 0)
-                    break;
-                gene_i++;
+    while(1) {
+        statsPhase(stats, STATS_PARSE);
+        if(cache != NULL) {
+            if(readCache(cache, sites, pop_n) == 0)
+                break;
+            site_i++;
+            chr = cache->chr;
+            pos = cache->pos;
+        } else {
+            if(beagleNext(beagle) == 0)
+                break;
+            site_i++;
+            chr = beagle->chr;
+            pos = beagle->pos;
+            statsProgress(stats, chr, pos, site_i, beagle->bytes);
+            if(gene_n > 0 && save == NULL) {
+                statsPhase(stats, STATS_OVERLAP);
+                if((hit_n = indexFind(index, indexGetChr(index, chr), pos, pos, &hits, &hit_size)) == 0) {
+                    outside_i++;
+                    continue;
+                }
+                statsPhase(stats, STATS_PARSE);
+            }
+            if(beagle->quant == 0)
+                beagleProbs(beagle);
+            statsPhase(stats, STATS_COMPUTE);
+            for(k = 0, ok = 0; k < pop_n; k++) {
+                if(beagleDose(beagle, off[k], off[k + 1], &sum.dose, &sum.het, &sum.n) == 0)
+                    sum = sumDosage(beagle->p1 + off[k], beagle->p2 + off[k], beagle->miss + off[k], off[k + 1] - off[k]);
+                sites[k].ok = sum.n >= min;
+                sites[k].n = 2 * sum.n;
+                if(sites[k].ok == 0)
+                    continue;
+                dose = round(sum.dose);
+                sites[k].pi = 2 * (sum.dose / sites[k].n) * (1 - sum.dose / sites[k].n);
+                sites[k].seg = dose >= 1 && dose <= sites[k].n - 1;
+                ok++;
             }
             if(ok == 0)
                 continue;
+            if(save != NULL)
+                saveSite(save, chr, pos, sites, pop_n, vals);
         }
-        while(temp != NULL) {
-            if(i > 3) {
-                prob[j] = atof(temp);
-                j++;
-                if(j == 3) {
-                    if(prob[0] != NA | prob[1] != NA | prob[2] != NA) {
-                        p += prob[1] + 2 * prob[2];
-                        n += 2;
-                    }
-                    j = 0;
-                }
+        if(gene_n > 0 && (cache != NULL || save != NULL)) {
+            /* the sites of a cache are overlapped with the genes after estimating */
+            statsPhase(stats, STATS_OVERLAP);
+            if((hit_n = indexFind(index, indexGetChr(index, chr), pos, pos, &hits, &hit_size)) == 0) {
+                outside_i++;
+                continue;
             }
-            temp = strtok_r(NULL, "\t", &end);
-            i++;
-        }
-        if(temp == NULL && n / 2 >= min) {
-            p /= n;
-            kept_i++;
-            if(gene_n == 0)
-                printf("%s\t%i\t%f\n", chr, pos, 2 * p * (1 - p));
-            else {
-                for(i = k; i < gene_n; i++) {
-                    if(strcmp(chr, genes[i].chr) == 0) {
-                        if(pos <= genes[i].end + bp && pos >= genes[i].start - bp) {
-                            if(pos < genes[i].start && genes[i].str == '+') {
-                                genes[i].up.tP += 2 * p * (1 - p);
-                                genes[i].up.L++;
-                            } else if(pos < genes[i].start && genes[i].str == '-') {
-                                genes[i].down.tP += 2 * p * (1 - p);
-                                genes[i].down.L++;
-                            } else if(pos > genes[i].end && genes[i].str == '+') {
-                                genes[i].down.tP += 2 * p * (1 - p);
-                                genes[i].down.L++;
-                            } else if(pos > genes[i].end && genes[i].str == '-') {
-                                genes[i].up.tP += 2 * p * (1 - p);
-                                genes[i].up.L++;
-                            } else {
-                                genes[i].cds.tP += 2 * p * (1 - p);
-                                genes[i].cds.L++;
-                            }
-                        } else if(pos < genes[i].start - bp) {
-                            k = i;
-                            for(j = 1; j <= i; j++) {
-                                if(pos <= genes[i - j].end + bp && pos >= genes[i - j].start - bp)
-                                    k = i - j;
-                                else if(pos > genes[i - j].end + bp) {
-                                    if(i - j - 1 >= 0) {
-                                        if(pos > genes[i - j - 1].end + bp)
-                                            break;
-                                    } else
-                                        break;
-                                }
-                            }
-                            break;
-                        }
-                    } else if(strcmp(chr, genes[i].chr) < 0) {
-                        k = i;
-                        for(j = 1; j <= i; j++) {
-                            if(strcmp(chr, genes[i - j].chr) == 0) {
-                                if(pos <= genes[i - j].end + bp && pos >= genes[i - j].start - bp)
-                                    k = i - j;
-                                else if(pos > genes[i - j].end + bp) {
-                                    if(i - j - 1 >= 0) {
-                                        if(pos > genes[i - j - 1].end + bp)
-                                            break;
-                                    } else
-                                        break;
-                                }
-                            } else if(strcmp(chr, genes[i - j].chr) > 0)
-                                break;
-                        }
-                        break;
-                    }
+        }
+        kept_i++;
+        statsPhase(stats, STATS_OUTPUT);
+        if(window > 0)
+            addWindow(out, w, acc, slots, chr, pos, sites, an, names, pop_n, theta);
+        else if(bin != NULL) {
+            for(k = 0; k < pop_n; k++) {
+                vals[2 * k] = sites[k].ok ? sites[k].pi : 0.0 / 0.0;
+                vals[2 * k + 1] = sites[k].n;
+            }
+            sitebinAdd(bin, chr, pos, vals);
+        } else if(gene_n == 0) {
+            writerStr(out, chr);
+            writerChar(out, '\t');
+            writerInt(out, pos);
+            for(k = 0; k < pop_n; k++) {
+                writerChar(out, '\t');
+                if(sites[k].ok)
+                    writerFloat(out, sites[k].pi, 6);
+                else
+                    writerStr(out, "nan");
+            }
+            writerChar(out, '\n');
+        }
+        else {
+            for(i = 0; i < hit_n; i++) {
+                if(pos < genes[hits[i]].start)
+                    r = genes[hits[i]].str == '+' ? 0 : 2;
+                else if(pos > genes[hits[i]].end)
+                    r = genes[hits[i]].str == '+' ? 2 : 0;
+                else
+                    r = 1;
+                for(k = 0; k < pop_n; k++) {
+                    if(sites[k].ok == 0)
+                        continue;
+                    addTheta(&genes[hits[i]].theta[3 * k + r], &sites[k], an);
+                    if(block > 0)
+                        jackAdd(&genes[hits[i]].jack[3 * k + r], pos / block, sites[k].pi, 1);
                 }
             }
         }
     }
 
+    statsPhase(stats, STATS_OUTPUT);
+    if(window > 0)
+        addWindow(out, w, acc, slots, NULL, 0, NULL, an, names, pop_n, theta);
+    writerClose(out);
+    sitebinClose(bin);
+    sitebinClose(save);
+    sitebinClose(cache);
     if(gene_n > 0) {
         if(isatty(1))
             fprintf(stderr, "\n");
-        for(i = 0; i < gene_n; i++)
-            printOut(genes[i], bp, i);
+        if(partial == 1)
+            printPartial(genes, names, gene_n, pop_n, bp, min);
+        else {
+            for(i = 0; i < gene_n; i++) {
+                for(k = 0; k < pop_n; k++)
+                    printOut(genes[i], names, bp, block, theta, i, k);
+            }
+        }
     }
 
     if(isatty(1))
         fprintf(stderr, "\n");
     fprintf(stderr, "Kept %i out of %i sites\n", kept_i, site_i);
+    if(stats != NULL) {
+        stats->time[STATS_PARSE] -= beagle->wait;
+        stats->time[STATS_READ] += beagle->wait;
+        stats->bytes = beagle->bytes;
+        stats->parsed = site_i;
+        stats->outside = outside_i;
+        stats->kept = kept_i;
+    }
 
-    free(line);
-    if(gene_n > 0)
+    if(gene_n > 0) {
+        for(i = 0; i < gene_n; i++) {
+            for(r = 0; r < 3 * pop_n; r++)
+                jackFree(&genes[i].jack[r]);
+            free(genes[i].theta);
+            free(genes[i].jack);
+        }
         free(genes);
-    fclose(beagle_file);
+        free(hits);
+        indexFree(index);
+    }
+    if(window > 0) {
+        free(acc);
+        free(slots);
+        windowFree(w);
+    }
+    if(bin_names != NULL) {
+        for(k = 0; k < 2 * pop_n; k++)
+            free(bin_names[k]);
+    }
+    free(bin_names);
+    free(vals);
+    free(sites);
+    free(an);
+    free(off);
+    beagleClose(beagle);
+    statsClose(stats);
 }
 
-void printOut(Gene_s gene, int bp, int i) {
-    if(bp == 0) {
-        if(i == 0)
-            printf("id\tcoding_tP\tcoding_n\n");
-        printf("%s\t%f\t%i\n", gene.id, gene.cds.tP, gene.cds.L);
-    } else {
-        if(i == 0)
-            printf("id\tup_tP\tup_n\tcoding_tP\tcoding_n\tdown_tP\tdown_n\n");
-        printf("%s\t%f\t%i\t%f\t%i\t%f\t%i\n", gene.id, gene.up.tP, gene.up.L, gene.cds.tP, gene.cds.L, gene.down.tP, gene.down.L);
+/* -cache: opens the cache for reading if it matches the input and settings, otherwise creates it with pi, n and seg of every population (<pop>_pi, ... with -pop) */
+Sitebin_s *openCache(char *path, char *beagle_path, Samples_s *samples, char **names, int pop_n, int min, int threads) {
+    int k, val_n = 3 * (pop_n > 0 ? pop_n : 1);
+    char settings[256], *key = NULL, **vnames = NULL, *types[3] = {"pi", "n", "seg"};
+    Sitebin_s *cache = NULL;
+
+    sprintf(settings, "pops\t%i\t%016llx\tmin\t%i", pop_n, samplesHash(samples), min);
+    key = sitebinKey("probs2pi", beagle_path, settings);
+    if((cache = sitebinCache(path, key, threads)) != NULL) {
+        free(key);
+        return cache;
+    }
+    if((vnames = malloc(val_n * sizeof(char *))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(k = 0; k < val_n; k++) {
+        if((vnames[k] = malloc((pop_n > 0 ? strlen(names[k / 3]) : 0) + 5)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        if(pop_n > 0)
+            sprintf(vnames[k], "%s_%s", names[k / 3], types[k % 3]);
+        else
+            strcpy(vnames[k], types[k % 3]);
     }
+    fprintf(stderr, "Writing per-site values to cache %s\n", path);
+    cache = sitebinCreate(path, vnames, val_n, key, threads);
+    for(k = 0; k < val_n; k++)
+        free(vnames[k]);
+    free(vnames);
+    free(key);
+
+    return cache;
 }
 
-int isNumeric(const char *s) {
-    char *p;
+/* Adds pi, n and seg of every population to the cache, pi is nan for populations below -min */
+void saveSite(Sitebin_s *cache, char *chr, int pos, Site_s *sites, int pop_n, double *vals) {
+    int k;
 
-    if(s == NULL || *s == '\0' || isspace(*s))
+    for(k = 0; k < pop_n; k++) {
+        vals[3 * k] = sites[k].ok ? sites[k].pi : 0.0 / 0.0;
+        vals[3 * k + 1] = sites[k].n;
+        vals[3 * k + 2] = sites[k].seg;
+    }
+    sitebinAdd(cache, chr, pos, vals);
+}
+
+/* Reads the next site of the cache into sites. Returns 0 at the end of the cache. */
+int readCache(Sitebin_s *cache, Site_s *sites, int pop_n) {
+    int k;
+
+    if(sitebinNext(cache) == 0)
         return 0;
-    strtod(s, &p);
-    return *p == '\0';
+    for(k = 0; k < pop_n; k++) {
+        sites[k].ok = !isnan(cache->vals[3 * k]);
+        sites[k].pi = cache->vals[3 * k];
+        sites[k].n = (int)cache->vals[3 * k + 1];
+        sites[k].seg = cache->vals[3 * k + 2];
+    }
+
+    return 1;
+}
+
+/* Beagle columns of the individuals grouped by population, so that population k is columns off[k] ... off[k + 1] - 1 of the selection */
+int *popCols(Beagle_s *beagle, Samples_s *samples, int pop_n, int *off) {
+    int i, k, e, n = 0, *cols = NULL, *fill = NULL;
+
+    if(beagle->names == NULL) {
+        fprintf(stderr, "ERROR: The Beagle file has no header with individual names!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    if((cols = malloc((samples->n + 1) * sizeof(int))) == NULL || (fill = calloc(pop_n + 1, sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    /* count the columns of each population, then place them in column order */
+    for(i = 0; i < beagle->ind_n; i++) {
+        for(e = samplesColumn(samples, beagle->names[i], i); e >= 0; e = samples->next[e])
+            fill[samples->group[e] + 1]++;
+    }
+    for(k = 0; k < pop_n; k++) {
+        if(fill[k + 1] == 0) {
+            fprintf(stderr, "ERROR: Individuals in pop file %i were not found in the Beagle file!\n\n", k + 1);
+            exit(EXIT_FAILURE);
+        }
+        fill[k + 1] += fill[k];
+        off[k] = fill[k];
+    }
+    off[pop_n] = n = fill[pop_n];
+    for(i = 0; i < beagle->ind_n; i++) {
+        for(e = samplesFind(samples, beagle->names[i]); e >= 0 && samples->col[e] == i; e = samples->next[e])
+            cols[fill[samples->group[e]]++] = i;
+    }
+    samplesMissing(samples, "Beagle");
+    fprintf(stderr, "Kept %i individuals from %i populations\n", n, pop_n);
+    free(fill);
+
+    return cols;
 }
 
-void lineTerminator(char *line) {
+/* Indexes the genes together with their flanks (+- bp) */
+Index_s *indexGenes(Gene_s *genes, int gene_n, int bp) {
     int i;
+    Index_s *index = NULL;
+
+    index = indexInit();
+    for(i = 0; i < gene_n; i++)
+        indexAdd(index, indexChr(index, genes[i].chr), genes[i].start - bp, genes[i].end + bp, i);
+    indexBuild(index);
+
+    return index;
+}
 
-    for(i = 0; line[i] != 0; i++) {
-        if(line[i] == '\n' || line[i] == '\r')
-            line[i] = '\0';
+void addTheta(Theta_s *t, Site_s *site, An_s *an) {
+    t->tP += site->pi;
+    if(site->n > 1)
+        t->tD += site->pi * site->n / (site->n - 1);
+    t->S += site->seg;
+    t->tW += site->seg / an[site->n].a;
+    t->e1 += site->seg * an[site->n].e1;
+    t->e2 += site->seg * an[site->n].e2;
+    t->n += site->n;
+    t->L++;
+}
+
+/* Prints the windows that closed before the site and adds the site to the open ones. chr NULL prints the remaining windows. */
+void addWindow(Writer_s *out, Window_s *w, Theta_s *acc, int *slots, char *chr, int pos, Site_s *sites, An_s *an, char **names, int pop_n, int theta) {
+    int i, k, n, slot;
+    Theta_s *t = NULL;
+
+    while((slot = windowClose(w, chr, pos)) >= 0) {
+        for(k = 0; k < pop_n; k++) {
+            t = &acc[slot * pop_n + k];
+            writerStr(out, w->chr);
+            writerChar(out, '\t');
+            writerInt(out, w->start);
+            writerChar(out, '\t');
+            writerInt(out, w->end);
+            if(names != NULL) {
+                writerChar(out, '\t');
+                writerStr(out, names[k]);
+            }
+            writerChar(out, '\t');
+            writerFloat(out, t->tP, 6);
+            writerChar(out, '\t');
+            writerInt(out, t->L);
+            if(theta) {
+                writerChar(out, '\t');
+                writerFloat(out, t->tW, 6);
+                writerChar(out, '\t');
+                writerFloat(out, tajimaD(*t), 6);
+            }
+            writerChar(out, '\n');
+            memset(t, 0, sizeof(Theta_s));
+        }
+    }
+    if(chr == NULL)
+        return;
+    n = windowOpen(w, chr, pos, slots);
+    for(i = 0; i < n; i++) {
+        for(k = 0; k < pop_n; k++) {
+            if(sites[k].ok)
+                addTheta(&acc[slots[i] * pop_n + k], &sites[k], an);
+        }
+    }
+}
+
+/* Prints gene i for population k. Without -pop there is no pop column, tW and D columns follow the regions with -theta. */
+void printOut(Gene_s gene, char **names, int bp, int block, int theta, int i, int k) {
+    int r, first = bp == 0 ? 1 : 0, last = bp == 0 ? 2 : 3;
+    static const char *regions[] = {"up", "coding", "down"};
+    Theta_s *t = gene.theta + 3 * k;
+    Jack_s *jack = gene.jack + 3 * k;
+
+    if(i == 0 && k == 0) {
+        printf(names == NULL ? "id" : "id\tpop");
+        for(r = first; r < last; r++)
+            printf(block > 0 ? "\t%s_tP\t%s_n\t%s_se" : "\t%s_tP\t%s_n", regions[r], regions[r], regions[r]);
+        for(r = first; theta && r < last; r++)
+            printf("\t%s_tW\t%s_D", regions[r], regions[r]);
+        printf("\n");
+    }
+    printf("%s", gene.id);
+    if(names != NULL)
+        printf("\t%s", names[k]);
+    for(r = first; r < last; r++) {
+        printf("\t%f\t%i", t[r].tP, t[r].L);
+        if(block > 0)
+            printf("\t%f", jackSE(&jack[r]));
+    }
+    for(r = first; theta && r < last; r++)
+        printf("\t%f\t%f", t[r].tW, tajimaD(t[r]));
+    printf("\n");
+}
+
+/* -partial: the settings that shards must share, then the sums of every gene and population in the order printed by printOut(). Sums have 17 significant digits, so -merge reads back the same doubles. */
+void printPartial(Gene_s *genes, char **names, int gene_n, int pop_n, int bp, int min) {
+    int i, k, r;
+    Theta_s *t = NULL;
+
+    printf("#partial\tprobs2pi\tkeys\t%i\tbp\t%i\tmin\t%i\tgenes\t%i\tpops\t%i", names == NULL ? 1 : 2, bp, min, gene_n, names == NULL ? 0 : pop_n);
+    for(k = 0; names != NULL && k < pop_n; k++)
+        printf("\t%s", names[k]);
+    printf(names == NULL ? "\nid" : "\nid\tpop");
+    printf("\tup_tP\tup_tW\tup_S\tup_n\tup_L\tup_tD\tup_e1\tup_e2\tcoding_tP\tcoding_tW\tcoding_S\tcoding_n\tcoding_L\tcoding_tD\tcoding_e1\tcoding_e2"
+           "\tdown_tP\tdown_tW\tdown_S\tdown_n\tdown_L\tdown_tD\tdown_e1\tdown_e2\n");
+    for(i = 0; i < gene_n; i++) {
+        for(k = 0; k < pop_n; k++) {
+            printf("%s", genes[i].id);
+            if(names != NULL)
+                printf("\t%s", names[k]);
+            for(r = 0; r < 3; r++) {
+                t = &genes[i].theta[3 * k + r];
+                printf("\t%.17g\t%.17g\t%.17g\t%.17g\t%i\t%.17g\t%.17g\t%.17g", t->tP, t->tW, t->S, t->n, t->L, t->tD, t->e1, t->e2);
+            }
+            printf("\n");
+        }
+    }
+}
+
+/* -merge: rebuilds the genes from the summed partial files and prints them like a single run */
+void mergeParts(Part_s *part, int theta) {
+    int i, k, r, row, pop_n = 0, gene_n = 0, bp = 0;
+    char **names = NULL;
+    double *v = NULL;
+    Gene_s *genes = NULL;
+
+    if(strcmp(part->meta[1], "probs2pi") != 0 || partGet(part, "bp") < 0 || partGet(part, "genes") < 0 || (i = partGet(part, "pops")) < 0) {
+        fprintf(stderr, "\nERROR: -merge requires partial files written by probs2pi -partial!\n\n");
+        exit(EXIT_FAILURE);
+    }
+    pop_n = atoi(part->meta[i]);
+    if(pop_n > 0)
+        names = part->meta + i + 1;
+    else
+        pop_n = 1;
+    bp = atoi(part->meta[partGet(part, "bp")]);
+    gene_n = atoi(part->meta[partGet(part, "genes")]);
+    if((names != NULL && i + pop_n >= part->meta_n) || part->row_n != gene_n * pop_n || part->col_n != 24) {
+        fprintf(stderr, "\nERROR: The partial files do not have the rows and columns given in their settings!\n\n");
+        exit(EXIT_FAILURE);
     }
+    fprintf(stderr, "Merged %i partial files\n", part->file_n);
+
+    if((genes = calloc(gene_n, sizeof(Gene_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0, row = 0; i < gene_n; i++) {
+        if((genes[i].theta = calloc(3 * pop_n, sizeof(Theta_s))) == NULL || (genes[i].jack = calloc(3 * pop_n, sizeof(Jack_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        strncpy(genes[i].id, part->keys[row], 100);
+        genes[i].id[strcspn(genes[i].id, "\t")] = '\0';
+        for(k = 0; k < pop_n; k++, row++) {
+            for(r = 0; r < 3; r++) {
+                v = part->vals + 24 * row + 8 * r;
+                genes[i].theta[3 * k + r].tP = v[0];
+                genes[i].theta[3 * k + r].tW = v[1];
+                genes[i].theta[3 * k + r].S = v[2];
+                genes[i].theta[3 * k + r].n = v[3];
+                genes[i].theta[3 * k + r].L = (int)v[4];
+                genes[i].theta[3 * k + r].tD = v[5];
+                genes[i].theta[3 * k + r].e1 = v[6];
+                genes[i].theta[3 * k + r].e2 = v[7];
+            }
+            printOut(genes[i], names, bp, 0, theta, i, k);
+        }
+    }
+
+    for(i = 0; i < gene_n; i++) {
+        free(genes[i].theta);
+        free(genes[i].jack);
+    }
+    free(genes);
+}
+
+/* Tajima's D of a gene region or window: corrected pi minus tW, which divides by a_n of each site, over the variance e1 S + e2 S (S - 1),
+   with e1 and e2 averaged over the segregating sites. NaN without segregating sites or when they all have fewer than four sampled chromosomes. */
+double tajimaD(Theta_s t) {
+    double var = 0;
+
+    if(t.L == 0 || t.S == 0 || (var = t.e1 + t.e2 * (t.S - 1)) <= 0)
+        return NAN;
+
+    return (t.tD - t.tW) / sqrt(var);
+}
+
+int isNumeric(const char *s) {
+    char *p;
+
+    if(s == NULL || *s == '\0' || isspace(*s))
+        return 0;
+    strtod(s, &p);
+    return *p == '\0';
 }
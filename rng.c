@@ -0,0 +1,125 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Counter-based random numbers and binomial draws. See rng.h.
+*/
+
+#include <math.h>
+#include "rng.h"
+#define GOLDEN 0x9e3779b97f4a7c15ULL
+
+static unsigned long long mix(unsigned long long x);
+static int binomialInv(Rng_s *rng, int n, double p);
+static int binomialMode(Rng_s *rng, int n, double p);
+
+/* FNV-1a hash of a string, used to turn chromosome names and labels into keys */
+unsigned long long rngHash(const char *str, unsigned long long seed) {
+    unsigned long long h = 0xcbf29ce484222325ULL ^ seed;
+
+    while(*str != '\0') {
+        h ^= (unsigned char)*str++;
+        h *= 0x100000001b3ULL;
+    }
+
+    return mix(h);
+}
+
+void rngInit(Rng_s *rng, unsigned long long seed, unsigned long long key1, unsigned long long key2) {
+    rng->state = mix(mix(seed ^ GOLDEN) ^ key1) ^ mix(key2 + GOLDEN);
+}
+
+unsigned long long rngNext(Rng_s *rng) {
+    rng->state += GOLDEN;
+
+    return mix(rng->state);
+}
+
+/* Uniform number in [0, 1) with 53 random bits */
+double rngUniform(Rng_s *rng) {
+    return (rngNext(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Number of successes in n trials with probability p, drawn by inversion with one uniform in most cases */
+int rngBinomial(Rng_s *rng, int n, double p) {
+    if(n <= 0 || p <= 0)
+        return 0;
+    if(p >= 1)
+        return n;
+    if(p > 0.5)
+        return n - rngBinomial(rng, n, 1 - p);
+    if(n * p < 30)
+        return binomialInv(rng, n, p);
+
+    return binomialMode(rng, n, p);
+}
+
+/* splitmix64 finaliser */
+static unsigned long long mix(unsigned long long x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+
+    return x ^ (x >> 31);
+}
+
+/* Sequential search from zero, expected n * p steps */
+static int binomialInv(Rng_s *rng, int n, double p) {
+    int x = 0;
+    double q = 1 - p, s = p / q, a = (n + 1) * s, r = 0, u = 0;
+
+    while(1) {
+        u = rngUniform(rng);
+        x = 0;
+        r = pow(q, n);
+        while(u > r) {
+            u -= r;
+            x++;
+            if(x > n)
+                break;
+            r *= a / x - s;
+        }
+        if(x <= n)
+            return x;
+    }
+}
+
+/* Search outwards from the mode, expected sqrt(n * p * q) steps */
+static int binomialMode(Rng_s *rng, int n, double p) {
+    int m = (int)((n + 1) * p), lo = m, hi = m;
+    double q = 1 - p, fm = 0, flo = 0, fhi = 0, u = 0;
+
+    if(m > n)
+        m = lo = hi = n;
+    fm = exp(lgamma(n + 1.0) - lgamma(m + 1.0) - lgamma(n - m + 1.0) + m * log(p) + (n - m) * log(q));
+    u = rngUniform(rng) - fm;
+    flo = fhi = fm;
+    while(u > 0 && (lo > 0 || hi < n)) {
+        if(hi < n) {
+            fhi *= (double)(n - hi) / (hi + 1) * p / q;
+            hi++;
+            if((u -= fhi) <= 0)
+                return hi;
+        }
+        if(lo > 0) {
+            flo *= (double)lo / (n - lo + 1) * q / p;
+            lo--;
+            if((u -= flo) <= 0)
+                return lo;
+        }
+    }
+
+    return m;
+}
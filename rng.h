@@ -0,0 +1,40 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Counter-based random numbers: every draw is a function of a seed and a key such as (chromosome, position), not of the order in which sites are visited.
+ The same seed therefore gives the same numbers for a site whatever the chunking, thread count or set of other inputs of a run.
+ The generator is splitmix64 started from the hashed key, which is enough for imputation but not meant for cryptography.
+
+ Typical use:
+    rngInit(&rng, seed, rngHash(chr, 0), pos);
+    x = rngBinomial(&rng, n, p);
+*/
+
+#ifndef RNG_H
+#define RNG_H
+
+typedef struct {
+    unsigned long long state;
+} Rng_s;
+
+unsigned long long rngHash(const char *str, unsigned long long seed);
+void rngInit(Rng_s *rng, unsigned long long seed, unsigned long long key1, unsigned long long key2);
+unsigned long long rngNext(Rng_s *rng);
+double rngUniform(Rng_s *rng);
+int rngBinomial(Rng_s *rng, int n, double p);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Sample lists with a string arena and an open-addressing hash table. See samples.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lines.h"
+#include "samples.h"
+#define merror "\nERROR: System out of memory\n\n"
+#define MISSING_LIST 10
+
+static unsigned int hashName(const char *name);
+static int findSlot(Samples_s *s, const char *name);
+static void growSlots(Samples_s *s);
+
+Samples_s *samplesInit(void) {
+    Samples_s *s = NULL;
+
+    if((s = calloc(1, sizeof(Samples_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    s->slot_n = 1024;
+    if((s->slots = calloc(s->slot_n, sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+
+    return s;
+}
+
+/* Adds the names in a list file (one per line) to group. Returns the number of names added. */
+int samplesRead(Samples_s *s, FILE *file, int group, const char *path) {
+    int n = 0, dup_n = 0;
+    char *line = NULL;
+    Lines_s *lines = NULL;
+
+    lines = linesOpen(file);
+    while((line = linesNext(lines)) != NULL) {
+        if(line[0] == '\0')
+            continue;
+        if(samplesAdd(s, line, group) < 0) {
+            if(dup_n++ == 0)
+                fprintf(stderr, "Warning: %s lists %s more than once\n", path, line);
+            continue;
+        }
+        n++;
+    }
+    linesClose(lines);
+    if(dup_n > 1)
+        fprintf(stderr, "Warning: %s has %i duplicated names in total, each is counted once\n", path, dup_n);
+
+    return n;
+}
+
+/* Adds name to group and returns its entry, or -1 if the name is already in the group */
+int samplesAdd(Samples_s *s, const char *name, int group) {
+    int i, e, last = -1;
+    size_t len = strlen(name) + 1;
+
+    if(s->slots[i = findSlot(s, name)] > 0) {
+        for(e = s->slots[i] - 1; e >= 0; e = s->next[e]) {
+            if(s->group[e] == group)
+                return -1;
+            last = e;
+        }
+    }
+
+    if(s->n == s->size) {
+        s->size = s->size == 0 ? 1024 : 2 * s->size;
+        if((s->name = realloc(s->name, s->size * sizeof(size_t))) == NULL || (s->group = realloc(s->group, s->size * sizeof(int))) == NULL ||
+           (s->col = realloc(s->col, s->size * sizeof(int))) == NULL || (s->next = realloc(s->next, s->size * sizeof(int))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    e = s->n++;
+    s->group[e] = group;
+    s->col[e] = -1;
+    s->next[e] = -1;
+    if(last >= 0) {
+        /* another group of a listed name, the name is shared */
+        s->name[e] = s->name[last];
+        s->next[last] = e;
+        return e;
+    }
+
+    if(s->arena_n + len > s->arena_size) {
+        s->arena_size = 2 * (s->arena_n + len) + 4096;
+        if((s->arena = realloc(s->arena, s->arena_size)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(s->arena + s->arena_n, name, len);
+    s->name[e] = s->arena_n;
+    s->arena_n += len;
+    s->slots[i] = e + 1;
+    if(2 * s->n > s->slot_n)
+        growSlots(s);
+
+    return e;
+}
+
+/* Returns the first entry of name, or -1 if it was not listed */
+int samplesFind(Samples_s *s, const char *name) {
+    int i = findSlot(s, name);
+
+    return s->slots[i] - 1;
+}
+
+/* Matches all entries of a header column name to col. Returns the first entry, or -1 if the name is not listed or was already matched to an earlier column (reported). */
+int samplesColumn(Samples_s *s, const char *name, int col) {
+    int e, first = samplesFind(s, name);
+
+    if(first < 0)
+        return -1;
+    if(s->col[first] >= 0) {
+        fprintf(stderr, "Warning: %s is in more than one column of the header, using the first\n", name);
+        return -1;
+    }
+    for(e = first; e >= 0; e = s->next[e])
+        s->col[e] = col;
+
+    return first;
+}
+
+/* Forgets the columns matched so far, before matching the header of another file */
+void samplesClear(Samples_s *s) {
+    int e;
+
+    for(e = 0; e < s->n; e++)
+        s->col[e] = -1;
+}
+
+/* Reports the listed names that were not matched to any column and returns their number */
+int samplesMissing(Samples_s *s, const char *source) {
+    int e, n = 0;
+    const char *name = NULL;
+
+    for(e = 0; e < s->n; e++) {
+        name = s->arena + s->name[e];
+        if(s->col[e] >= 0 || samplesFind(s, name) != e)
+            continue;
+        if(n == 0)
+            fprintf(stderr, "Warning: Individuals not found in the %s file: %s", source, name);
+        else if(n < MISSING_LIST)
+            fprintf(stderr, ", %s", name);
+        n++;
+    }
+    if(n > MISSING_LIST)
+        fprintf(stderr, " and %i more", n - MISSING_LIST);
+    if(n > 0)
+        fprintf(stderr, "\n");
+
+    return n;
+}
+
+/* 64-bit FNV-1a of the groups and names of every entry in listed order, e.g. for the key of a cache (see sitebin.h) */
+unsigned long long samplesHash(Samples_s *s) {
+    int e;
+    unsigned long long h = 14695981039346656037ull;
+    const char *name = NULL;
+
+    for(e = 0; e < s->n; e++) {
+        h ^= (unsigned long long)s->group[e];
+        h *= 1099511628211ull;
+        for(name = s->arena + s->name[e]; *name != '\0'; name++) {
+            h ^= (unsigned char)*name;
+            h *= 1099511628211ull;
+        }
+        h ^= 0xff; /* end of the name */
+        h *= 1099511628211ull;
+    }
+
+    return h;
+}
+
+void samplesFree(Samples_s *s) {
+    free(s->arena);
+    free(s->name);
+    free(s->group);
+    free(s->col);
+    free(s->next);
+    free(s->slots);
+    free(s);
+}
+
+/* FNV-1a */
+static unsigned int hashName(const char *name) {
+    unsigned int h = 2166136261u;
+
+    for(; *name != '\0'; name++) {
+        h ^= (unsigned char)*name;
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+/* Linear probing: returns the slot holding name, or the empty slot where it would go */
+static int findSlot(Samples_s *s, const char *name) {
+    int i = hashName(name) & (s->slot_n - 1);
+
+    while(s->slots[i] > 0 && strcmp(s->arena + s->name[s->slots[i] - 1], name) != 0)
+        i = (i + 1) & (s->slot_n - 1);
+
+    return i;
+}
+
+/* Doubles the table and reinserts the first entry of every name */
+static void growSlots(Samples_s *s) {
+    int i, e, *old = s->slots, old_n = s->slot_n;
+
+    s->slot_n *= 2;
+    if((s->slots = calloc(s->slot_n, sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < old_n; i++) {
+        if((e = old[i] - 1) < 0)
+            continue;
+        s->slots[findSlot(s, s->arena + s->name[e])] = e + 1;
+    }
+    free(old);
+}
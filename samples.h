@@ -0,0 +1,56 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Sample (individual) lists given with -pop and -inds. Names are copied into a single string arena and found through an open-addressing hash table,
+ so matching a Beagle or bedGraph header costs one lookup per column instead of comparing every column against every listed name.
+ A name can belong to several groups (population files); its entries are chained with next. A name listed twice in the same file is reported and counted once.
+
+ Typical use:
+    s = samplesInit();
+    samplesRead(s, pop_file, 0, path);
+    for(i = 0; i < ind_n; i++)
+        for(e = samplesColumn(s, names[i], i); e >= 0; e = s->next[e])
+            ...column i belongs to group s->group[e]...
+    samplesMissing(s, "Beagle");
+    samplesFree(s);
+*/
+
+#ifndef SAMPLES_H
+#define SAMPLES_H
+
+#include <stdio.h>
+
+typedef struct {
+    char *arena;
+    size_t arena_n, arena_size;
+    size_t *name; /* arena offset of the name of each entry */
+    int *group, *col, *next; /* group (file) of the entry, header column matched to it (-1 if none) and the next entry with the same name (-1 if none) */
+    int n, size;
+    int *slots, slot_n; /* first entry of each name + 1, 0 for empty slots. At most half of the slots are used. */
+} Samples_s;
+
+Samples_s *samplesInit(void);
+int samplesRead(Samples_s *s, FILE *file, int group, const char *path);
+int samplesAdd(Samples_s *s, const char *name, int group);
+int samplesFind(Samples_s *s, const char *name);
+int samplesColumn(Samples_s *s, const char *name, int col);
+void samplesClear(Samples_s *s);
+int samplesMissing(Samples_s *s, const char *source);
+unsigned long long samplesHash(Samples_s *s);
+void samplesFree(Samples_s *s);
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Position index of Beagle files. See seek.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bgzf.h"
+#include "seek.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+static void addMarker(Seek_s *s, char *mark, int mark_n, long long off, int first);
+static void addEntry(Seek_s *s, int chr, int pos, long long off);
+static Seek_s *seekNew(void);
+static int cmpQuery(const void *a, const void *b);
+static const char **sort_names = NULL;
+static int cmpName(const void *a, const void *b);
+
+/* Writes the index of a plain or BGZF compressed Beagle file. Returns the number of entries. */
+long long seekBuild(const char *path, const char *out_path) {
+    int i, state = 0, mark_n = 0, first = 0, bgzf = 0;
+    unsigned int n = 0;
+    long long coff = 0, start = 0, off = 0;
+    unsigned char head[18], *buf = NULL;
+    char mark[1024];
+    FILE *raw = NULL;
+    Seek_s *s = NULL;
+
+    if((raw = fopen(path, "rb")) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot open file %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    n = fread(head, 1, 18, raw);
+    if(n >= 2 && head[0] == 0x1f && head[1] == 0x8b) {
+        if(n < 18 || !(head[3] & 4) || head[12] != 'B' || head[13] != 'C') {
+            fprintf(stderr, "\nERROR: %s is gzip compressed but not BGZF, compress it with bgzip to index it\n\n", path);
+            exit(EXIT_FAILURE);
+        }
+        bgzf = 1;
+    }
+    rewind(raw);
+    if((buf = malloc(SEEK_PLAIN)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    s = seekNew();
+
+    while(1) {
+        coff = ftello(raw);
+        if(bgzf) {
+            if(bgzfBlock(raw, path, buf, &n) == 0)
+                break;
+        } else if((n = fread(buf, 1, SEEK_PLAIN, raw)) == 0)
+            break;
+        first = 1;
+        for(i = 0; i < n; i++) {
+            off = bgzf ? (coff << 16 | i) : coff + i;
+            if(state == 0) {
+                /* start of a line */
+                start = off;
+                mark_n = 0;
+                state = 1;
+            }
+            if(state == 1) {
+                if(buf[i] == '\t' || buf[i] == '\n') {
+                    addMarker(s, mark, mark_n, start, first);
+                    first = 0;
+                    state = buf[i] == '\n' ? 0 : 2;
+                } else if(mark_n < sizeof(mark) - 1)
+                    mark[mark_n++] = buf[i];
+            } else {
+                unsigned char *nl = memchr(buf + i, '\n', n - i);
+                if(nl == NULL)
+                    break;
+                i = nl - buf;
+                state = 0;
+            }
+        }
+    }
+    if(state == 1)
+        addMarker(s, mark, mark_n, start, 0);
+
+    seekWrite(s, out_path);
+    fclose(raw);
+    free(buf);
+    off = s->n;
+    seekFree(s);
+
+    return off;
+}
+
+/* Writes the chromosomes and entries of an index */
+void seekWrite(Seek_s *s, const char *out_path) {
+    int i;
+    long long off = 0;
+    char pad[8] = {0};
+    FILE *out = NULL;
+    SeekHead_s h = {{0}};
+
+    if((out = fopen(out_path, "wb")) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot create file %s\n\n", out_path);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(h.magic, SEEK_MAGIC, 8);
+    h.chr_n = s->chr_n;
+    h.entry_n = s->n;
+    fwrite(&h, sizeof(SeekHead_s), 1, out);
+    for(i = 0; i < s->chr_n; i++) {
+        fwrite(s->chrs[i], 1, strlen(s->chrs[i]) + 1, out);
+        off += strlen(s->chrs[i]) + 1;
+    }
+    fwrite(pad, 1, (8 - off % 8) % 8, out);
+    fwrite(s->entries, sizeof(SeekEntry_s), s->n, out);
+    if(fclose(out) != 0) {
+        fprintf(stderr, "\nERROR: Cannot write file %s\n\n", out_path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Loads the index of a Beagle file from <path>.idx. Returns NULL if there is no index. */
+Seek_s *seekOpen(const char *path) {
+    int i;
+    long long size = 0, off = 0;
+    char *name = NULL, *data = NULL;
+    FILE *file = NULL;
+    SeekHead_s *h = NULL;
+    Seek_s *s = NULL;
+
+    if((name = malloc(strlen(path) + 5)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    sprintf(name, "%s.idx", path);
+    if((file = fopen(name, "rb")) == NULL) {
+        free(name);
+        return NULL;
+    }
+    fseeko(file, 0, SEEK_END);
+    size = ftello(file);
+    rewind(file);
+    if((data = malloc(size + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    h = (SeekHead_s *)data;
+    if(fread(data, 1, size, file) != size || size < sizeof(SeekHead_s) || memcmp(h->magic, SEEK_MAGIC, 8) != 0) {
+        fprintf(stderr, "\nERROR: %s is not a valid index\n\n", name);
+        exit(EXIT_FAILURE);
+    }
+    data[size] = '\0';
+    fclose(file);
+
+    s = seekNew();
+    s->chr_n = h->chr_n;
+    s->n = h->entry_n;
+    if((s->chrs = malloc(s->chr_n * sizeof(char *))) == NULL || (s->entries = malloc(s->n * sizeof(SeekEntry_s) + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0, off = sizeof(SeekHead_s); i < s->chr_n; i++) {
+        if(off >= size || (s->chrs[i] = strdup(data + off)) == NULL) {
+            fprintf(stderr, "\nERROR: %s is not a valid index\n\n", name);
+            exit(EXIT_FAILURE);
+        }
+        off += strlen(s->chrs[i]) + 1;
+    }
+    off += (8 - (off - sizeof(SeekHead_s)) % 8) % 8;
+    if(off + s->n * (long long)sizeof(SeekEntry_s) > size) {
+        fprintf(stderr, "\nERROR: %s is not a valid index\n\n", name);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(s->entries, data + off, s->n * sizeof(SeekEntry_s));
+    free(data);
+
+    if((s->first = calloc(s->chr_n + 1, sizeof(long long))) == NULL || (s->order = malloc(s->chr_n * sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(off = s->n - 1; off >= 0; off--)
+        s->first[s->entries[off].chr] = off;
+    s->first[s->chr_n] = s->n;
+    for(i = 0; i < s->chr_n; i++)
+        s->order[i] = i;
+    sort_names = (const char **)s->chrs;
+    qsort(s->order, s->chr_n, sizeof(int), cmpName);
+    fprintf(stderr, "Using index %s\n", name);
+    free(name);
+
+    return s;
+}
+
+/* Returns the id of a chromosome, or -1 if it is not in the index */
+int seekChr(Seek_s *s, const char *chr, int len) {
+    int lo = 0, hi = s->chr_n - 1, mid = 0, c = 0;
+
+    if(s->last != NULL && strncmp(s->last, chr, len) == 0 && s->last[len] == '\0')
+        return s->last_chr;
+    while(lo <= hi) {
+        mid = (lo + hi) / 2;
+        if((c = strncmp(s->chrs[s->order[mid]], chr, len)) == 0 && s->chrs[s->order[mid]][len] != '\0')
+            c = 1;
+        if(c == 0) {
+            s->last = s->chrs[s->order[mid]];
+            s->last_chr = s->order[mid];
+            return s->last_chr;
+        } else if(c < 0)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+
+    return -1;
+}
+
+/* Adds a region to read. Regions on chromosomes missing from the index are ignored. */
+void seekAdd(Seek_s *s, const char *chr, int start, int end) {
+    int id = seekChr(s, chr, strlen(chr));
+
+    if(id < 0)
+        return;
+    if(s->query_n == s->query_size) {
+        s->query_size = s->query_size == 0 ? 1024 : 2 * s->query_size;
+        if((s->query = realloc(s->query, s->query_size * sizeof(SeekQuery_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->query[s->query_n].chr = id;
+    s->query[s->query_n].start = start;
+    s->query[s->query_n].end = end;
+    s->query_n++;
+}
+
+/* Sorts the regions in file order and merges overlapping ones */
+void seekSort(Seek_s *s) {
+    int i, n = 0;
+
+    qsort(s->query, s->query_n, sizeof(SeekQuery_s), cmpQuery);
+    for(i = 0; i < s->query_n; i++) {
+        if(n > 0 && s->query[i].chr == s->query[n - 1].chr && s->query[i].start <= s->query[n - 1].end + 1) {
+            if(s->query[i].end > s->query[n - 1].end)
+                s->query[n - 1].end = s->query[i].end;
+        } else
+            s->query[n++] = s->query[i];
+    }
+    s->query_n = n;
+    s->query_i = 0;
+}
+
+/* Returns the last entry of a chromosome before pos, or its first entry */
+SeekEntry_s *seekEntry(Seek_s *s, int chr, int pos) {
+    long long lo = s->first[chr], hi = s->first[chr + 1] - 1, mid = 0, e = s->first[chr];
+
+    while(lo <= hi) {
+        mid = (lo + hi) / 2;
+        if(s->entries[mid].pos < pos) {
+            e = mid;
+            lo = mid + 1;
+        } else
+            hi = mid - 1;
+    }
+
+    return &s->entries[e];
+}
+
+/* Splits the chr_pos marker of a line. Returns the length of the chromosome name, or -1 for the header. */
+int seekMarker(const char *line, int len, int *pos) {
+    int i, n = len;
+
+    if(len == 6 && strncmp(line, "marker", 6) == 0)
+        return -1;
+    *pos = 0;
+    for(i = len - 1; i >= 0; i--) {
+        if(line[i] == '_') {
+            n = i;
+            break;
+        }
+    }
+    for(i = n + 1; i < len && line[i] >= '0' && line[i] <= '9'; i++)
+        *pos = *pos * 10 + (line[i] - '0');
+
+    return n;
+}
+
+void seekFree(Seek_s *s) {
+    int i;
+
+    if(s == NULL)
+        return;
+    for(i = 0; i < s->chr_n; i++)
+        free(s->chrs[i]);
+    free(s->chrs);
+    free(s->order);
+    free(s->first);
+    free(s->entries);
+    free(s->query);
+    free(s);
+}
+
+/* Adds the first line of a block, or of a chromosome, to the index being built */
+static void addMarker(Seek_s *s, char *mark, int mark_n, long long off, int first) {
+    int i, chr = 0, pos = 0, len = 0;
+
+    if((len = seekMarker(mark, mark_n, &pos)) < 0 || mark_n == 0)
+        return;
+    mark[len] = '\0';
+    chr = s->chr_n - 1;
+    if(chr < 0 || strcmp(s->chrs[chr], mark) != 0) {
+        for(i = 0; i < s->chr_n; i++) {
+            if(strcmp(s->chrs[i], mark) == 0) {
+                fprintf(stderr, "\nERROR: Chromosome %s is not contiguous, sort the Beagle file to index it\n\n", mark);
+                exit(EXIT_FAILURE);
+            }
+        }
+        if((s->chrs = realloc(s->chrs, (s->chr_n + 1) * sizeof(char *))) == NULL || (s->chrs[s->chr_n] = strdup(mark)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        chr = s->chr_n++;
+        addEntry(s, chr, pos, off);
+    } else if(pos < s->last_pos) {
+        fprintf(stderr, "\nERROR: Position %s_%i is not sorted, sort the Beagle file to index it\n\n", mark, pos);
+        exit(EXIT_FAILURE);
+    } else if(first)
+        addEntry(s, chr, pos, off);
+    s->last_pos = pos;
+}
+
+static void addEntry(Seek_s *s, int chr, int pos, long long off) {
+    if((s->n & (s->n - 1)) == 0 && (s->entries = realloc(s->entries, (s->n == 0 ? 1 : 2 * s->n) * sizeof(SeekEntry_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    s->entries[s->n].chr = chr;
+    s->entries[s->n].pos = pos;
+    s->entries[s->n].off = off;
+    s->n++;
+}
+
+static Seek_s *seekNew(void) {
+    Seek_s *s = NULL;
+
+    if((s = calloc(1, sizeof(Seek_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+
+    return s;
+}
+
+static int cmpQuery(const void *a, const void *b) {
+    const SeekQuery_s *x = a, *y = b;
+
+    if(x->chr != y->chr)
+        return x->chr < y->chr ? -1 : 1;
+    if(x->start != y->start)
+        return x->start < y->start ? -1 : 1;
+
+    return 0;
+}
+
+static int cmpName(const void *a, const void *b) {
+    return strcmp(sort_names[*(const int *)a], sort_names[*(const int *)b]);
+}
@@ -0,0 +1,72 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Position index of a Beagle file for reading only the sites that overlap a set of regions, similar to the linear index of tabix.
+ The index (<file>.idx, written by beagle2idx) lists the virtual offset of the first line starting in each BGZF block (every 64 kb for plain files) and of the first line of each chromosome.
+ The Beagle file must be sorted by position within chromosomes and list each chromosome once, which beagle2idx checks.
+ The same format indexes the blocks of per-site binary output (see sitebin.h), written with seekWrite().
+
+ Typical use:
+    if((s = seekOpen(path)) != NULL) {
+        seekAdd(s, chr, start, end); (once per region)
+        beagleSeek(beagle, s);
+    }
+*/
+
+#ifndef SEEK_H
+#define SEEK_H
+
+#define SEEK_MAGIC "BGLIDX01"
+#define SEEK_PLAIN 65536
+
+typedef struct {
+    char magic[8];
+    int chr_n, pad;
+    long long entry_n;
+} SeekHead_s;
+
+typedef struct {
+    int chr, pos;
+    long long off; /* virtual offset of the line */
+} SeekEntry_s;
+
+typedef struct {
+    int chr, start, end;
+} SeekQuery_s;
+
+typedef struct {
+    int chr_n, *order;       /* chromosomes in file order and their ids sorted by name */
+    char **chrs;
+    long long n, *first;     /* entries and the first entry of each chromosome */
+    SeekEntry_s *entries;
+    int query_n, query_size, query_i;
+    SeekQuery_s *query;      /* regions to read, sorted and merged by seekSort() */
+    char *last;              /* name of the last chromosome looked up and its id */
+    int last_chr, last_pos;  /* last_pos is the previous position while building */
+} Seek_s;
+
+long long seekBuild(const char *path, const char *out_path);
+void seekWrite(Seek_s *s, const char *out_path);
+Seek_s *seekOpen(const char *path);
+int seekChr(Seek_s *s, const char *chr, int len);
+void seekAdd(Seek_s *s, const char *chr, int start, int end);
+void seekSort(Seek_s *s);
+SeekEntry_s *seekEntry(Seek_s *s, int chr, int pos);
+int seekMarker(const char *line, int len, int *pos);
+void seekFree(Seek_s *s);
+
+#endif
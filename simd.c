@@ -0,0 +1,202 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ SIMD kernels for the per-site reductions of probs2fst and probs2pi. See simd.h.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "simd.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static Dose_s finishDosage(const double *p1, const double *p2, const char *miss, int i, int n, double *d, double *h, long long count);
+static Dose_s scalarDosage(const double *p1, const double *p2, const char *miss, int n);
+#ifdef SIMD_X86
+static Dose_s avx2Dosage(const double *p1, const double *p2, const char *miss, int n);
+static Dose_s avx512Dosage(const double *p1, const double *p2, const char *miss, int n);
+#elif defined(__aarch64__)
+static Dose_s neonDosage(const double *p1, const double *p2, const char *miss, int n);
+#endif
+
+static int level = -1;
+static Dose_s (*kernel)(const double *p1, const double *p2, const char *miss, int n) = NULL;
+
+/* Sums the dosage and heterozygosity of the n genotypes that are not missing. Every kernel adds in the same order (see simd.h). */
+Dose_s sumDosage(const double *p1, const double *p2, const char *miss, int n) {
+    if(kernel == NULL)
+        simdSet(-1);
+    return kernel(p1, p2, miss, n);
+}
+
+/* Chooses the kernel: -1 for the best one the CPU supports, otherwise the given level if it is supported. Returns the level in use. */
+int simdSet(int want) {
+    int best = SIMD_SCALAR;
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        best = SIMD_AVX2;
+    if(__builtin_cpu_supports("avx512f"))
+        best = SIMD_AVX512;
+#elif defined(__aarch64__)
+    best = SIMD_NEON;
+#endif
+    if(want == SIMD_SCALAR || (want > SIMD_SCALAR && want <= best && (want == SIMD_NEON) == (best == SIMD_NEON)))
+        best = want;
+
+    level = SIMD_SCALAR;
+    kernel = scalarDosage;
+#ifdef SIMD_X86
+    if(best == SIMD_AVX2) {
+        level = SIMD_AVX2;
+        kernel = avx2Dosage;
+    } else if(best == SIMD_AVX512) {
+        level = SIMD_AVX512;
+        kernel = avx512Dosage;
+    }
+#elif defined(__aarch64__)
+    if(best == SIMD_NEON) {
+        level = SIMD_NEON;
+        kernel = neonDosage;
+    }
+#endif
+
+    return level;
+}
+
+const char *simdName(void) {
+    static const char *names[] = {"scalar", "neon", "avx2", "avx512"};
+
+    if(kernel == NULL)
+        simdSet(-1);
+    return names[level];
+}
+
+/* Adds the genotypes from i on to the partial sums, genotype i going to sum i % SIMD_SUMS as in the vector loops, and combines the sums in a fixed order */
+static Dose_s finishDosage(const double *p1, const double *p2, const char *miss, int i, int n, double *d, double *h, long long count) {
+    Dose_s sum = {0};
+
+    for(; i < n; i++) {
+        if(miss[i] == 0) {
+            d[i % SIMD_SUMS] += p1[i] + 2 * p2[i];
+            h[i % SIMD_SUMS] += p1[i];
+            count++;
+        }
+    }
+    sum.dose = ((d[0] + d[1]) + (d[2] + d[3])) + ((d[4] + d[5]) + (d[6] + d[7]));
+    sum.het = ((h[0] + h[1]) + (h[2] + h[3])) + ((h[4] + h[5]) + (h[6] + h[7]));
+    sum.n = count;
+
+    return sum;
+}
+
+static Dose_s scalarDosage(const double *p1, const double *p2, const char *miss, int n) {
+    double d[SIMD_SUMS] = {0}, h[SIMD_SUMS] = {0};
+
+    return finishDosage(p1, p2, miss, 0, n, d, h, 0);
+}
+
+#ifdef SIMD_X86
+__attribute__((target("avx2"))) static Dose_s avx2Dosage(const double *p1, const double *p2, const char *miss, int n) {
+    int i;
+    int32_t m4[2];
+    double d[SIMD_SUMS], h[SIMD_SUMS];
+    int64_t c[4];
+    __m256d dose0 = _mm256_setzero_pd(), dose1 = _mm256_setzero_pd(), het0 = _mm256_setzero_pd(), het1 = _mm256_setzero_pd(), a, b, keep0, keep1;
+    __m256i count = _mm256_setzero_si256(), mask0, mask1;
+
+    /* two vectors per step, so genotype i goes to partial sum i % 8 */
+    for(i = 0; i + SIMD_SUMS <= n; i += SIMD_SUMS) {
+        memcpy(m4, miss + i, 8);
+        mask0 = _mm256_cmpeq_epi64(_mm256_cvtepi8_epi64(_mm_cvtsi32_si128(m4[0])), _mm256_setzero_si256());
+        mask1 = _mm256_cmpeq_epi64(_mm256_cvtepi8_epi64(_mm_cvtsi32_si128(m4[1])), _mm256_setzero_si256());
+        keep0 = _mm256_castsi256_pd(mask0);
+        keep1 = _mm256_castsi256_pd(mask1);
+        a = _mm256_loadu_pd(p1 + i);
+        b = _mm256_loadu_pd(p2 + i);
+        dose0 = _mm256_add_pd(dose0, _mm256_and_pd(_mm256_add_pd(a, _mm256_add_pd(b, b)), keep0));
+        het0 = _mm256_add_pd(het0, _mm256_and_pd(a, keep0));
+        a = _mm256_loadu_pd(p1 + i + 4);
+        b = _mm256_loadu_pd(p2 + i + 4);
+        dose1 = _mm256_add_pd(dose1, _mm256_and_pd(_mm256_add_pd(a, _mm256_add_pd(b, b)), keep1));
+        het1 = _mm256_add_pd(het1, _mm256_and_pd(a, keep1));
+        count = _mm256_sub_epi64(count, _mm256_add_epi64(mask0, mask1));
+    }
+    _mm256_storeu_pd(d, dose0);
+    _mm256_storeu_pd(d + 4, dose1);
+    _mm256_storeu_pd(h, het0);
+    _mm256_storeu_pd(h + 4, het1);
+    _mm256_storeu_si256((__m256i *)c, count);
+
+    return finishDosage(p1, p2, miss, i, n, d, h, c[0] + c[1] + c[2] + c[3]);
+}
+
+__attribute__((target("avx512f"))) static Dose_s avx512Dosage(const double *p1, const double *p2, const char *miss, int n) {
+    int i, count = 0;
+    long long m8;
+    double d[SIMD_SUMS], h[SIMD_SUMS];
+    __m512d dose = _mm512_setzero_pd(), het = _mm512_setzero_pd(), a, b;
+    __mmask8 keep;
+
+    for(i = 0; i + SIMD_SUMS <= n; i += SIMD_SUMS) {
+        memcpy(&m8, miss + i, 8);
+        keep = _mm512_cmpeq_epi64_mask(_mm512_cvtepi8_epi64(_mm_cvtsi64_si128(m8)), _mm512_setzero_si512());
+        a = _mm512_loadu_pd(p1 + i);
+        b = _mm512_loadu_pd(p2 + i);
+        dose = _mm512_mask_add_pd(dose, keep, dose, _mm512_add_pd(a, _mm512_add_pd(b, b)));
+        het = _mm512_mask_add_pd(het, keep, het, a);
+        count += __builtin_popcount(keep);
+    }
+    _mm512_storeu_pd(d, dose);
+    _mm512_storeu_pd(h, het);
+
+    return finishDosage(p1, p2, miss, i, n, d, h, count);
+}
+#elif defined(__aarch64__)
+static Dose_s neonDosage(const double *p1, const double *p2, const char *miss, int n) {
+    int i, k;
+    uint16_t m2;
+    double d[SIMD_SUMS], h[SIMD_SUMS];
+    float64x2_t dose[4], het[4], a, b;
+    uint64x2_t keep, count = vdupq_n_u64(0);
+
+    for(k = 0; k < 4; k++)
+        dose[k] = het[k] = vdupq_n_f64(0);
+    for(i = 0; i + SIMD_SUMS <= n; i += SIMD_SUMS) {
+        for(k = 0; k < 4; k++) {
+            memcpy(&m2, miss + i + 2 * k, 2);
+            keep = vceqzq_u64(vmovl_u32(vget_low_u32(vmovl_u16(vget_low_u16(vmovl_u8(vcreate_u8(m2)))))));
+            a = vld1q_f64(p1 + i + 2 * k);
+            b = vld1q_f64(p2 + i + 2 * k);
+            dose[k] = vaddq_f64(dose[k], vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(vaddq_f64(a, vaddq_f64(b, b))), keep)));
+            het[k] = vaddq_f64(het[k], vreinterpretq_f64_u64(vandq_u64(vreinterpretq_u64_f64(a), keep)));
+            count = vsubq_u64(count, keep);
+        }
+    }
+    for(k = 0; k < 4; k++) {
+        vst1q_f64(d + 2 * k, dose[k]);
+        vst1q_f64(h + 2 * k, het[k]);
+    }
+
+    return finishDosage(p1, p2, miss, i, n, d, h, vaddvq_u64(count));
+}
+#endif
@@ -0,0 +1,43 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Vectorised reductions over the de-interleaved probabilities of beagle.h (p1, p2 and miss of the selected individuals).
+ AVX-512, AVX2, NEON or scalar kernels are chosen at run time from what the CPU supports, so the tools are still compiled with plain gcc.
+ Every kernel, the scalar one included, keeps SIMD_SUMS partial sums (genotype i goes to sum i % SIMD_SUMS) and combines them in the same order,
+ so results are bit-identical whichever kernel the CPU runs.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#define SIMD_SCALAR 0
+#define SIMD_NEON 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+#define SIMD_SUMS 8 /* partial sums of every kernel */
+
+typedef struct {
+    double dose; /* sum of p1 + 2 * p2, i.e. the minor allele dosage */
+    double het;  /* sum of p1 */
+    double n;    /* number of genotypes that are not missing */
+} Dose_s;
+
+Dose_s sumDosage(const double *p1, const double *p2, const char *miss, int n);
+int simdSet(int level);
+const char *simdName(void);
+
+#endif
@@ -0,0 +1,420 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ BGZF compressed per-site binary records. See sitebin.h.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "bgzf.h"
+#include "seek.h"
+#include "sitebin.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+static void flushBlock(Sitebin_s *b);
+static void writeBlock(Sitebin_s *b, SitebinBlock_s *block);
+static void *compressBlocks(void *arg);
+
+/* Creates a file for per-site records of val_n named values, with the key of a cache if key is not NULL. With threads > 1 blocks are compressed on that many worker threads. */
+Sitebin_s *sitebinCreate(const char *path, char **names, int val_n, const char *key, int threads) {
+    int i;
+    size_t len = 0;
+    SitebinHead_s h = {{0}};
+    Sitebin_s *b = NULL;
+
+    if((b = calloc(1, sizeof(Sitebin_s))) == NULL || (b->path = strdup(path)) == NULL || (b->index = calloc(1, sizeof(Seek_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if((b->file = fopen(path, "wb")) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot create file %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    b->write = 1;
+    b->sorted = 1;
+    b->last_chr = -1;
+    b->val_n = val_n;
+    b->rec_size = 8 + 8 * val_n;
+    b->rec_n = BGZF_DATA / b->rec_size;
+    b->thread_n = threads > 1 ? threads : 0;
+    b->ring_n = threads > 1 ? 4 * threads : 1;
+    if((b->ring = calloc(b->ring_n, sizeof(SitebinBlock_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < b->ring_n; i++) {
+        if((b->ring[i].in = malloc(BGZF_MAX)) == NULL || (b->ring[i].out = malloc(BGZF_MAX)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* the header block: magic, number of values, their names and the key */
+    for(i = 0; i < val_n; i++)
+        len += strlen(names[i]) + 1;
+    if(key != NULL)
+        len += strlen(key) + 1;
+    h.val_n = val_n;
+    h.names_n = (len + 7) / 8 * 8;
+    if(b->rec_n == 0 || sizeof(SitebinHead_s) + h.names_n > BGZF_DATA) {
+        fprintf(stderr, "\nERROR: Too many values per site for %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(h.magic, SITEBIN_MAGIC, 8);
+    memset(b->ring[0].in, 0, sizeof(SitebinHead_s) + h.names_n);
+    memcpy(b->ring[0].in, &h, sizeof(SitebinHead_s));
+    for(i = 0, len = sizeof(SitebinHead_s); i < val_n; i++) {
+        strcpy((char *)b->ring[0].in + len, names[i]);
+        len += strlen(names[i]) + 1;
+    }
+    if(key != NULL)
+        strcpy((char *)b->ring[0].in + len, key);
+    b->ring[0].out_n = bgzfDeflate(b->ring[0].in, sizeof(SitebinHead_s) + h.names_n, b->ring[0].out);
+    fwrite(b->ring[0].out, 1, b->ring[0].out_n, b->file);
+    b->coff = b->ring[0].out_n;
+
+    if(b->thread_n > 0) {
+        if((b->threads = malloc(b->thread_n * sizeof(pthread_t))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        pthread_mutex_init(&b->lock, NULL);
+        pthread_cond_init(&b->cond, NULL);
+        for(i = 0; i < b->thread_n; i++)
+            pthread_create(&b->threads[i], NULL, compressBlocks, b);
+    }
+
+    return b;
+}
+
+/* Adds a site. A new block is started for every chromosome, and the first site of each block is added to the index. */
+void sitebinAdd(Sitebin_s *b, const char *chr, int pos, const double *vals) {
+    int id = b->last_chr;
+    Seek_s *s = b->index;
+    SitebinBlock_s *block = &b->ring[b->fill_i % b->ring_n];
+
+    if(id < 0 || strcmp(s->chrs[id], chr) != 0) {
+        for(id = 0; id < s->chr_n && strcmp(s->chrs[id], chr) != 0; id++)
+            ;
+        if(id < s->chr_n)
+            b->sorted = 0; /* the chromosome was seen before */
+        else if((s->chrs = realloc(s->chrs, (s->chr_n + 1) * sizeof(char *))) == NULL || (s->chrs[s->chr_n++] = strdup(chr)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        if(block->in_n > 0) {
+            flushBlock(b);
+            block = &b->ring[b->fill_i % b->ring_n];
+        }
+        b->last_chr = id;
+    } else if(pos < b->last_pos)
+        b->sorted = 0;
+    b->last_pos = pos;
+
+    if(block->in_n == 0) {
+        /* off holds the block number until the compressed offsets are known */
+        if((s->n & (s->n - 1)) == 0 && (s->entries = realloc(s->entries, (s->n == 0 ? 1 : 2 * s->n) * sizeof(SeekEntry_s))) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        s->entries[s->n].chr = id;
+        s->entries[s->n].pos = pos;
+        s->entries[s->n].off = b->fill_i;
+        s->n++;
+    }
+    memcpy(block->in + block->in_n, &id, 4);
+    memcpy(block->in + block->in_n + 4, &pos, 4);
+    memcpy(block->in + block->in_n + 8, vals, 8 * b->val_n);
+    block->in_n += b->rec_size;
+    if(block->in_n == b->rec_n * b->rec_size)
+        flushBlock(b);
+}
+
+/* Opens a file written by sitebinCreate() and its index, if there is one. With threads > 1 blocks are inflated on that many worker threads. */
+Sitebin_s *sitebinOpen(const char *path, int threads) {
+    int i;
+    char *names = NULL;
+    SitebinHead_s h = {{0}};
+    Sitebin_s *b = NULL;
+
+    if((b = calloc(1, sizeof(Sitebin_s))) == NULL || (b->path = strdup(path)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if((b->file = bgzfOpen(path, threads)) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot open file %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if(fread(&h, sizeof(SitebinHead_s), 1, b->file) != 1 || memcmp(h.magic, SITEBIN_MAGIC, 8) != 0 || h.val_n < 1 || h.names_n < h.val_n) {
+        fprintf(stderr, "\nERROR: %s is not a per-site binary file written with -bin\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    b->val_n = h.val_n;
+    b->rec_size = 8 + 8 * h.val_n;
+    if((names = malloc(h.names_n + 1)) == NULL || (b->names = malloc(h.val_n * sizeof(char *))) == NULL || (b->rec = malloc(b->rec_size)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if(fread(names, 1, h.names_n, b->file) != h.names_n) {
+        fprintf(stderr, "\nERROR: %s is not a per-site binary file written with -bin\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    names[h.names_n] = '\0';
+    for(i = 0; i < b->val_n; i++) {
+        b->names[i] = names;
+        names += strlen(names) + 1;
+    }
+    b->key = names; /* the terminator or the padding without a key */
+    b->vals = (double *)(b->rec + 8);
+    b->reg_chr = -1;
+    b->index = seekOpen(path);
+
+    return b;
+}
+
+/* Restricts sitebinNext() to the sites of chr from start to end, moving to the block that contains start */
+void sitebinRegion(Sitebin_s *b, const char *chr, int start, int end) {
+    SeekEntry_s *e = NULL;
+
+    if(b->index == NULL || b->index->n == 0) {
+        fprintf(stderr, "\nERROR: %s has no index of sorted sites (%s.idx), regions cannot be read\n\n", b->path, b->path);
+        exit(EXIT_FAILURE);
+    }
+    b->reg_start = start;
+    b->reg_end = end;
+    if((b->reg_chr = seekChr(b->index, chr, strlen(chr))) < 0) {
+        b->reg_chr = -2; /* not in the file */
+        return;
+    }
+    e = seekEntry(b->index, b->reg_chr, start);
+    bgzfSeek(b->file, e->off);
+}
+
+/* Reads the next site (of the region). Returns 0 at the end of the file or region. */
+int sitebinNext(Sitebin_s *b) {
+    int chr = 0;
+
+    while(b->reg_chr != -2) {
+        if(fread(b->rec, b->rec_size, 1, b->file) != 1)
+            return 0;
+        memcpy(&chr, b->rec, 4);
+        memcpy(&b->pos, b->rec + 4, 4);
+        if(b->reg_chr >= 0) {
+            if(chr != b->reg_chr || b->pos > b->reg_end)
+                return 0;
+            if(b->pos < b->reg_start)
+                continue;
+        }
+        if(b->index != NULL && chr >= 0 && chr < b->index->chr_n)
+            b->chr = b->index->chrs[chr];
+        else {
+            sprintf(b->id, "%i", chr);
+            b->chr = b->id;
+        }
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Writes the last block, the end of file marker and the index, or closes a file opened for reading */
+void sitebinClose(Sitebin_s *b) {
+    int i;
+    long long n;
+    char *idx = NULL;
+    SitebinBlock_s *block = NULL;
+
+    if(b == NULL)
+        return;
+    if(b->write == 0) {
+        fclose(b->file);
+        seekFree(b->index);
+        if(b->names != NULL)
+            free(b->names[0]);
+        free(b->names);
+        free(b->rec);
+        free(b->path);
+        free(b);
+        return;
+    }
+
+    if(b->ring[b->fill_i % b->ring_n].in_n > 0)
+        flushBlock(b);
+    if(b->thread_n > 0) {
+        pthread_mutex_lock(&b->lock);
+        while(b->out_i < b->fill_i) {
+            block = &b->ring[b->out_i % b->ring_n];
+            if(block->state != 2) {
+                pthread_cond_wait(&b->cond, &b->lock);
+                continue;
+            }
+            pthread_mutex_unlock(&b->lock);
+            writeBlock(b, block);
+            pthread_mutex_lock(&b->lock);
+            block->state = 0;
+        }
+        b->quit = 1;
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+        for(i = 0; i < b->thread_n; i++)
+            pthread_join(b->threads[i], NULL);
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->cond);
+        free(b->threads);
+    }
+    block = &b->ring[0];
+    block->out_n = bgzfDeflate(NULL, 0, block->out);
+    fwrite(block->out, 1, block->out_n, b->file);
+    if(fclose(b->file) != 0) {
+        fprintf(stderr, "\nERROR: Cannot write file %s\n\n", b->path);
+        exit(EXIT_FAILURE);
+    }
+
+    for(n = 0; n < b->index->n; n++)
+        b->index->entries[n].off = b->offs[b->index->entries[n].off] << 16;
+    if(b->sorted == 0) {
+        fprintf(stderr, "Warning: sites in %s are not sorted by position within chromosomes, regions cannot be read from it\n", b->path);
+        b->index->n = 0;
+    }
+    if((idx = malloc(strlen(b->path) + 5)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    sprintf(idx, "%s.idx", b->path);
+    seekWrite(b->index, idx);
+
+    for(i = 0; i < b->ring_n; i++) {
+        free(b->ring[i].in);
+        free(b->ring[i].out);
+    }
+    free(b->ring);
+    free(b->offs);
+    free(idx);
+    free(b->path);
+    seekFree(b->index);
+    free(b);
+}
+
+/* Hands the filled block to the workers, or compresses it without threads. Compressed blocks are written in order until the next block to fill is free. */
+static void flushBlock(Sitebin_s *b) {
+    SitebinBlock_s *block = &b->ring[b->fill_i % b->ring_n], *next = NULL;
+
+    if(b->thread_n == 0) {
+        block->out_n = bgzfDeflate(block->in, block->in_n, block->out);
+        b->fill_i++;
+        writeBlock(b, block);
+        return;
+    }
+    pthread_mutex_lock(&b->lock);
+    block->state = 1;
+    b->fill_i++;
+    pthread_cond_broadcast(&b->cond);
+    while(1) {
+        next = &b->ring[b->out_i % b->ring_n];
+        if(b->out_i < b->fill_i && next->state == 2) {
+            pthread_mutex_unlock(&b->lock);
+            writeBlock(b, next);
+            pthread_mutex_lock(&b->lock);
+            next->state = 0;
+            continue;
+        }
+        if(b->ring[b->fill_i % b->ring_n].state == 0)
+            break;
+        pthread_cond_wait(&b->cond, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void writeBlock(Sitebin_s *b, SitebinBlock_s *block) {
+    if(fwrite(block->out, 1, block->out_n, b->file) != block->out_n) {
+        fprintf(stderr, "\nERROR: Cannot write file %s\n\n", b->path);
+        exit(EXIT_FAILURE);
+    }
+    if((b->out_i & (b->out_i - 1)) == 0 && (b->offs = realloc(b->offs, (b->out_i == 0 ? 1 : 2 * b->out_i) * sizeof(long long))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    b->offs[b->out_i++] = b->coff;
+    b->coff += block->out_n;
+    block->in_n = 0;
+}
+
+/* Workers compress the filled blocks in turn */
+static void *compressBlocks(void *arg) {
+    Sitebin_s *b = arg;
+    SitebinBlock_s *block = NULL;
+
+    pthread_mutex_lock(&b->lock);
+    while(1) {
+        if(b->comp_i < b->fill_i) {
+            block = &b->ring[b->comp_i % b->ring_n];
+            b->comp_i++;
+            pthread_mutex_unlock(&b->lock);
+            block->out_n = bgzfDeflate(block->in, block->in_n, block->out);
+            pthread_mutex_lock(&b->lock);
+            block->state = 2;
+            pthread_cond_broadcast(&b->cond);
+            continue;
+        }
+        if(b->quit)
+            break;
+        pthread_cond_wait(&b->cond, &b->lock);
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    return NULL;
+}
+
+/* Key of a cache written by prog: settings and the path, size and modification time of the input, so that a changed input is not read from an old cache */
+char *sitebinKey(const char *prog, const char *input, const char *settings) {
+    char *key = NULL;
+    struct stat st;
+
+    if(stat(input, &st) != 0) {
+        fprintf(stderr, "\nERROR: Cannot open file %s\n\n", input);
+        exit(EXIT_FAILURE);
+    }
+    if((key = malloc(strlen(prog) + strlen(input) + strlen(settings) + 64)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    sprintf(key, "%s\t%s\t%lli\t%lli\t%s", prog, input, (long long)st.st_size, (long long)st.st_mtime, settings);
+
+    return key;
+}
+
+/* Opens the cache at path if it exists and was written with the same key. Returns NULL if the cache has to be written. */
+Sitebin_s *sitebinCache(const char *path, const char *key, int threads) {
+    FILE *file = NULL;
+    Sitebin_s *b = NULL;
+
+    if((file = fopen(path, "rb")) == NULL)
+        return NULL;
+    fclose(file);
+    b = sitebinOpen(path, threads);
+    if(strcmp(b->key, key) == 0) {
+        fprintf(stderr, "Reading per-site values from cache %s\n", path);
+        return b;
+    }
+    fprintf(stderr, "Warning: cache %s was written for another input or settings and is written again\n", path);
+    sitebinClose(b);
+
+    return NULL;
+}
@@ -0,0 +1,90 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Per-site results as BGZF compressed binary records (probs2fst and probs2pi -bin), read back with sitebinOpen() or sitebin2txt.
+ The file starts with a header block (SitebinHead_s, the NUL separated names of the values and an optional key), followed by blocks of fixed size records:
+ chromosome id, position and val_n doubles. A block holds sites of one chromosome only, and blocks are compressed on worker threads and written in order.
+ The chromosome names and the position of the first site of every block are written to <file>.idx in the format of seek.h,
+ so a region can be read without inflating the rest of the file. If the sites were not sorted by position within contiguous chromosomes the index lists only the names.
+
+ A file written with a key (sitebinKey(): program, input file and settings) is a cache of per-site values (-cache). sitebinCache() opens it only if the key matches,
+ so a rerun with the same input and settings reads the sites from the cache instead of parsing the input again.
+
+ Typical use:
+    w = sitebinCreate(path, names, val_n, key, threads); (key NULL without a cache)
+    sitebinAdd(w, chr, pos, vals); (once per site)
+    sitebinClose(w);
+
+    r = sitebinOpen(path, threads); (threads inflating the blocks)
+    sitebinRegion(r, chr, start, end); (optional)
+    while(sitebinNext(r))
+        ...use r->chr, r->pos and r->vals[0] ... r->vals[r->val_n - 1]...
+    sitebinClose(r);
+*/
+
+#ifndef SITEBIN_H
+#define SITEBIN_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include "seek.h"
+
+#define SITEBIN_MAGIC "BGLSITE1"
+
+typedef struct {
+    char magic[8];
+    int val_n, names_n; /* values per site and bytes of their names and the key, padded to 8 */
+} SitebinHead_s;
+
+typedef struct {
+    int state; /* 0 free, 1 filled, 2 compressed */
+    unsigned int in_n, out_n;
+    unsigned char *in, *out;
+} SitebinBlock_s;
+
+typedef struct {
+    FILE *file;
+    char *path;
+    int val_n, rec_size, rec_n; /* values per site, bytes per record and records per block */
+    char **names, *key;         /* names of the values and the key of a cache ("" if none) */
+    Seek_s *index;
+    /* writing */
+    int write, sorted, last_chr, last_pos, thread_n, quit;
+    long long coff, *offs;     /* compressed offset of the next block and of every written block */
+    long fill_i, comp_i, out_i; /* block being filled, next to compress and next to write */
+    int ring_n;
+    SitebinBlock_s *ring;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    /* reading */
+    unsigned char *rec;
+    char *chr, id[16];         /* current site, chr is an id if the file has no index */
+    int pos, reg_chr, reg_start, reg_end;
+    double *vals;
+} Sitebin_s;
+
+Sitebin_s *sitebinCreate(const char *path, char **names, int val_n, const char *key, int threads);
+void sitebinAdd(Sitebin_s *b, const char *chr, int pos, const double *vals);
+Sitebin_s *sitebinOpen(const char *path, int threads);
+void sitebinRegion(Sitebin_s *b, const char *chr, int start, int end);
+int sitebinNext(Sitebin_s *b);
+void sitebinClose(Sitebin_s *b);
+char *sitebinKey(const char *prog, const char *input, const char *settings);
+Sitebin_s *sitebinCache(const char *path, const char *key, int threads);
+
+#endif
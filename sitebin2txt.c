@@ -0,0 +1,187 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Program for printing the per-site binary output of probs2fst and probs2pi (-bin) as text, either the whole file or single regions.
+ Regions are read through the block index (file.idx) without inflating the rest of the file.
+
+ Compiling: gcc sitebin2txt.c bgzf.c seek.c sitebin.c writer.c -o sitebin2txt -lm -lz -lpthread
+
+ Usage:
+ -bin [file] Per-site binary output written with -bin.
+ -region [chr:start-end] Print only the sites of a region (1-based, inclusive). Can be used >= 1 times, regions are printed in the given order. Requires file.idx. Optional.
+ -threads [int] Number of threads used for inflating the binary file. Default 1.
+
+ Example:
+ ./sitebin2txt -bin sites.bin > sites.txt
+ ./sitebin2txt -bin sites.bin -region scaffold_1:10000-20000 -region scaffold_2:1-5000 > regions.txt
+*/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sitebin.h"
+#include "writer.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+typedef struct {
+    char *chr;
+    int start, end;
+} Region_s;
+
+void openFiles(int argc, char *argv[]);
+void printSites(Sitebin_s *b, Writer_s *out);
+Region_s readRegion(char *str);
+int isNumeric(const char *s);
+
+int main(int argc, char *argv[]) {
+    int second = 0, minute = 0, hour = 0;
+    time_t timer = 0;
+
+    timer = time(NULL);
+    openFiles(argc, argv);
+    second = time(NULL) - timer;
+    minute = second / 60;
+    hour = second / 3600;
+
+    fprintf(stderr, "\nDone!");
+    if(hour > 0)
+        fprintf(stderr, "\nElapsed time: %i h, %i min & %i sec\n\n", hour, minute - hour * 60, second - minute * 60);
+    else if(minute > 0)
+        fprintf(stderr, "\nElapset time: %i min & %i sec\n\n", minute, second - minute * 60);
+    else if(second > 5)
+        fprintf(stderr, "\nElapsed time: %i sec\n\n", second);
+    else
+        fprintf(stderr, "\n\n");
+
+    return 0;
+}
+
+void openFiles(int argc, char *argv[]) {
+    int i, region_n = 0, threads = 1;
+    char *path = NULL;
+    Region_s *regions = NULL;
+    Sitebin_s *b = NULL;
+    Writer_s *out = NULL;
+
+    fprintf(stderr, "\nParameters:\n");
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-bin") == 0) {
+            path = argv[++i];
+            fprintf(stderr, "\t-bin %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-region") == 0) {
+            if((regions = realloc(regions, (region_n + 1) * sizeof(Region_s))) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+            regions[region_n++] = readRegion(argv[++i]);
+            fprintf(stderr, "\t-region %s\n", argv[i]);
+        }
+
+        else if(strcmp(argv[i], "-threads") == 0) {
+            if(isNumeric(argv[++i]))
+                threads = atoi(argv[i]);
+            fprintf(stderr, "\t-threads %s\n", argv[i]);
+        }
+
+        else {
+            fprintf(stderr, "\nERROR: Unknown argument '%s'\n\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(stderr, "\n");
+
+    if(path == NULL) {
+        fprintf(stderr, "\nERROR: -bin [file] is required!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    b = sitebinOpen(path, threads);
+    out = writerOpen(stdout);
+    writerStr(out, "chr\tbp");
+    for(i = 0; i < b->val_n; i++) {
+        writerChar(out, '\t');
+        writerStr(out, b->names[i]);
+    }
+    writerChar(out, '\n');
+    if(region_n == 0)
+        printSites(b, out);
+    for(i = 0; i < region_n; i++) {
+        sitebinRegion(b, regions[i].chr, regions[i].start, regions[i].end);
+        printSites(b, out);
+    }
+    writerClose(out);
+    sitebinClose(b);
+    for(i = 0; i < region_n; i++)
+        free(regions[i].chr);
+    free(regions);
+}
+
+/* Prints the sites left in the file or region */
+void printSites(Sitebin_s *b, Writer_s *out) {
+    int i;
+
+    while(sitebinNext(b)) {
+        writerStr(out, b->chr);
+        writerChar(out, '\t');
+        writerInt(out, b->pos);
+        for(i = 0; i < b->val_n; i++) {
+            writerChar(out, '\t');
+            if(isnan(b->vals[i]))
+                writerStr(out, "nan");
+            else
+                writerFloat(out, b->vals[i], 6);
+        }
+        writerChar(out, '\n');
+    }
+}
+
+/* Splits chr:start-end. The name is split at the last colon, so it may contain colons itself. */
+Region_s readRegion(char *str) {
+    char *colon = NULL, *dash = NULL;
+    Region_s r = {0};
+
+    if((colon = strrchr(str, ':')) == NULL || (dash = strchr(colon, '-')) == NULL || colon == str) {
+        fprintf(stderr, "\nERROR: -region must be given as chr:start-end, not '%s'\n\n", str);
+        exit(EXIT_FAILURE);
+    }
+    if((r.chr = malloc(colon - str + 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(r.chr, str, colon - str);
+    r.chr[colon - str] = '\0';
+    r.start = atoi(colon + 1);
+    r.end = atoi(dash + 1);
+
+    return r;
+}
+
+int isNumeric(const char *s) {
+    char *p;
+
+    if(s == NULL || *s == '\0' || isspace(*s))
+        return 0;
+    strtod(s, &p);
+    return *p == '\0';
+}
@@ -0,0 +1,129 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Phase timing, progress and JSON summary of -stats. See stats.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+static const char *phases[STATS_PHASES] = {"load", "match", "read", "parse", "overlap", "compute", "output", "wait"};
+
+double statsNow(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Opens the JSON summary file. Time from start to the first statsPhase() is counted as loading. */
+Stats_s *statsOpen(const char *path, const char *prog, double start) {
+    Stats_s *s = NULL;
+
+    if((s = calloc(1, sizeof(Stats_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if((s->file = fopen(path, "w")) == NULL) {
+        fprintf(stderr, "\nERROR: Cannot create file %s\n\n", path);
+        exit(EXIT_FAILURE);
+    }
+    s->prog = prog;
+    s->threads = 1;
+    s->phase = STATS_LOAD;
+    s->start = start;
+    s->mark = start;
+    s->last = start;
+    s->next = STATS_TICK;
+
+    return s;
+}
+
+/* Starts timing a thread-local Stats_s */
+void statsInit(Stats_s *s) {
+    memset(s, 0, sizeof(Stats_s));
+    s->phase = STATS_PARSE;
+    s->mark = statsNow();
+}
+
+/* Adds the time since the last switch to the current phase and moves to the next one */
+void statsPhase(Stats_s *s, int phase) {
+    double now = 0;
+
+    if(s == NULL)
+        return;
+    now = statsNow();
+    s->time[s->phase] += now - s->mark;
+    s->mark = now;
+    s->phase = phase;
+}
+
+/* Adds the phase times of a worker to s. The worker should end its current phase with statsPhase() first. Not thread-safe, call with a lock held or after joining the worker. */
+void statsMerge(Stats_s *s, Stats_s *part) {
+    int i;
+
+    if(s == NULL || part == NULL)
+        return;
+    for(i = 0; i < STATS_PHASES; i++)
+        s->time[i] += part->time[i];
+}
+
+/* Prints the current site and the rate since the last line every STATS_INTERVAL seconds. The clock is only read every STATS_TICK sites. */
+void statsProgress(Stats_s *s, const char *chr, int pos, long long parsed, long long bytes) {
+    double now = 0;
+
+    if(s == NULL || parsed < s->next)
+        return;
+    s->next = parsed + STATS_TICK;
+    now = statsNow();
+    if(now - s->last < STATS_INTERVAL)
+        return;
+    fprintf(stderr, "Progress: %s:%i, %lli sites (%.1f MB) at %.0f sites/sec\n", chr, pos, parsed, bytes / 1e6, (parsed - s->last_parsed) / (now - s->last));
+    s->last = now;
+    s->last_parsed = parsed;
+}
+
+/* Writes the JSON summary and frees s */
+void statsClose(Stats_s *s) {
+    int i;
+    double wall = 0;
+
+    if(s == NULL)
+        return;
+    statsPhase(s, s->phase);
+    wall = s->mark - s->start;
+    if(wall <= 0)
+        wall = 1e-9;
+    s->filtered = s->parsed - s->outside - s->kept;
+
+    fprintf(s->file, "{\n  \"program\": \"%s\",\n  \"threads\": %i,\n  \"wall_sec\": %.6f,\n  \"phase_sec\": {", s->prog, s->threads, wall);
+    for(i = 0; i < STATS_PHASES; i++)
+        fprintf(s->file, "%s\"%s\": %.6f", i > 0 ? ", " : "", phases[i], s->time[i]);
+    fprintf(s->file, "},\n  \"bytes_read\": %lli,\n  \"sites_parsed\": %lli,\n  \"sites_outside\": %lli,\n  \"sites_filtered\": %lli,\n  \"sites_kept\": %lli,\n", s->bytes, s->parsed, s->outside, s->filtered, s->kept);
+    fprintf(s->file, "  \"sites_per_sec\": %.1f,\n  \"mb_per_sec\": %.3f\n}\n", s->parsed / wall, s->bytes / 1e6 / wall);
+
+    if(fclose(s->file) != 0) {
+        fprintf(stderr, "\nERROR: Cannot write the -stats file\n\n");
+        exit(EXIT_FAILURE);
+    }
+    free(s);
+}
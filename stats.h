@@ -0,0 +1,61 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Run statistics for -stats: time spent in each phase of a run, site counters, a periodic progress line on stderr and a JSON summary written at the end.
+ Phases are timed with the monotonic clock by switching the current phase with statsPhase(). All functions do nothing when given NULL, so callers can leave the calls in place when -stats is not used.
+
+ Typical use:
+    s = statsOpen(path, "probs2fst", statsNow());
+    statsPhase(s, STATS_PARSE);
+    ...parse a site...
+    statsProgress(s, chr, pos, site_i, bytes);
+    statsPhase(s, STATS_COMPUTE);
+    ...
+    s->parsed = site_i; s->outside = outside_i; s->kept = kept_i; s->bytes = bytes;
+    statsClose(s);
+
+ Worker threads time their own phases in a Stats_s of their own (statsInit()) and add it to the shared one with statsMerge(), so with threads the phase times are summed thread times.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#define STATS_TICK 65536    /* sites between checks of the clock for progress */
+#define STATS_INTERVAL 10.0 /* seconds between progress lines */
+
+/* read is the time spent waiting for input (fread), and wait the time threads spend waiting for each other */
+enum { STATS_LOAD, STATS_MATCH, STATS_READ, STATS_PARSE, STATS_OVERLAP, STATS_COMPUTE, STATS_OUTPUT, STATS_WAIT, STATS_PHASES };
+
+typedef struct {
+    FILE *file; /* JSON summary */
+    const char *prog;
+    int phase, threads;
+    double start, mark, last, time[STATS_PHASES];
+    long long bytes, parsed, outside, filtered, kept; /* bytes of (inflated) input, sites read, outside the genes, failing the filters (set by statsClose()) and kept */
+    long long next, last_parsed;
+} Stats_s;
+
+double statsNow(void);
+Stats_s *statsOpen(const char *path, const char *prog, double start);
+void statsInit(Stats_s *s);
+void statsPhase(Stats_s *s, int phase);
+void statsMerge(Stats_s *s, Stats_s *part);
+void statsProgress(Stats_s *s, const char *chr, int pos, long long parsed, long long bytes);
+void statsClose(Stats_s *s);
+
+#endif
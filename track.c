@@ -0,0 +1,428 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Outgroup-state track compiled from MUMmer alignments. See track.h.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "interval.h"
+#include "lines.h"
+#include "track.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+typedef struct {
+    int chr, out, start, stop;
+} Align_s;
+
+static void setState(unsigned char *plane, long long pos, int state);
+static void indexNames(Track_s *t);
+static int streamState(Track_s *t, int chr, int out, int pos);
+static int streamChr(Track_s *t, TrackLine_s *l, int chr);
+static void streamSkip(Track_s *t, TrackLine_s *l, int id);
+static void streamNext(TrackLine_s *l);
+static int divState(char base);
+
+/* Compiles the coords and snps files of out_n outgroups into a track held in memory. The files are read once and closed. */
+Track_s *trackBuild(FILE **coords, FILE **divs, int out_n) {
+    int i, o, n = 0, size = 0, chr, state, pos;
+    long long off = 0, p, *len = NULL;
+    char *line = NULL, *fields[9], *temp = NULL;
+    unsigned char *plane = NULL;
+    Align_s *aligns = NULL;
+    Lines_s *lines = NULL;
+    Track_s *t = NULL;
+    Index_s *names = NULL;
+
+    /* alignments of every outgroup, which also give the chromosome names and lengths */
+    names = indexInit();
+    for(o = 0; o < out_n; o++) {
+        lines = linesOpen(coords[o]);
+        while((line = linesNext(lines)) != NULL) {
+            if(linesSplit(line, fields, 8) == 8 && isdigit(fields[0][0])) {
+                aligns = linesGrow(aligns, n, &size, sizeof(Align_s));
+                aligns[n].chr = indexChr(names, fields[7]);
+                aligns[n].out = o;
+                aligns[n].start = atoi(fields[0]);
+                aligns[n].stop = atoi(fields[1]);
+                n++;
+            }
+        }
+        linesClose(lines);
+    }
+
+    if((len = calloc(names->chr_n + 1, sizeof(long long))) == NULL || (t = calloc(1, sizeof(Track_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    for(i = 0; i < n; i++) {
+        if(aligns[i].stop > len[aligns[i].chr])
+            len[aligns[i].chr] = aligns[i].stop;
+    }
+
+    t->map_size = sizeof(TrackHead_s);
+    for(i = 0; i < names->chr_n; i++)
+        t->map_size += strlen(names->chrs[i]) + 1;
+    t->map_size += (8 - t->map_size % 8) % 8;
+    t->map_size += names->chr_n * sizeof(TrackChr_s);
+    off = t->map_size;
+    for(i = 0; i < names->chr_n; i++)
+        t->map_size += out_n * ((len[i] + 1) / 2);
+    if((t->map = calloc(t->map_size, 1)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+
+    t->head = (TrackHead_s *)t->map;
+    memcpy(t->head->magic, TRACK_MAGIC, 8);
+    t->head->out_n = out_n;
+    t->head->chr_n = names->chr_n;
+    t->head->names_off = sizeof(TrackHead_s);
+    temp = (char *)t->map + t->head->names_off;
+    for(i = 0; i < names->chr_n; i++) {
+        strcpy(temp, names->chrs[i]);
+        temp += strlen(temp) + 1;
+    }
+    t->head->chrs_off = off - names->chr_n * sizeof(TrackChr_s);
+    t->head->data_off = off;
+    t->chrs = (TrackChr_s *)(t->map + t->head->chrs_off);
+    for(i = 0; i < names->chr_n; i++) {
+        t->chrs[i].len = len[i];
+        t->chrs[i].off = off;
+        off += out_n * ((len[i] + 1) / 2);
+    }
+    t->names = names;
+
+    /* aligned bases */
+    for(i = 0; i < n; i++) {
+        chr = aligns[i].chr;
+        plane = t->map + t->chrs[chr].off + aligns[i].out * ((t->chrs[chr].len + 1) / 2);
+        for(p = aligns[i].start > 1 ? aligns[i].start : 1; p <= aligns[i].stop; p++)
+            setState(plane, p, TRACK_REF);
+    }
+    free(aligns);
+
+    /* substitutions in aligned bases, the first line of a position is used */
+    for(o = 0; o < out_n; o++) {
+        lines = linesOpen(divs[o]);
+        while((line = linesNext(lines)) != NULL) {
+            if(linesSplit(line, fields, 9) < 9 || !isdigit(fields[0][0]))
+                continue;
+            pos = atoi(fields[0]);
+            if((chr = indexGetChr(names, fields[8])) < 0 || pos < 1 || pos > t->chrs[chr].len || trackState(t, chr, o, pos) != TRACK_REF)
+                continue;
+            state = divState(fields[2][0]);
+            setState(t->map + t->chrs[chr].off + o * ((t->chrs[chr].len + 1) / 2), pos, state);
+        }
+        linesClose(lines);
+    }
+    free(len);
+
+    return t;
+}
+
+/* Opens a track that reads the coords and snps files of out_n outgroups only as far as the lookups need. The files are closed by trackClose(). */
+Track_s *trackStream(FILE **coords, FILE **divs, int out_n) {
+    int o;
+    Track_s *t = NULL;
+
+    if((t = calloc(1, sizeof(Track_s))) == NULL || (t->coords = calloc(out_n, sizeof(TrackLine_s))) == NULL || (t->divs = calloc(out_n, sizeof(TrackLine_s))) == NULL ||
+       (t->cover = calloc(out_n, sizeof(int))) == NULL || (t->cover_chr = malloc(out_n * sizeof(int))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    t->stream = out_n;
+    t->names = indexInit();
+    t->passed = indexInit();
+    t->last_chr = -1;
+    for(o = 0; o < out_n; o++) {
+        t->coords[o].lines = linesOpen(coords[o]);
+        t->coords[o].out = o;
+        t->coords[o].last = -1;
+        t->divs[o].lines = linesOpen(divs[o]);
+        t->divs[o].out = o;
+        t->divs[o].div = 1;
+        t->divs[o].last = -1;
+        t->cover_chr[o] = -1;
+        streamNext(&t->coords[o]);
+        streamNext(&t->divs[o]);
+    }
+
+    return t;
+}
+
+/* Maps a track written with trackWrite() */
+Track_s *trackOpen(FILE *file) {
+    struct stat st;
+    Track_s *t = NULL;
+
+    if((t = calloc(1, sizeof(Track_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    if(fstat(fileno(file), &st) != 0 || (t->map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(file), 0)) == MAP_FAILED) {
+        fprintf(stderr, "\nERROR: Cannot map the outgroup track (needs to be a regular file)\n\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(file);
+    t->mapped = 1;
+    t->map_size = st.st_size;
+    t->head = (TrackHead_s *)t->map;
+    if(t->map_size < sizeof(TrackHead_s) || memcmp(t->head->magic, TRACK_MAGIC, 8) != 0 || (size_t)t->head->data_off > t->map_size) {
+        fprintf(stderr, "\nERROR: Not an outgroup track or the file is truncated\n\n");
+        exit(EXIT_FAILURE);
+    }
+    t->chrs = (TrackChr_s *)(t->map + t->head->chrs_off);
+    indexNames(t);
+
+    return t;
+}
+
+void trackWrite(Track_s *t, FILE *file) {
+    if(fwrite(t->map, 1, t->map_size, file) != t->map_size || fclose(file) != 0) {
+        fprintf(stderr, "\nERROR: Cannot write the outgroup track\n\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Id of a chromosome in the track, -1 if none of the outgroups aligned to it. A streamed track gives every new chromosome the next id. */
+int trackChr(Track_s *t, const char *chr) {
+    if(t->stream) {
+        if(indexGetChr(t->passed, chr) >= 0) {
+            fprintf(stderr, "\nERROR: The MUMmer files were read past chromosome %s before the Beagle files reached it. -stream requires the Beagle files to list chromosomes in the order of the MUMmer files "
+                            "(index the Beagle files with beagle2idx if an outgroup lacks chromosomes)\n\n", chr);
+            exit(EXIT_FAILURE);
+        }
+        return indexChr(t->names, chr);
+    }
+    return indexGetChr(t->names, chr);
+}
+
+int trackState(Track_s *t, int chr, int out, int pos) {
+    unsigned char b;
+
+    if(t->stream)
+        return streamState(t, chr, out, pos);
+    if(chr < 0 || pos < 1 || pos > t->chrs[chr].len)
+        return TRACK_NONE;
+    b = t->map[t->chrs[chr].off + out * ((t->chrs[chr].len + 1) / 2) + (pos - 1) / 2];
+
+    return (pos - 1) & 1 ? b >> 4 : b & 15;
+}
+
+/* Outgroup base at a site, ref for aligned bases without a substitution and N for missing information */
+char trackBase(Track_s *t, int chr, int out, int pos, char ref) {
+    return trackStateBase(trackState(t, chr, out, pos), ref);
+}
+
+/* Outgroup base of a state from trackState() */
+char trackStateBase(int state, char ref) {
+    switch(state) {
+        case TRACK_REF:
+            return ref;
+        case TRACK_A:
+            return 'A';
+        case TRACK_C:
+            return 'C';
+        case TRACK_G:
+            return 'G';
+        case TRACK_T:
+            return 'T';
+        default:
+            return 'N';
+    }
+}
+
+void trackClose(Track_s *t) {
+    int o, warned = 0;
+    TrackLine_s *l = NULL;
+
+    for(o = 0; o < 2 * t->stream; o++) {
+        l = o < t->stream ? &t->coords[o] : &t->divs[o - t->stream];
+        while(l->missed && l->chr != NULL) { /* a chromosome without lines could still have them further on */
+            streamSkip(t, l, indexGetChr(t->names, l->chr));
+            streamNext(l);
+        }
+        if(l->chr != NULL && indexGetChr(t->names, l->chr) < 0 && warned++ == 0)
+            fprintf(stderr, "Warning: The %s file of outgroup %i was not read from chromosome %s on, which the Beagle files do not have (with -stream they need to list chromosomes in the order of the MUMmer files)\n",
+                    l->div ? "snps" : "coords", l->out + 1, l->chr);
+        linesClose(l->lines);
+        free(l->chr);
+    }
+    if(t->stream) {
+        free(t->coords);
+        free(t->divs);
+        free(t->cover);
+        free(t->cover_chr);
+        free(t->looked);
+        indexFree(t->passed);
+    }
+    if(t->mapped)
+        munmap(t->map, t->map_size);
+    else
+        free(t->map);
+    indexFree(t->names);
+    free(t);
+}
+
+static void setState(unsigned char *plane, long long pos, int state) {
+    unsigned char *b = plane + (pos - 1) / 2;
+
+    if((pos - 1) & 1)
+        *b = (*b & 15) | (state << 4);
+    else
+        *b = (*b & 0xf0) | state;
+}
+
+/* Interns the chromosome names of a mapped track, so ids follow the file order */
+static void indexNames(Track_s *t) {
+    int i;
+    char *temp = (char *)t->map + t->head->names_off;
+
+    t->names = indexInit();
+    for(i = 0; i < t->head->chr_n; i++) {
+        indexChr(t->names, temp);
+        temp += strlen(temp) + 1;
+    }
+}
+
+/* Alignment state of a streamed track: covered if an alignment read so far reaches pos, with the state of the first snps line of pos */
+static int streamState(Track_s *t, int chr, int out, int pos) {
+    TrackLine_s *c = &t->coords[out], *d = &t->divs[out];
+
+    if(chr < t->last_chr || (chr == t->last_chr && pos < t->last_pos)) {
+        fprintf(stderr, "\nERROR: -stream requires the Beagle files to be sorted by position within chromosomes, and each chromosome listed once\n\n");
+        exit(EXIT_FAILURE);
+    }
+    if(chr >= t->looked_n) {
+        if((t->looked = realloc(t->looked, t->names->chr_n)) == NULL) {
+            fprintf(stderr, merror);
+            exit(EXIT_FAILURE);
+        }
+        memset(t->looked + t->looked_n, 0, t->names->chr_n - t->looked_n);
+        t->looked_n = t->names->chr_n;
+    }
+    t->looked[chr] = 1;
+    t->last_chr = chr;
+    t->last_pos = pos;
+    if(t->cover_chr[out] != chr) {
+        t->cover_chr[out] = chr;
+        t->cover[out] = 0;
+    }
+    while(streamChr(t, c, chr) && c->pos <= pos) {
+        if(c->stop > t->cover[out])
+            t->cover[out] = c->stop;
+        streamNext(c);
+    }
+    if(pos < 1 || t->cover[out] < pos)
+        return TRACK_NONE;
+    while(streamChr(t, d, chr) && d->pos < pos)
+        streamNext(d);
+    if(streamChr(t, d, chr) && d->pos == pos)
+        return d->state;
+
+    return TRACK_REF;
+}
+
+/* Skips the lines of chromosomes before chr. Returns 1 if the next line is on chr.
+   Chromosomes without an id are taken to come before chr until the lines reach it, and after it once they have. */
+static int streamChr(Track_s *t, TrackLine_s *l, int chr) {
+    int id;
+
+    while(l->chr != NULL) {
+        if((id = indexGetChr(t->names, l->chr)) == chr) {
+            l->last = chr;
+            return 1;
+        }
+        if(id > chr || (id < 0 && l->last == chr))
+            break; /* a later chromosome */
+        streamSkip(t, l, id);
+        streamNext(l);
+    }
+    if(l->last != chr)
+        l->missed = 1;
+
+    return 0;
+}
+
+/* Checks that the line being skipped is not on a chromosome already looked up without finding it, and remembers chromosomes without an id */
+static void streamSkip(Track_s *t, TrackLine_s *l, int id) {
+    if(id < 0)
+        indexChr(t->passed, l->chr);
+    else if(id != l->last && id < t->looked_n && t->looked[id]) {
+        fprintf(stderr, "\nERROR: The %s file of outgroup %i lists chromosome %s after chromosomes that come after it in the Beagle files. -stream requires the Beagle files to list chromosomes in the order of the MUMmer files\n\n",
+                l->div ? "snps" : "coords", l->out + 1, l->chr);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Reads the next alignment or substitution of a file */
+static void streamNext(TrackLine_s *l) {
+    int n, pos;
+    char *line = NULL, *fields[9], *chr = NULL;
+
+    while((line = linesNext(l->lines)) != NULL) {
+        n = linesSplit(line, fields, l->div ? 9 : 8);
+        if(!isdigit(fields[0][0]) || (l->div && n < 9) || (l->div == 0 && n != 8))
+            continue;
+        chr = fields[l->div ? 8 : 7];
+        pos = atoi(fields[0]);
+        if(l->chr != NULL && strcmp(l->chr, chr) == 0) {
+            if(pos < l->pos) {
+                fprintf(stderr, "\nERROR: The %s file of outgroup %i is not sorted by reference position (%s -r), which -stream requires\n\n", l->div ? "snps" : "coords", l->out + 1, l->div ? "show-snps" : "show-coords");
+                exit(EXIT_FAILURE);
+            }
+        } else {
+            if((int)strlen(chr) >= l->chr_size) {
+                l->chr_size = 2 * strlen(chr) + 1;
+                if((l->chr = realloc(l->chr, l->chr_size)) == NULL) {
+                    fprintf(stderr, merror);
+                    exit(EXIT_FAILURE);
+                }
+            }
+            strcpy(l->chr, chr);
+        }
+        l->pos = pos;
+        if(l->div)
+            l->state = divState(fields[2][0]);
+        else
+            l->stop = atoi(fields[1]);
+        return;
+    }
+    free(l->chr);
+    l->chr = NULL;
+}
+
+/* State of the outgroup base of a snps line */
+static int divState(char base) {
+    switch(toupper(base)) {
+        case 'A':
+            return TRACK_A;
+        case 'C':
+            return TRACK_C;
+        case 'G':
+            return TRACK_G;
+        case 'T':
+            return TRACK_T;
+        default:
+            return TRACK_N;
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Outgroup-state track compiled from MUMmer alignments (show-coords -T -H and show-snps -C -H -T of each outgroup).
+ Every base of every reference chromosome has a 4-bit state per outgroup, so the outgroup base of a site is found by direct indexing.
+ The track can be built in memory from the coords/snps files or written once and mapped with trackOpen(); both have the same layout:
+ header, chromosome names, one TrackChr_s per chromosome and a packed plane of states (two bases per byte) per chromosome and outgroup.
+
+ A streamed track (trackStream()) holds no planes: the coords and snps files are read forward in step with the lookups, keeping only the next line of every file
+ and the furthest aligned base of each outgroup, so memory does not grow with the alignments and nothing is read before the first lookup.
+ The lookups then have to come in order of position within chromosomes, and the chromosomes in the order of the MUMmer files (both sorted by reference position, show-coords -r and show-snps -r).
+ Chromosome ids are given by trackChr() in the order of the lookups, or in the order it is first called for them (for example with the chromosomes of a Beagle .idx).
+ Lines of chromosomes without an id are skipped; looking such a chromosome up later, or finding lines of a chromosome after its lookup found none, is an error rather than missing data.
+ A chromosome missing from the files of an outgroup has no aligned bases in it.
+
+ Typical use:
+    t = trackBuild(coords, divs, 3); or t = trackOpen(file); or t = trackStream(coords, divs, 3);
+    c = trackChr(t, chr);
+    base = trackBase(t, c, outgroup, pos, ref);
+    trackClose(t);
+*/
+
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdio.h>
+#include "interval.h"
+#include "lines.h"
+
+#define TRACK_MAGIC "OUTTRK01"
+
+/* States of a base: not aligned, aligned without a substitution (the outgroup has the reference base), substitution to A, C, G or T, and aligned to a gap or an ambiguous base */
+enum {TRACK_NONE, TRACK_REF, TRACK_A, TRACK_C, TRACK_G, TRACK_T, TRACK_N};
+
+typedef struct {
+    char magic[8];
+    int out_n, chr_n;
+    long long names_off, chrs_off, data_off;
+} TrackHead_s;
+
+typedef struct {
+    long long len, off; /* last covered position and offset of the plane of outgroup 0, the plane of outgroup o starts at off + o * ((len + 1) / 2) */
+} TrackChr_s;
+
+/* Next line of a coords or snps file of a streamed track */
+typedef struct {
+    Lines_s *lines;
+    int out, div;             /* outgroup of the file and 1 for snps files */
+    char *chr;                /* chromosome of the line, NULL at the end of the file */
+    int chr_size, pos, stop, state; /* start and stop of an alignment, or the position and state of a substitution */
+    int last, missed;         /* id of the chromosome the lines were last on when looked up, and 1 if a lookup found no lines */
+} TrackLine_s;
+
+typedef struct {
+    unsigned char *map;
+    size_t map_size;
+    int mapped;
+    TrackHead_s *head;
+    TrackChr_s *chrs;
+    Index_s *names;
+    int stream;               /* trackStream(): states are read from the files, coords and divs hold their next lines */
+    TrackLine_s *coords, *divs;
+    int *cover, *cover_chr;   /* last base covered by the alignments of each outgroup read so far and its chromosome */
+    int last_chr, last_pos;   /* previous lookup */
+    Index_s *passed;          /* chromosomes without an id whose lines were skipped */
+    char *looked;             /* 1 for chromosome ids that were looked up */
+    int looked_n;
+} Track_s;
+
+Track_s *trackBuild(FILE **coords, FILE **divs, int out_n);
+Track_s *trackOpen(FILE *file);
+Track_s *trackStream(FILE **coords, FILE **divs, int out_n);
+void trackWrite(Track_s *t, FILE *file);
+int trackChr(Track_s *t, const char *chr);
+int trackState(Track_s *t, int chr, int out, int pos);
+char trackBase(Track_s *t, int chr, int out, int pos, char ref);
+char trackStateBase(int state, char ref);
+void trackClose(Track_s *t);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Sliding windows over sorted sites. See window.h.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "window.h"
+#define merror "\nERROR: System out of memory\n\n"
+
+Window_s *windowInit(int size, int step) {
+    Window_s *w = NULL;
+
+    if((w = calloc(1, sizeof(Window_s))) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    w->size = size;
+    w->step = step;
+    w->slot_n = (size + step - 1) / step;
+    w->lo = 1;
+    w->hi = 1 - step;
+
+    return w;
+}
+
+/* Returns the slot of the oldest open window that ends before pos, or any open window if the site is on another chromosome or chr is NULL.
+   Returns -1 when no more windows need to be closed. */
+int windowClose(Window_s *w, const char *chr, int pos) {
+    int slot;
+
+    if(w->lo > w->hi)
+        return -1;
+    if(chr != NULL && strcmp(chr, w->chr) == 0 && w->lo + w->size - 1 >= pos)
+        return -1;
+    w->start = w->lo;
+    w->end = w->lo + w->size - 1;
+    slot = ((w->lo - 1) / w->step) % w->slot_n;
+    w->lo += w->step;
+
+    return slot;
+}
+
+/* Opens the windows up to pos and returns the slots of all windows containing pos. Call windowClose() first. */
+int windowOpen(Window_s *w, const char *chr, int pos, int *slots) {
+    int i, n = 0;
+
+    if(w->lo > w->hi) {
+        /* first window containing pos */
+        w->lo = pos - w->size + 1 < 1 ? 1 : pos - w->size + 1;
+        w->lo = 1 + (w->lo - 1 + w->step - 1) / w->step * w->step;
+        w->hi = w->lo - w->step;
+        if(w->chr == NULL || strcmp(chr, w->chr) != 0) {
+            free(w->chr);
+            if((w->chr = strdup(chr)) == NULL) {
+                fprintf(stderr, merror);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    while(w->hi + w->step <= pos)
+        w->hi += w->step;
+    for(i = w->lo; i <= w->hi; i += w->step)
+        slots[n++] = ((i - 1) / w->step) % w->slot_n;
+
+    return n;
+}
+
+void windowFree(Window_s *w) {
+    free(w->chr);
+    free(w);
+}
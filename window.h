@@ -0,0 +1,46 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Sliding windows over a stream of sites sorted by position within each chromosome.
+ Windows start at 1, 1 + step, 1 + 2 * step, ... and cover size bp. Only the windows that can still receive sites are open,
+ so a caller keeps ceil(size / step) accumulators (slots) and reuses the slot of each window once it has been written out.
+ Windows without sites are skipped.
+
+ Typical use, for each site:
+    while((slot = windowClose(w, chr, pos)) >= 0)
+        ...print w->chr, w->start, w->end and acc[slot], then reset acc[slot]...
+    n = windowOpen(w, chr, pos, slots);
+    ...add the site to acc[slots[0]] ... acc[slots[n - 1]]...
+ and windowClose(w, NULL, 0) at the end of the input.
+*/
+
+#ifndef WINDOW_H
+#define WINDOW_H
+
+typedef struct {
+    int size, step, slot_n;
+    int lo, hi;     /* starts of the oldest and newest open window, lo > hi when none is open */
+    int start, end; /* window returned by windowClose() */
+    char *chr;
+} Window_s;
+
+Window_s *windowInit(int size, int step);
+int windowClose(Window_s *w, const char *chr, int pos);
+int windowOpen(Window_s *w, const char *chr, int pos, int *slots);
+void windowFree(Window_s *w);
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Buffered output with hand-written number formatting. See writer.h.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "writer.h"
+#define merror "\nERROR: System out of memory\n\n"
+#define WRITESIZE 1048576
+
+static const double scale[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+static int formatSlow(char *s, double v, int prec);
+
+Writer_s *writerOpen(FILE *file) {
+    Writer_s *w = NULL;
+
+    if((w = malloc(sizeof(Writer_s))) == NULL || (w->buf = malloc(WRITESIZE)) == NULL) {
+        fprintf(stderr, merror);
+        exit(EXIT_FAILURE);
+    }
+    w->file = file;
+    w->size = WRITESIZE;
+    w->n = 0;
+
+    return w;
+}
+
+void writerStr(Writer_s *w, const char *s) {
+    size_t len = strlen(s);
+
+    if(w->n + len > w->size) {
+        writerFlush(w);
+        if(len > w->size) {
+            fwrite(s, 1, len, w->file);
+            return;
+        }
+    }
+    memcpy(w->buf + w->n, s, len);
+    w->n += len;
+}
+
+void writerChar(Writer_s *w, char c) {
+    if(w->n == w->size)
+        writerFlush(w);
+    w->buf[w->n++] = c;
+}
+
+void writerInt(Writer_s *w, long long v) {
+    if(w->n + WRITER_INT > w->size)
+        writerFlush(w);
+    w->n += formatInt(w->buf + w->n, v);
+}
+
+void writerFloat(Writer_s *w, double v, int prec) {
+    if(w->n + WRITER_FLOAT > w->size)
+        writerFlush(w);
+    w->n += formatFloat(w->buf + w->n, v, prec);
+}
+
+void writerFlush(Writer_s *w) {
+    if(w->n > 0 && fwrite(w->buf, 1, w->n, w->file) != w->n) {
+        fprintf(stderr, "\nERROR: Cannot write the output\n\n");
+        exit(EXIT_FAILURE);
+    }
+    w->n = 0;
+}
+
+/* Flushes the buffer and closes the file, stdout is only flushed */
+void writerClose(Writer_s *w) {
+    writerFlush(w);
+    if(w->file == stdout)
+        fflush(stdout);
+    else if(fclose(w->file) != 0) {
+        fprintf(stderr, "\nERROR: Cannot write the output\n\n");
+        exit(EXIT_FAILURE);
+    }
+    free(w->buf);
+    free(w);
+}
+
+/* Writes v in decimal and returns the number of characters (not terminated) */
+int formatInt(char *s, long long v) {
+    int i = 0, n = 0;
+    unsigned long long u = v < 0 ? -(unsigned long long)v : (unsigned long long)v;
+    char tmp[24];
+
+    do {
+        tmp[i++] = '0' + u % 10;
+        u /= 10;
+    } while(u > 0);
+    if(v < 0)
+        s[n++] = '-';
+    while(i > 0)
+        s[n++] = tmp[--i];
+
+    return n;
+}
+
+/* Writes v with prec decimals, rounded as printf does. Values where the scaled number is too close to halfway for double arithmetic to decide,
+   as well as very large values, NaN and infinity, go through snprintf. Returns the number of characters (not terminated), at most WRITER_FLOAT. */
+int formatFloat(char *s, double v, int prec) {
+    int i, n = 0;
+    unsigned long long r, ip, fp;
+    double x, frac;
+
+    x = fabs(v) * scale[prec < 10 && prec >= 0 ? prec : 0];
+    if(prec < 0 || prec > 9 || !(x < 4e15))
+        return formatSlow(s, v, prec);
+    r = (unsigned long long)x;
+    frac = x - r;
+    if(fabs(frac - 0.5) <= x * 1e-15 + 1e-300)
+        return formatSlow(s, v, prec);
+    if(frac > 0.5)
+        r++;
+    ip = r / (unsigned long long)scale[prec];
+    fp = r % (unsigned long long)scale[prec];
+    if(signbit(v))
+        s[n++] = '-';
+    n += formatInt(s + n, ip);
+    if(prec > 0) {
+        s[n++] = '.';
+        for(i = prec - 1; i >= 0; i--) {
+            s[n + i] = '0' + fp % 10;
+            fp /= 10;
+        }
+        n += prec;
+    }
+
+    return n;
+}
+
+/* formatFloat() through snprintf into a local buffer, so at most WRITER_FLOAT characters reach s */
+static int formatSlow(char *s, double v, int prec) {
+    int n;
+    char tmp[WRITER_FLOAT + 1];
+
+    if((n = snprintf(tmp, sizeof(tmp), "%.*f", prec, v)) < 0)
+        n = 0;
+    if(n > WRITER_FLOAT)
+        n = WRITER_FLOAT;
+    memcpy(s, tmp, n);
+
+    return n;
+}
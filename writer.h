@@ -0,0 +1,54 @@
+/*
+ Copyright (C) 2026 Tuomas Hamala
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License
+ as published by the Free Software Foundation; either version 2
+ of the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ For any other inquiries send an email to tuomas.hamala@gmail.com
+
+ ––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
+
+ Buffered output for per-site lines. Text is collected in a large buffer and written with one fwrite per buffer,
+ and numbers are formatted by hand instead of going through printf, with the same result as printf("%i") and printf("%.<prec>f").
+ Output written with printf to the same stream needs a writerFlush() first to keep the order.
+
+ Typical use:
+    w = writerOpen(stdout);
+    writerStr(w, chr); writerChar(w, '\t'); writerInt(w, pos); writerChar(w, '\t'); writerFloat(w, fst, 6); writerChar(w, '\n');
+    writerClose(w);
+
+ formatInt() and formatFloat() write into a caller buffer with at least WRITER_INT and WRITER_FLOAT bytes free, and can be used from worker threads.
+*/
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <stdio.h>
+
+#define WRITER_INT 24     /* most characters written by formatInt() */
+#define WRITER_FLOAT 320  /* most characters written by formatFloat(), enough for any double with up to 9 decimals */
+
+typedef struct {
+    FILE *file;
+    char *buf;
+    size_t size, n;
+} Writer_s;
+
+Writer_s *writerOpen(FILE *file);
+void writerStr(Writer_s *w, const char *s);
+void writerChar(Writer_s *w, char c);
+void writerInt(Writer_s *w, long long v);
+void writerFloat(Writer_s *w, double v, int prec);
+void writerFlush(Writer_s *w);
+void writerClose(Writer_s *w);
+int formatInt(char *s, long long v);
+int formatFloat(char *s, double v, int prec);
+
+#endif